@@ -0,0 +1,1100 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "tip_debug_print.h"
+#include "tip_debug_binary.h"
+#include "tip_time.h"
+using namespace LibTip;
+
+#define DEBUG_DATE_FORMAT		"%Y-%m-%d"
+#define DEBUG_TIME_FORMAT		"%T"
+#define DEBUG_DATE_TIME_FORMAT	DEBUG_DATE_FORMAT " " DEBUG_TIME_FORMAT
+
+// file layout: a FileHeader followed by records.  every record starts
+// with a RecordHeader and its size includes the header.  all values
+// are in host byte order, logs are decoded on the machine (or at
+// least the architecture) that wrote them.
+static const char kMagic[8] = { 'T', 'I', 'P', 'B', 'L', 'O', 'G', '1' };
+
+struct FileHeader {
+    char     mMagic[8];
+    uint32_t mPid;
+    uint32_t mPad;
+};
+
+enum {
+    RECORD_STRING  = 1, // uint64_t id, text without terminator
+    RECORD_LOG     = 2, // LogRecord, encoded arguments
+    RECORD_DROPPED = 3  // uint32_t number of records dropped
+};
+
+struct RecordHeader {
+    uint16_t mSize;
+    uint8_t  mType;
+    uint8_t  mPad;
+};
+
+// string fields hold the address of the string, the text is written
+// in a RECORD_STRING the first time an address is seen
+struct LogRecord {
+    RecordHeader mHeader;
+    uint32_t     mLine;
+    uint64_t     mTime;
+    uint64_t     mArea;
+    uint64_t     mFunction;
+    uint64_t     mFile;
+    uint64_t     mFormat;
+};
+
+// largest log record, arguments that do not fit are truncated
+static const uint32_t kMaxLogRecord = 1024;
+
+// largest record of any type
+static const uint32_t kMaxRecord = 0xFFFF;
+
+// smallest ring allowed, must hold several maximum size records
+static const uint32_t kMinRingSize = 4096;
+
+// how long the drain thread sleeps when there is nothing to do
+static const long kDrainIdleNsec = 1000000;
+
+// length modifiers of a conversion
+enum {
+    LEN_NONE,
+    LEN_CHAR,
+    LEN_SHORT,
+    LEN_LONG,
+    LEN_LLONG,
+    LEN_SIZE,
+    LEN_INTMAX,
+    LEN_PTRDIFF,
+    LEN_LDOUBLE
+};
+
+// how a conversion's argument is passed and encoded
+enum {
+    ARG_NONE,
+    ARG_INT,
+    ARG_LONG,
+    ARG_LLONG,
+    ARG_SIZE,
+    ARG_INTMAX,
+    ARG_PTRDIFF,
+    ARG_DOUBLE,
+    ARG_LDOUBLE,
+    ARG_POINTER,
+    ARG_STRING,
+    ARG_UNSUPPORTED
+};
+
+// one conversion of a printf format
+struct FormatSpec {
+    const char* mStart;     // the '%'
+    const char* mEnd;       // one past the conversion character
+    uint32_t    mStars;     // number of '*' width and precision arguments
+    bool        mStarPrecision;
+    int         mPrecision; // -1 if not given in the format
+    int         mLength;
+    char        mConv;
+};
+
+// find the next conversion in fmt.  "%%" is returned as a conversion
+// without an argument.  returns false if there are no more.  the
+// encoder and the decoder both walk the format with this function so
+// they always agree on the layout of the arguments.
+static bool NextSpec(const char* fmt, FormatSpec& spec)
+{
+    const char* p = strchr(fmt, '%');
+    if (p == NULL) {
+        return false;
+    }
+
+    spec.mStart         = p++;
+    spec.mStars         = 0;
+    spec.mStarPrecision = false;
+    spec.mPrecision     = -1;
+    spec.mLength        = LEN_NONE;
+
+    // flags and width
+    while (*p != '\0' && strchr("-+ #0'123456789*", *p) != NULL) {
+        if (*p == '*') {
+            spec.mStars++;
+        }
+        p++;
+    }
+
+    // precision
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec.mStars++;
+            spec.mStarPrecision = true;
+            p++;
+        } else {
+            spec.mPrecision = 0;
+            while (*p >= '0' && *p <= '9') {
+                spec.mPrecision = (spec.mPrecision * 10) + (*p - '0');
+                p++;
+            }
+        }
+    }
+
+    switch (*p) {
+    case 'h':
+        p++;
+        spec.mLength = LEN_SHORT;
+        if (*p == 'h') {
+            p++;
+            spec.mLength = LEN_CHAR;
+        }
+        break;
+
+    case 'l':
+        p++;
+        spec.mLength = LEN_LONG;
+        if (*p == 'l') {
+            p++;
+            spec.mLength = LEN_LLONG;
+        }
+        break;
+
+    case 'q':
+        p++;
+        spec.mLength = LEN_LLONG;
+        break;
+
+    case 'z':
+        p++;
+        spec.mLength = LEN_SIZE;
+        break;
+
+    case 'j':
+        p++;
+        spec.mLength = LEN_INTMAX;
+        break;
+
+    case 't':
+        p++;
+        spec.mLength = LEN_PTRDIFF;
+        break;
+
+    case 'L':
+        p++;
+        spec.mLength = LEN_LDOUBLE;
+        break;
+    }
+
+    spec.mConv = *p;
+    spec.mEnd  = (*p != '\0' ? (p + 1) : p);
+    return true;
+}
+
+static int GetArgType(const FormatSpec& spec)
+{
+    if (spec.mStars > 2) {
+        return ARG_UNSUPPORTED;
+    }
+
+    switch (spec.mConv) {
+    case '%':
+        return ARG_NONE;
+
+    case 'd':
+    case 'i':
+    case 'o':
+    case 'u':
+    case 'x':
+    case 'X':
+        switch (spec.mLength) {
+        case LEN_NONE:
+        case LEN_CHAR:
+        case LEN_SHORT:
+            return ARG_INT;
+        case LEN_LONG:
+            return ARG_LONG;
+        case LEN_LLONG:
+            return ARG_LLONG;
+        case LEN_SIZE:
+            return ARG_SIZE;
+        case LEN_INTMAX:
+            return ARG_INTMAX;
+        case LEN_PTRDIFF:
+            return ARG_PTRDIFF;
+        }
+        return ARG_UNSUPPORTED;
+
+    case 'c':
+        return (spec.mLength == LEN_NONE ? ARG_INT : ARG_UNSUPPORTED);
+
+    case 'e':
+    case 'E':
+    case 'f':
+    case 'F':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        return (spec.mLength == LEN_LDOUBLE ? ARG_LDOUBLE : ARG_DOUBLE);
+
+    case 'p':
+        return ARG_POINTER;
+
+    case 's':
+        return (spec.mLength == LEN_NONE ? ARG_STRING : ARG_UNSUPPORTED);
+    }
+
+    return ARG_UNSUPPORTED;
+}
+
+template <class T>
+static bool PutArg(uint8_t* buffer, uint32_t& pos, uint32_t size, T value)
+{
+    if (sizeof(T) > (size - pos)) {
+        return false;
+    }
+
+    memcpy(buffer + pos, &value, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+template <class T>
+static bool GetArg(const uint8_t* buffer, uint32_t& pos, uint32_t size, T& value)
+{
+    if (sizeof(T) > (size - pos)) {
+        return false;
+    }
+
+    memcpy(&value, buffer + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+// what the encoder needs to know about one conversion
+struct ArgSpec {
+    uint8_t mType;
+    uint8_t mStars;
+    uint8_t mStarPrecision;
+    uint8_t mPad;
+    int32_t mPrecision;
+};
+
+// arguments of a format up to its first unsupported conversion, so
+// the format is walked once instead of on every log statement
+static const uint32_t kMaxLayoutArgs = 12;
+
+struct FormatLayout {
+    const char* mFormat;
+    uint32_t    mNumArgs;
+    bool        mOverflow;  // more arguments than fit, walk the format
+    ArgSpec     mArgs[kMaxLayoutArgs];
+};
+
+// layouts are cached per ring, indexed by the format's address
+static const uint32_t kLayoutCacheSize = 64;
+
+static bool GetArgSpec(const FormatSpec& spec, ArgSpec& arg)
+{
+    int type = GetArgType(spec);
+
+    arg.mType          = type;
+    arg.mStars         = spec.mStars;
+    arg.mStarPrecision = spec.mStarPrecision;
+    arg.mPad           = 0;
+    arg.mPrecision     = spec.mPrecision;
+    return (type != ARG_UNSUPPORTED);
+}
+
+static void BuildLayout(const char* fmt, FormatLayout& layout)
+{
+    FormatSpec spec;
+
+    layout.mFormat   = fmt;
+    layout.mNumArgs  = 0;
+    layout.mOverflow = false;
+
+    while (NextSpec(fmt, spec)) {
+        ArgSpec arg;
+        if (! GetArgSpec(spec, arg)) {
+            break;
+        }
+        
+        if (arg.mType != ARG_NONE || arg.mStars != 0) {
+            if (layout.mNumArgs == kMaxLayoutArgs) {
+                layout.mOverflow = true;
+                break;
+            }
+            layout.mArgs[layout.mNumArgs++] = arg;
+        }
+
+        fmt = spec.mEnd;
+    }
+}
+
+// encode one argument into buffer at pos.  returns false if it does
+// not fit.
+static bool EncodeArg(uint8_t* buffer, uint32_t& pos, uint32_t size,
+                      const ArgSpec& arg, va_list* ap)
+{
+    int star = -1;
+    for (uint32_t i = 0; i < arg.mStars; i++) {
+        star = va_arg(*ap, int);
+        if (! PutArg(buffer, pos, size, star)) {
+            return false;
+        }
+    }
+
+    switch (arg.mType) {
+    case ARG_INT:
+        return PutArg(buffer, pos, size, va_arg(*ap, int));
+    case ARG_LONG:
+        return PutArg(buffer, pos, size, va_arg(*ap, long));
+    case ARG_LLONG:
+        return PutArg(buffer, pos, size, va_arg(*ap, long long));
+    case ARG_SIZE:
+        return PutArg(buffer, pos, size, va_arg(*ap, size_t));
+    case ARG_INTMAX:
+        return PutArg(buffer, pos, size, va_arg(*ap, intmax_t));
+    case ARG_PTRDIFF:
+        return PutArg(buffer, pos, size, va_arg(*ap, ptrdiff_t));
+    case ARG_DOUBLE:
+        return PutArg(buffer, pos, size, va_arg(*ap, double));
+    case ARG_LDOUBLE:
+        return PutArg(buffer, pos, size, va_arg(*ap, long double));
+    case ARG_POINTER:
+        return PutArg(buffer, pos, size, va_arg(*ap, void*));
+
+    case ARG_STRING: {
+        const char* str = va_arg(*ap, const char*);
+        if (str == NULL) {
+            str = "(null)";
+        }
+
+        // length prefixed, truncated to the precision and to the
+        // space left in the record
+        uint16_t len = 0;
+        if (sizeof(len) > (size - pos)) {
+            return false;
+        }
+
+        size_t max = size - pos - sizeof(len);
+        int precision = (arg.mStarPrecision ? star : arg.mPrecision);
+        if (precision >= 0 && (size_t) precision < max) {
+            max = precision;
+        }
+
+        len = (uint16_t) strnlen(str, max);
+        PutArg(buffer, pos, size, len);
+        memcpy(buffer + pos, str, len);
+        pos += len;
+        return true;
+    }
+    }
+
+    return true;
+}
+
+// encode the arguments of fmt into buffer starting at pos.  encoding
+// stops at the first unsupported conversion or when the buffer is
+// full.  returns the new end of the buffer.
+static uint32_t EncodeArgs(uint8_t* buffer, uint32_t pos, uint32_t size,
+                           const FormatLayout& layout, va_list* ap)
+{
+    if (! layout.mOverflow) {
+        for (uint32_t i = 0; i < layout.mNumArgs; i++) {
+            if (! EncodeArg(buffer, pos, size, layout.mArgs[i], ap)) {
+                break;
+            }
+        }
+
+        return pos;
+    }
+
+    FormatSpec spec;
+    const char* fmt = layout.mFormat;
+    while (NextSpec(fmt, spec)) {
+        ArgSpec arg;
+        if (! GetArgSpec(spec, arg) || ! EncodeArg(buffer, pos, size, arg, ap)) {
+            break;
+        }
+
+        fmt = spec.mEnd;
+    }
+
+    return pos;
+}
+
+template <class T>
+static int FormatArg(char* buffer, size_t size, const char* fmt, uint32_t numStars,
+                     const int* stars, T value)
+{
+    switch (numStars) {
+    case 0:
+        return snprintf(buffer, size, fmt, value);
+    case 1:
+        return snprintf(buffer, size, fmt, stars[0], value);
+    }
+
+    return snprintf(buffer, size, fmt, stars[0], stars[1], value);
+}
+
+// format one conversion with snprintf and append it to out
+template <class T>
+static void AppendArg(std::string& out, const FormatSpec& spec, const int* stars, T value)
+{
+    std::string fmt(spec.mStart, spec.mEnd - spec.mStart);
+    char buffer[256];
+
+    int len = FormatArg(buffer, sizeof(buffer), fmt.c_str(), spec.mStars, stars, value);
+    if (len < 0) {
+        return;
+    }
+    
+    if ((size_t) len < sizeof(buffer)) {
+        out.append(buffer, len);
+    } else {
+        std::vector<char> large(len + 1);
+        FormatArg(&large[0], large.size(), fmt.c_str(), spec.mStars, stars, value);
+        out.append(&large[0], len);
+    }
+}
+
+template <class T>
+static bool DecodeArg(std::string& out, const FormatSpec& spec, const int* stars,
+                      const uint8_t* buffer, uint32_t& pos, uint32_t size)
+{
+    T value;
+    if (! GetArg(buffer, pos, size, value)) {
+        return false;
+    }
+
+    AppendArg(out, spec, stars, value);
+    return true;
+}
+
+// rebuild the text of a log statement from its format and encoded
+// arguments.  anything left after the arguments run out is printed as
+// it appears in the format.
+static void DecodeArgs(std::string& out, const char* fmt,
+                       const uint8_t* buffer, uint32_t size)
+{
+    FormatSpec spec;
+    uint32_t pos = 0;
+    
+    while (NextSpec(fmt, spec)) {
+        out.append(fmt, spec.mStart - fmt);
+        fmt = spec.mStart;
+
+        int type = GetArgType(spec);
+        if (type == ARG_UNSUPPORTED) {
+            break;
+        }
+
+        int stars[2];
+        bool ok = true;
+        for (uint32_t i = 0; ok && i < spec.mStars; i++) {
+            ok = GetArg(buffer, pos, size, stars[i]);
+        }
+        if (! ok) {
+            break;
+        }
+
+        switch (type) {
+        case ARG_NONE:
+            out += '%';
+            break;
+        case ARG_INT:
+            ok = DecodeArg<int>(out, spec, stars, buffer, pos, size);
+            break;
+        case ARG_LONG:
+            ok = DecodeArg<long>(out, spec, stars, buffer, pos, size);
+            break;
+        case ARG_LLONG:
+            ok = DecodeArg<long long>(out, spec, stars, buffer, pos, size);
+            break;
+        case ARG_SIZE:
+            ok = DecodeArg<size_t>(out, spec, stars, buffer, pos, size);
+            break;
+        case ARG_INTMAX:
+            ok = DecodeArg<intmax_t>(out, spec, stars, buffer, pos, size);
+            break;
+        case ARG_PTRDIFF:
+            ok = DecodeArg<ptrdiff_t>(out, spec, stars, buffer, pos, size);
+            break;
+        case ARG_DOUBLE:
+            ok = DecodeArg<double>(out, spec, stars, buffer, pos, size);
+            break;
+        case ARG_LDOUBLE:
+            ok = DecodeArg<long double>(out, spec, stars, buffer, pos, size);
+            break;
+        case ARG_POINTER:
+            ok = DecodeArg<void*>(out, spec, stars, buffer, pos, size);
+            break;
+
+        case ARG_STRING: {
+            uint16_t len;
+            ok = (GetArg(buffer, pos, size, len) && len <= (size - pos));
+            if (ok) {
+                std::string str((const char*) buffer + pos, len);
+                pos += len;
+                AppendArg(out, spec, stars, str.c_str());
+            }
+            break;
+        }
+        }
+
+        if (! ok) {
+            break;
+        }
+
+        fmt = spec.mEnd;
+    }
+
+    out.append(fmt);
+}
+
+// single producer, single consumer byte ring.  the owning thread
+// appends records at mHead and the drain thread consumes them from
+// mTail.  both counters run freely and are masked on access.  they
+// live on separate cache lines so the two threads do not contend.
+struct CTipDebugRing {
+    uint8_t*       mData;
+    uint32_t       mMask;
+    FormatLayout*  mLayouts;    // owner only
+    int            mOwned;      // nonzero while a live thread owns the ring
+    CTipDebugRing* mNext;
+    uint32_t       mReported;   // drops already written, drain thread only
+    uint8_t        mPad1[64];
+    uint32_t       mHead;
+    uint32_t       mDropped;    // records that did not fit
+    uint8_t        mPad2[64];
+    uint32_t       mTail;
+};
+
+static bool gBinaryRunning = false;
+static int gBinaryStop = 0;
+static uint32_t gBinaryGeneration = 0;
+static uint32_t gBinaryRingSize = 0;
+static uint64_t gBinaryDropped = 0;
+static FILE* gBinaryOutput = NULL;
+static CTipDebugRing* gBinaryRings = NULL;
+static pthread_t gBinaryThread;
+static pthread_key_t gBinaryKey;
+static std::set<uint64_t> gBinaryDefined;
+
+static DebugPrefixFunc gBinarySavedPrefix = NULL;
+static DebugPrintfFunc gBinarySavedPrintf = NULL;
+static FILE* gBinarySavedOutput = NULL;
+
+// per thread state.  the ring is valid only while the generation
+// matches, each start and stop invalidates the rings of the last run.
+static __thread CTipDebugRing* gThreadRing = NULL;
+static __thread uint32_t gThreadGeneration = 0;
+static __thread const char* gThreadFunction = NULL;
+static __thread const char* gThreadArea = NULL;
+static __thread const char* gThreadFile = NULL;
+static __thread int gThreadLine = 0;
+
+static void RingWrite(CTipDebugRing* ring, uint32_t pos, const uint8_t* data, uint32_t len)
+{
+    uint32_t offset = (pos & ring->mMask);
+    uint32_t first = (ring->mMask + 1) - offset;
+    if (first > len) {
+        first = len;
+    }
+
+    memcpy(ring->mData + offset, data, first);
+    memcpy(ring->mData, data + first, len - first);
+}
+
+static void RingRead(CTipDebugRing* ring, uint32_t pos, uint8_t* data, uint32_t len)
+{
+    uint32_t offset = (pos & ring->mMask);
+    uint32_t first = (ring->mMask + 1) - offset;
+    if (first > len) {
+        first = len;
+    }
+
+    memcpy(data, ring->mData + offset, first);
+    memcpy(data + first, ring->mData, len - first);
+}
+
+// called when a thread exits so its ring can be reused
+static void ReleaseRing(void* arg)
+{
+    CTipDebugRing* ring = (CTipDebugRing*) arg;
+    __atomic_store_n(&ring->mOwned, 0, __ATOMIC_RELEASE);
+}
+
+static CTipDebugRing* GetThreadRing()
+{
+    uint32_t generation = __atomic_load_n(&gBinaryGeneration, __ATOMIC_ACQUIRE);
+    if (gThreadRing != NULL && gThreadGeneration == generation) {
+        return gThreadRing;
+    }
+
+    // reuse a ring left behind by an exited thread, the drain thread
+    // keeps draining it so whatever it still holds is not lost
+    CTipDebugRing* ring = __atomic_load_n(&gBinaryRings, __ATOMIC_ACQUIRE);
+    for (; ring != NULL; ring = ring->mNext) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&ring->mOwned, &expected, 1, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    if (ring == NULL) {
+        ring = new CTipDebugRing;
+        memset(ring, 0, sizeof(CTipDebugRing));
+        ring->mData  = new uint8_t[gBinaryRingSize];
+        ring->mMask  = gBinaryRingSize - 1;
+        ring->mOwned = 1;
+
+        ring->mLayouts = new FormatLayout[kLayoutCacheSize];
+        memset(ring->mLayouts, 0, sizeof(FormatLayout) * kLayoutCacheSize);
+
+        ring->mNext = __atomic_load_n(&gBinaryRings, __ATOMIC_RELAXED);
+        while (! __atomic_compare_exchange_n(&gBinaryRings, &ring->mNext, ring, false,
+                                             __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+
+    pthread_setspecific(gBinaryKey, ring);
+    gThreadRing       = ring;
+    gThreadGeneration = generation;
+    return ring;
+}
+
+static void BinaryPrefix(const char* inFunction, const char* area,
+                         const char* inFile, int inLine)
+{
+    gThreadFunction = inFunction;
+    gThreadArea     = area;
+    gThreadFile     = inFile;
+    gThreadLine     = inLine;
+}
+
+static void BinaryPrintf(const char* inFmt, ...)
+{
+    uint8_t buffer[kMaxLogRecord];
+    LogRecord record;
+    CTipDebugRing* ring = GetThreadRing();
+
+    FormatLayout& layout = ring->mLayouts[((uintptr_t) inFmt >> 2) % kLayoutCacheSize];
+    if (layout.mFormat != inFmt) {
+        BuildLayout(inFmt, layout);
+    }
+
+    va_list ap;
+    va_start(ap, inFmt);
+    uint32_t size = EncodeArgs(buffer, sizeof(record), sizeof(buffer), layout, &ap);
+    va_end(ap);
+
+    record.mHeader.mSize = size;
+    record.mHeader.mType = RECORD_LOG;
+    record.mHeader.mPad  = 0;
+    record.mLine         = gThreadLine;
+    record.mTime         = GetUsecTimestamp();
+    record.mArea         = (uintptr_t) gThreadArea;
+    record.mFunction     = (uintptr_t) gThreadFunction;
+    record.mFile         = (uintptr_t) gThreadFile;
+    record.mFormat       = (uintptr_t) inFmt;
+    memcpy(buffer, &record, sizeof(record));
+
+    uint32_t head = ring->mHead;
+    uint32_t tail = __atomic_load_n(&ring->mTail, __ATOMIC_ACQUIRE);
+    if (size > (ring->mMask + 1) - (head - tail)) {
+        __atomic_store_n(&ring->mDropped, ring->mDropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    RingWrite(ring, head, buffer, size);
+    __atomic_store_n(&ring->mHead, head + size, __ATOMIC_RELEASE);
+}
+
+// write the text of a string the first time its address is seen
+static void DefineString(uint64_t id)
+{
+    if (id == 0 || ! gBinaryDefined.insert(id).second) {
+        return;
+    }
+
+    const char* text = (const char*) (uintptr_t) id;
+    RecordHeader header;
+    size_t len = strnlen(text, kMaxRecord - sizeof(header) - sizeof(id));
+
+    header.mSize = sizeof(header) + sizeof(id) + len;
+    header.mType = RECORD_STRING;
+    header.mPad  = 0;
+    fwrite(&header, sizeof(header), 1, gBinaryOutput);
+    fwrite(&id, sizeof(id), 1, gBinaryOutput);
+    fwrite(text, len, 1, gBinaryOutput);
+}
+
+static void WriteLog(const uint8_t* buffer, uint32_t size)
+{
+    LogRecord record;
+    memcpy(&record, buffer, sizeof(record));
+
+    DefineString(record.mArea);
+    DefineString(record.mFunction);
+    DefineString(record.mFile);
+    DefineString(record.mFormat);
+    fwrite(buffer, size, 1, gBinaryOutput);
+}
+
+static void WriteDropped(uint32_t count)
+{
+    RecordHeader header;
+    header.mSize = sizeof(header) + sizeof(count);
+    header.mType = RECORD_DROPPED;
+    header.mPad  = 0;
+    fwrite(&header, sizeof(header), 1, gBinaryOutput);
+    fwrite(&count, sizeof(count), 1, gBinaryOutput);
+}
+
+// write out everything in a ring, returns the number of records
+// written
+static uint32_t DrainRing(CTipDebugRing* ring)
+{
+    uint8_t buffer[kMaxLogRecord];
+    uint32_t count = 0;
+    uint32_t dropped = __atomic_load_n(&ring->mDropped, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&ring->mHead, __ATOMIC_ACQUIRE);
+    uint32_t tail = ring->mTail;
+
+    while (tail != head) {
+        RecordHeader header;
+        RingRead(ring, tail, (uint8_t*) &header, sizeof(header));
+        RingRead(ring, tail, buffer, header.mSize);
+        WriteLog(buffer, header.mSize);
+
+        tail += header.mSize;
+        __atomic_store_n(&ring->mTail, tail, __ATOMIC_RELEASE);
+        count++;
+    }
+
+    // drops are noted after the records that filled the ring
+    if (dropped != ring->mReported) {
+        WriteDropped(dropped - ring->mReported);
+        ring->mReported = dropped;
+        count++;
+    }
+
+    return count;
+}
+
+static uint32_t DrainAll()
+{
+    uint32_t count = 0;
+    CTipDebugRing* ring = __atomic_load_n(&gBinaryRings, __ATOMIC_ACQUIRE);
+    for (; ring != NULL; ring = ring->mNext) {
+        count += DrainRing(ring);
+    }
+
+    return count;
+}
+
+static void* DrainThread(void*)
+{
+    while (1) {
+        // one more full pass after a stop is seen picks up everything
+        // logged before it
+        int stop = __atomic_load_n(&gBinaryStop, __ATOMIC_ACQUIRE);
+        if (DrainAll() != 0) {
+            continue;
+        }
+
+        (void) fflush(gBinaryOutput);
+        if (stop) {
+            break;
+        }
+
+        struct timespec idle = { 0, kDrainIdleNsec };
+        nanosleep(&idle, NULL);
+    }
+
+    return NULL;
+}
+
+int LibTip::DebugBinaryStart(FILE* output, uint32_t ringSize)
+{
+    if (gBinaryRunning || output == NULL) {
+        return -1;
+    }
+
+    uint32_t size = kMinRingSize;
+    while (size < ringSize && size < 0x80000000) {
+        size <<= 1;
+    }
+    
+    FileHeader fileHeader;
+    memcpy(fileHeader.mMagic, kMagic, sizeof(kMagic));
+    fileHeader.mPid = getpid();
+    fileHeader.mPad = 0;
+    if (fwrite(&fileHeader, sizeof(fileHeader), 1, output) != 1) {
+        return -1;
+    }
+
+    if (pthread_key_create(&gBinaryKey, &ReleaseRing) != 0) {
+        return -1;
+    }
+
+    gBinaryOutput   = output;
+    gBinaryRingSize = size;
+    gBinaryStop     = 0;
+    gBinaryDropped  = 0;
+    gBinaryDefined.clear();
+    __atomic_add_fetch(&gBinaryGeneration, 1, __ATOMIC_RELEASE);
+    
+    if (pthread_create(&gBinaryThread, NULL, &DrainThread, NULL) != 0) {
+        pthread_key_delete(gBinaryKey);
+        gBinaryOutput = NULL;
+        return -1;
+    }
+
+    // without an output file AMDEBUG takes no lock
+    gBinarySavedPrefix = gDebugPrefixFunc;
+    gBinarySavedPrintf = gDebugPrintfFunc;
+    gBinarySavedOutput = gDebugOutput;
+    gDebugPrefixFunc   = &BinaryPrefix;
+    gDebugPrintfFunc   = &BinaryPrintf;
+    gDebugOutput       = NULL;
+    
+    gBinaryRunning = true;
+    return 0;
+}
+
+void LibTip::DebugBinaryStop()
+{
+    if (! gBinaryRunning) {
+        return;
+    }
+
+    gDebugPrefixFunc = gBinarySavedPrefix;
+    gDebugPrintfFunc = gBinarySavedPrintf;
+    gDebugOutput     = gBinarySavedOutput;
+
+    __atomic_store_n(&gBinaryStop, 1, __ATOMIC_RELEASE);
+    pthread_join(gBinaryThread, NULL);
+    pthread_key_delete(gBinaryKey);
+    __atomic_add_fetch(&gBinaryGeneration, 1, __ATOMIC_RELEASE);
+
+    CTipDebugRing* ring = gBinaryRings;
+    while (ring != NULL) {
+        CTipDebugRing* next = ring->mNext;
+        gBinaryDropped += ring->mDropped;
+        delete [] ring->mData;
+        delete [] ring->mLayouts;
+        delete ring;
+        ring = next;
+    }
+
+    gBinaryRings   = NULL;
+    gBinaryOutput  = NULL;
+    gBinaryRunning = false;
+}
+
+void LibTip::DebugBinaryFlush()
+{
+    if (! gBinaryRunning) {
+        return;
+    }
+
+    // wait for the drain thread to get past what is in each ring now
+    CTipDebugRing* ring = __atomic_load_n(&gBinaryRings, __ATOMIC_ACQUIRE);
+    for (; ring != NULL; ring = ring->mNext) {
+        uint32_t head = __atomic_load_n(&ring->mHead, __ATOMIC_ACQUIRE);
+        while ((int32_t) (__atomic_load_n(&ring->mTail, __ATOMIC_ACQUIRE) - head) < 0) {
+            struct timespec idle = { 0, kDrainIdleNsec };
+            nanosleep(&idle, NULL);
+        }
+    }
+
+    (void) fflush(gBinaryOutput);
+}
+
+uint64_t LibTip::DebugBinaryGetDropped()
+{
+    uint64_t dropped = gBinaryDropped;
+    CTipDebugRing* ring = __atomic_load_n(&gBinaryRings, __ATOMIC_ACQUIRE);
+    for (; ring != NULL; ring = ring->mNext) {
+        dropped += __atomic_load_n(&ring->mDropped, __ATOMIC_RELAXED);
+    }
+
+    return dropped;
+}
+
+typedef std::map<uint64_t, std::string> StringMap;
+
+static const char* LookupString(const StringMap& strings, uint64_t id)
+{
+    StringMap::const_iterator it = strings.find(id);
+    return (it != strings.end() ? it->second.c_str() : "?");
+}
+
+// the same prefix DebugPrefix() prints, using the recorded values
+static void DecodePrefix(std::string& out, const LogRecord& record,
+                         const StringMap& strings, uint32_t pid)
+{
+    char buffer[128];
+    
+    if (gDebugFlags & (PRINT_TIME | PRINT_DATE)) {
+        time_t secs = (time_t) (record.mTime / 1000000);
+        struct tm tm;
+        const char* format;
+
+        if (gDebugFlags & PRINT_UTC) {
+            (void) gmtime_r(&secs, &tm);
+        } else {
+            (void) localtime_r(&secs, &tm);
+        }
+        
+        if ((gDebugFlags & (PRINT_TIME | PRINT_DATE)) == (PRINT_TIME | PRINT_DATE)) {
+            format = DEBUG_DATE_TIME_FORMAT;
+        } else if (gDebugFlags & PRINT_TIME) {
+            format = DEBUG_TIME_FORMAT;
+        } else {
+            format = DEBUG_DATE_FORMAT;
+        }
+
+        (void) strftime(buffer, sizeof(buffer), format, &tm);
+        out += buffer;
+        if (gDebugFlags & PRINT_TIME) {
+            snprintf(buffer, sizeof(buffer), ".%03lu",
+                     (unsigned long) ((record.mTime % 1000000) / 1000));
+            out += buffer;
+        }
+        out += ": ";
+    }
+
+    if (gDebugFlags & PRINT_PROC) {
+        snprintf(buffer, sizeof(buffer), "[pid %u] ", pid);
+        out += buffer;
+    }
+
+    if (gDebugFlags & PRINT_AREA) {
+        snprintf(buffer, sizeof(buffer), "[%-6.6s] ", LookupString(strings, record.mArea));
+        out += buffer;
+    }
+
+    if (gDebugFlags & PRINT_FUNCTION) {
+        out += LookupString(strings, record.mFunction);
+        out += ' ';
+    }
+
+    if (gDebugFlags & PRINT_FILE) {
+        out += LookupString(strings, record.mFile);
+        out += ' ';
+    }
+
+    if (gDebugFlags & PRINT_LINE) {
+        snprintf(buffer, sizeof(buffer), "%u ", record.mLine);
+        out += buffer;
+    }
+}
+
+int LibTip::DebugBinaryDecode(FILE* input, FILE* output)
+{
+    FileHeader fileHeader;
+    if (fread(&fileHeader, sizeof(fileHeader), 1, input) != 1 ||
+        memcmp(fileHeader.mMagic, kMagic, sizeof(kMagic)) != 0) {
+        return -1;
+    }
+
+    StringMap strings;
+    std::vector<uint8_t> buffer(kMaxRecord);
+    RecordHeader header;
+    int count = 0;
+
+    while (fread(&header, sizeof(header), 1, input) == 1) {
+        if (header.mSize < sizeof(header)) {
+            return -1;
+        }
+
+        uint32_t size = header.mSize;
+        memcpy(&buffer[0], &header, sizeof(header));
+        if (size > sizeof(header) &&
+            fread(&buffer[sizeof(header)], size - sizeof(header), 1, input) != 1) {
+            return -1;
+        }
+
+        switch (header.mType) {
+        case RECORD_STRING: {
+            uint64_t id;
+            if (size < sizeof(header) + sizeof(id)) {
+                return -1;
+            }
+
+            memcpy(&id, &buffer[sizeof(header)], sizeof(id));
+            strings[id].assign((const char*) &buffer[sizeof(header) + sizeof(id)],
+                               size - sizeof(header) - sizeof(id));
+            break;
+        }
+
+        case RECORD_LOG: {
+            LogRecord record;
+            if (size < sizeof(record)) {
+                return -1;
+            }
+
+            memcpy(&record, &buffer[0], sizeof(record));
+
+            std::string line;
+            DecodePrefix(line, record, strings, fileHeader.mPid);
+            DecodeArgs(line, LookupString(strings, record.mFormat),
+                       &buffer[sizeof(record)], size - sizeof(record));
+            if (gDebugFlags & PRINT_NEWLINE) {
+                line += '\n';
+            }
+
+            fwrite(line.data(), line.size(), 1, output);
+            count++;
+            break;
+        }
+
+        case RECORD_DROPPED: {
+            uint32_t dropped;
+            if (size < sizeof(header) + sizeof(dropped)) {
+                return -1;
+            }
+
+            memcpy(&dropped, &buffer[sizeof(header)], sizeof(dropped));
+            fprintf(output, "[binary log dropped %u records]\n", dropped);
+            break;
+        }
+
+        default:
+            // unknown records are skipped
+            break;
+        }
+    }
+
+    return count;
+}
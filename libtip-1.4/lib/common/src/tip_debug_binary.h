@@ -0,0 +1,71 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIP_DEBUG_BINARY_H
+#define TIP_DEBUG_BINARY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+namespace LibTip {
+
+    // asynchronous binary backend for AMDEBUG.  while it is running
+    // gDebugPrefixFunc and gDebugPrintfFunc are replaced by functions
+    // that format nothing and take no locks.  each log statement is
+    // encoded as a compact record (timestamp, area, function, file,
+    // line, format and the raw arguments) and appended to a ring
+    // buffer owned by the calling thread.  a background thread drains
+    // the rings into the output file, DebugBinaryDecode() turns the
+    // file back into text afterwards.
+    //
+    // area, function, file and format strings are recorded by
+    // address and their text is written to the file only once, so
+    // every format passed to AMDEBUG must be a string literal (all of
+    // the library's are).  %n is not supported.  a record that does
+    // not fit in its thread's ring is dropped and counted, a drop
+    // notice is written to the file in its place.
+    //
+    // like changing gDebugPrintfFunc directly, start and stop the
+    // backend while no other thread is logging.
+
+    // default size in bytes of each thread's ring
+    const uint32_t kDebugBinaryRingSize = (64 * 1024);
+
+    // start writing binary records to output, which is not closed by
+    // the library.  ringSize is rounded up to a power of 2.  returns
+    // 0 on success, -1 if already running or the drain thread could
+    // not be started.
+    int DebugBinaryStart(FILE* output, uint32_t ringSize = kDebugBinaryRingSize);
+
+    // write out everything logged so far, stop the drain thread and
+    // restore the previous output functions.
+    void DebugBinaryStop();
+
+    // wait until everything logged so far has been written to the
+    // output file.
+    void DebugBinaryFlush();
+
+    // number of records dropped because a ring was full
+    uint64_t DebugBinaryGetDropped();
+
+    // decode a binary log file into text.  the prefix of each line is
+    // controlled by gDebugFlags the same way as DebugPrefix().
+    // returns the number of log statements decoded, -1 if input is
+    // not a binary log or is corrupt.
+    int DebugBinaryDecode(FILE* input, FILE* output);
+};
+
+#endif
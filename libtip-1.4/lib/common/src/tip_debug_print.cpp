@@ -47,61 +47,92 @@ uint32_t LibTip::gDebugFlags = (
 LibTip::DebugPrintfFunc LibTip::gDebugPrintfFunc = &LibTip::DebugPrintf;
 LibTip::DebugPrefixFunc LibTip::gDebugPrefixFunc = &LibTip::DebugPrefix;
 
+// file locked by this thread's current log statement.  the default
+// prefix and printf functions write here rather than re-reading
+// gDebugOutput, which may have been swapped since it was locked.
+static __thread FILE* gLockedOutput = NULL;
+
+static FILE* GetOutput()
+{
+    return (gLockedOutput != NULL ? gLockedOutput : LibTip::gDebugOutput);
+}
+
+FILE* LibTip::DebugLock()
+{
+    FILE* output = gDebugOutput;
+    if (output != NULL) {
+        flockfile(output);
+    }
+
+    gLockedOutput = output;
+    return output;
+}
+
+void LibTip::DebugUnlock(FILE* output)
+{
+    gLockedOutput = NULL;
+    if (output != NULL) {
+        funlockfile(output);
+    }
+}
+
 void LibTip::DebugPrefix(const char* inFunction, const char* area,
                          const char* inFile, int inLine)
 {
-    if (!(gDebugFlags & PRINT_ENABLE)) {
+    FILE* output = GetOutput();
+    if (!(gDebugFlags & PRINT_ENABLE) || output == NULL) {
         return;
     }
     
 	if (gDebugFlags & (PRINT_TIME | PRINT_DATE)) {
 		struct timeval now;
+		struct tm tm;
 		char buffer[128];
 		
 		(void) gettimeofday(&now, NULL);
 		
 		if ((gDebugFlags & (PRINT_TIME | PRINT_DATE)) == (PRINT_TIME | PRINT_DATE)) {
 			if (gDebugFlags & PRINT_UTC) {
-				(void) strftime(buffer, sizeof(buffer), DEBUG_DATE_TIME_FORMAT, gmtime(&now.tv_sec));
+				(void) strftime(buffer, sizeof(buffer), DEBUG_DATE_TIME_FORMAT, gmtime_r(&now.tv_sec, &tm));
 			} else {
-				(void) strftime(buffer, sizeof(buffer), DEBUG_DATE_TIME_FORMAT, localtime(&now.tv_sec));
+				(void) strftime(buffer, sizeof(buffer), DEBUG_DATE_TIME_FORMAT, localtime_r(&now.tv_sec, &tm));
 			}
-			fprintf(gDebugOutput, "%s.%03lu: ", buffer, now.tv_usec / (long unsigned int) 1000);
+			fprintf(output, "%s.%03lu: ", buffer, now.tv_usec / (long unsigned int) 1000);
 		} else if (gDebugFlags & PRINT_TIME) {
 			if (gDebugFlags & PRINT_UTC) {
-				(void) strftime(buffer, sizeof(buffer), DEBUG_TIME_FORMAT, gmtime(&now.tv_sec));
+				(void) strftime(buffer, sizeof(buffer), DEBUG_TIME_FORMAT, gmtime_r(&now.tv_sec, &tm));
 			} else {
-				(void) strftime(buffer, sizeof(buffer), DEBUG_TIME_FORMAT, localtime(&now.tv_sec));
+				(void) strftime(buffer, sizeof(buffer), DEBUG_TIME_FORMAT, localtime_r(&now.tv_sec, &tm));
 			}
-			fprintf(gDebugOutput, "%s.%03lu: ", buffer, now.tv_usec / (long unsigned int) 1000);
+			fprintf(output, "%s.%03lu: ", buffer, now.tv_usec / (long unsigned int) 1000);
 		} else { // just want the date
 			if (gDebugFlags & PRINT_UTC) {
-				(void) strftime(buffer, sizeof(buffer), DEBUG_DATE_FORMAT, gmtime(&now.tv_sec));
+				(void) strftime(buffer, sizeof(buffer), DEBUG_DATE_FORMAT, gmtime_r(&now.tv_sec, &tm));
 			} else {
-				(void) strftime(buffer, sizeof(buffer), DEBUG_DATE_FORMAT, localtime(&now.tv_sec));
+				(void) strftime(buffer, sizeof(buffer), DEBUG_DATE_FORMAT, localtime_r(&now.tv_sec, &tm));
 			}
-			fprintf(gDebugOutput, "%s: ", buffer);
+			fprintf(output, "%s: ", buffer);
 		}
 	}
 
 	if (gDebugFlags & PRINT_PROC) {
-		fprintf(gDebugOutput, "[pid %u] ", getpid());
+		fprintf(output, "[pid %u] ", getpid());
 	}
 	
 	if (gDebugFlags & PRINT_AREA) {
-        fprintf(gDebugOutput, "[%-6.6s] ", area);
+        fprintf(output, "[%-6.6s] ", area);
 	}
     
 	if (gDebugFlags & PRINT_FUNCTION) {
-		fprintf(gDebugOutput, "%s ", inFunction);
+		fprintf(output, "%s ", inFunction);
 	}
 	
 	if (gDebugFlags & PRINT_FILE) {
-		fprintf(gDebugOutput, "%s ", inFile);
+		fprintf(output, "%s ", inFile);
 	}
 	
 	if (gDebugFlags & PRINT_LINE) {
-		fprintf(gDebugOutput, "%u ", inLine);
+		fprintf(output, "%u ", inLine);
 	}
 
 	return;
@@ -109,19 +140,20 @@ void LibTip::DebugPrefix(const char* inFunction, const char* area,
   
 void LibTip::DebugPrintf(const char* inFmt, ...)
 {
-    if (!(gDebugFlags & PRINT_ENABLE)) {
+    FILE* output = GetOutput();
+    if (!(gDebugFlags & PRINT_ENABLE) || output == NULL) {
         return;
     }
     
 	va_list ap;
 	va_start(ap, inFmt);
-	vfprintf(gDebugOutput, inFmt, ap);
+	vfprintf(output, inFmt, ap);
 	va_end(ap);
 	
 	if (gDebugFlags & PRINT_NEWLINE) {
-		fprintf(gDebugOutput, "\n");
+		fprintf(output, "\n");
 	}
 
-	(void) fflush(gDebugOutput);
+	(void) fflush(output);
 	return;
 }
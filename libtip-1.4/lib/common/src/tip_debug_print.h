@@ -55,6 +55,23 @@ namespace LibTip {
     };
     extern uint32_t gDebugAreas;
 
+    /**
+     * Debug areas compiled in.  Log statements in any other area are
+     * removed at compile time along with their strings and arguments,
+     * whatever gDebugAreas is set to.  Set by the configure option
+     * --with-debug-areas, by default every area is compiled in.
+     */
+#ifndef AMDEBUG_COMPILED_AREAS
+#define AMDEBUG_COMPILED_AREAS 0xFFFFFFFF
+#endif
+
+    /**
+     * True if log statements in the given area are compiled in.  This
+     * is a constant expression.
+     */
+#define AMDEBUG_COMPILED(area)                                                         \
+    ((AMDEBUG_COMPILED_AREAS & LibTip::DEBUG_##area) == LibTip::DEBUG_##area)
+
     /**
      * Output file.  Debug output is written to this file, by default
      * stdout.
@@ -81,15 +98,40 @@ namespace LibTip {
     extern DebugPrefixFunc gDebugPrefixFunc;
 
     
+    /**
+     * Output locking.  Each log statement that will produce output is
+     * written while holding the stdio lock of gDebugOutput so
+     * statements made by sessions running on different threads do
+     * not interleave.  The default prefix and printf functions write
+     * to the locked file.  Custom output functions are serialized by
+     * the same lock.
+     *
+     * @return the locked file, NULL if there is no output file
+     */
+    FILE* DebugLock();
+    void DebugUnlock(FILE* output);
+    
+    /**
+     * True if a log statement in the given area would produce any
+     * output.  Can be used to skip building expensive log arguments.
+     */
+#define AMDEBUG_ENABLED(area)                                                          \
+    (AMDEBUG_COMPILED(area) &&                                                         \
+     ((LibTip::gDebugAreas & LibTip::DEBUG_##area) == LibTip::DEBUG_##area) &&      \
+     ((LibTip::gDebugFlags & LibTip::PRINT_ENABLE) ||                                \
+      LibTip::gDebugPrintfFunc != &LibTip::DebugPrintf))
+    
 #define AMDEBUG(area, args)                                                            \
     do {                                                                               \
-        if ((LibTip::gDebugAreas & LibTip::DEBUG_##area) == LibTip::DEBUG_##area) { \
+        if (AMDEBUG_ENABLED(area)) {                                                   \
+            FILE* amdebugOutput = LibTip::DebugLock();                                 \
             if (LibTip::gDebugFlags & LibTip::PRINT_FULL_FUNCTION) {             \
                 LibTip::gDebugPrefixFunc(__PRETTY_FUNCTION__, #area, __FILE__, __LINE__);\
             } else {                                                                   \
                 LibTip:: gDebugPrefixFunc(__FUNCTION__, #area, __FILE__, __LINE__); \
             }                                                                          \
             LibTip::gDebugPrintfFunc args;                                          \
+            LibTip::DebugUnlock(amdebugOutput);                                        \
         }                                                                              \
     } while (0);
 
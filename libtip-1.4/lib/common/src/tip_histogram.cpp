@@ -0,0 +1,204 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tip_histogram.h"
+using namespace LibTip;
+
+// the writer is the only thread modifying a histogram so updates are
+// a plain load and store, atomic only so readers never see a torn
+// value
+template <typename T>
+static inline T LoadRelaxed(const T& field)
+{
+    return __atomic_load_n(&field, __ATOMIC_RELAXED);
+}
+
+template <typename T>
+static inline void StoreRelaxed(T& field, T value)
+{
+    __atomic_store_n(&field, value, __ATOMIC_RELAXED);
+}
+
+CTipHistogram::CTipHistogram()
+{
+    Reset();
+}
+
+CTipHistogram::CTipHistogram(const CTipHistogram& other)
+{
+    *this = other;
+}
+
+CTipHistogram& CTipHistogram::operator=(const CTipHistogram& other)
+{
+    if (this == &other) {
+        return *this;
+    }
+    
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++) {
+        StoreRelaxed(mBuckets[i], LoadRelaxed(other.mBuckets[i]));
+    }
+
+    StoreRelaxed(mCount, LoadRelaxed(other.mCount));
+    StoreRelaxed(mSum, LoadRelaxed(other.mSum));
+    StoreRelaxed(mMin, LoadRelaxed(other.mMin));
+    StoreRelaxed(mMax, LoadRelaxed(other.mMax));
+
+    return *this;
+}
+
+void CTipHistogram::Add(uint32_t value)
+{
+    uint32_t index = GetBucketIndex(value);
+    uint64_t count = mCount;
+    
+    StoreRelaxed(mBuckets[index], (mBuckets[index] + 1));
+    StoreRelaxed(mSum, (mSum + value));
+    
+    if (count == 0 || value < mMin) {
+        StoreRelaxed(mMin, value);
+    }
+    if (count == 0 || value > mMax) {
+        StoreRelaxed(mMax, value);
+    }
+
+    StoreRelaxed(mCount, (count + 1));
+}
+
+void CTipHistogram::Reset()
+{
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++) {
+        StoreRelaxed(mBuckets[i], (uint32_t) 0);
+    }
+
+    StoreRelaxed(mCount, (uint64_t) 0);
+    StoreRelaxed(mSum, (uint64_t) 0);
+    StoreRelaxed(mMin, (uint32_t) 0);
+    StoreRelaxed(mMax, (uint32_t) 0);
+}
+
+uint64_t CTipHistogram::GetCount() const
+{
+    return LoadRelaxed(mCount);
+}
+
+uint64_t CTipHistogram::GetSum() const
+{
+    return LoadRelaxed(mSum);
+}
+
+uint32_t CTipHistogram::GetMin() const
+{
+    return LoadRelaxed(mMin);
+}
+
+uint32_t CTipHistogram::GetMax() const
+{
+    return LoadRelaxed(mMax);
+}
+
+uint32_t CTipHistogram::GetMean() const
+{
+    uint64_t count = GetCount();
+    if (count == 0) {
+        return 0;
+    }
+
+    return (uint32_t) (GetSum() / count);
+}
+
+uint32_t CTipHistogram::GetValueAtPercentile(double percentile) const
+{
+    if (percentile < 0.0) {
+        percentile = 0.0;
+    } else if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+
+    // total from the buckets themselves so a racing writer cannot
+    // leave the walk short
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++) {
+        total += LoadRelaxed(mBuckets[i]);
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    // rank of the sample we want, at least the first one
+    uint64_t rank = (uint64_t) ((percentile * total) / 100.0 + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    
+    uint32_t max = GetMax();
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++) {
+        seen += LoadRelaxed(mBuckets[i]);
+        if (seen >= rank) {
+            uint32_t high = GetBucketHigh(i);
+            return (high < max ? high : max);
+        }
+    }
+
+    return max;
+}
+
+uint32_t CTipHistogram::GetBucketCount(uint32_t index) const
+{
+    if (index >= NUM_BUCKETS) {
+        return 0;
+    }
+
+    return LoadRelaxed(mBuckets[index]);
+}
+
+uint32_t CTipHistogram::GetBucketIndex(uint32_t value)
+{
+    if (value < SUB_BUCKETS) {
+        return value;
+    }
+
+    // shift the leading one down to the top sub bucket bit, what is
+    // left below it selects the linear bucket within the power of two
+    uint32_t shift = ((31 - __builtin_clz(value)) - SUB_BUCKET_BITS);
+    return (((shift + 1) << SUB_BUCKET_BITS) + ((value >> shift) - SUB_BUCKETS));
+}
+
+uint32_t CTipHistogram::GetBucketLow(uint32_t index)
+{
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    if (index >= NUM_BUCKETS) {
+        index = (NUM_BUCKETS - 1);
+    }
+    
+    uint32_t shift = ((index >> SUB_BUCKET_BITS) - 1);
+    return ((SUB_BUCKETS + (index & (SUB_BUCKETS - 1))) << shift);
+}
+
+uint32_t CTipHistogram::GetBucketHigh(uint32_t index)
+{
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    if (index >= NUM_BUCKETS) {
+        index = (NUM_BUCKETS - 1);
+    }
+    
+    uint32_t shift = ((index >> SUB_BUCKET_BITS) - 1);
+    return (GetBucketLow(index) + ((1 << shift) - 1));
+}
@@ -0,0 +1,86 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TIP_HISTOGRAM_H
+#define TIP_HISTOGRAM_H
+
+#include <stdint.h>
+
+namespace LibTip {
+
+    // histogram of 32 bit values with a bounded relative error, laid
+    // out like HdrHistogram.  values below SUB_BUCKETS get a bucket
+    // of their own, above that every power of two is split into
+    // SUB_BUCKETS linear buckets so a bucket is never wider than
+    // 1/16th (6.25%) of the values it holds.
+    //
+    // a histogram has a single writer.  every field is written with
+    // a relaxed atomic store so other threads may read it (or copy
+    // it) at any time without locking.  a reader racing the writer
+    // can see a sample in the total but not yet in its bucket or
+    // vice versa, never a torn value.
+    class CTipHistogram {
+    public:
+        CTipHistogram();
+
+        // copies use relaxed atomic loads so the source may be
+        // updated while it is copied
+        CTipHistogram(const CTipHistogram& other);
+        CTipHistogram& operator=(const CTipHistogram& other);
+
+        static const uint32_t SUB_BUCKET_BITS = 4;
+        static const uint32_t SUB_BUCKETS     = (1 << SUB_BUCKET_BITS);
+        static const uint32_t NUM_BUCKETS     = ((33 - SUB_BUCKET_BITS) * SUB_BUCKETS);
+
+        // add a sample, writer only
+        void Add(uint32_t value);
+
+        // forget all samples, writer only
+        void Reset();
+
+        // number of samples and their sum
+        uint64_t GetCount() const;
+        uint64_t GetSum() const;
+
+        // smallest, largest and mean sample, 0 if there are none
+        uint32_t GetMin() const;
+        uint32_t GetMax() const;
+        uint32_t GetMean() const;
+
+        // value at or below which percentile (0 - 100) percent of
+        // the samples fall.  this is the largest value of the bucket
+        // holding that sample, capped at GetMax().  returns 0 if
+        // there are no samples.
+        uint32_t GetValueAtPercentile(double percentile) const;
+
+        // number of samples in bucket index
+        uint32_t GetBucketCount(uint32_t index) const;
+
+        // bucket a value falls in and the range of values a bucket
+        // holds
+        static uint32_t GetBucketIndex(uint32_t value);
+        static uint32_t GetBucketLow(uint32_t index);
+        static uint32_t GetBucketHigh(uint32_t index);
+
+    protected:
+        uint32_t mBuckets[NUM_BUCKETS];
+        uint64_t mCount;
+        uint64_t mSum;
+        uint32_t mMin;
+        uint32_t mMax;
+    };
+};
+
+#endif
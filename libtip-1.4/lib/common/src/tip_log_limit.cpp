@@ -0,0 +1,59 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tip_log_limit.h"
+using namespace LibTip;
+
+CTipLogLimiter::CTipLogLimiter()
+{
+    SetLimit(0, 0);
+}
+
+void CTipLogLimiter::SetLimit(uint32_t count, uint32_t intervalMS)
+{
+    mCount       = count;
+    mInterval    = intervalMS;
+    mWindowStart = 0;
+    mWindowCount = 0;
+    mSuppressed  = 0;
+}
+
+bool CTipLogLimiter::Allow(uint64_t now, uint32_t& suppressed)
+{
+    suppressed = 0;
+    
+    if (mCount == 0) {
+        return true;
+    }
+
+    // start a new interval with the first statement after the last
+    // one ran out
+    if (mWindowCount == 0 || (now - mWindowStart) >= mInterval) {
+        mWindowStart = now;
+        mWindowCount = 0;
+    }
+
+    if (mWindowCount >= mCount) {
+        mSuppressed++;
+        return false;
+    }
+
+    mWindowCount++;
+    suppressed  = mSuppressed;
+    mSuppressed = 0;
+    
+    return true;
+}
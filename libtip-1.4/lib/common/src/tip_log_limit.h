@@ -0,0 +1,57 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIP_LOG_LIMIT_H
+#define TIP_LOG_LIMIT_H
+
+#include <stdint.h>
+
+namespace LibTip {
+
+    // limits how often a class of log statements (e.g. packet dumps)
+    // is printed.  at most count statements are allowed in each
+    // interval, the rest are counted as suppressed so the total can
+    // be reported with the next statement that is allowed.  all
+    // times are in milliseconds.
+    class CTipLogLimiter {
+    public:
+        CTipLogLimiter();
+
+        // allow at most count statements per intervalMS.  a count of
+        // 0 (the default) removes the limit.
+        void SetLimit(uint32_t count, uint32_t intervalMS);
+
+        uint32_t GetCount() const { return mCount; }
+        uint32_t GetInterval() const { return mInterval; }
+        
+        // check whether a statement made at time now may be printed.
+        // if it may, suppressed is set to the number of statements
+        // suppressed since the last one allowed.
+        bool Allow(uint64_t now, uint32_t& suppressed);
+
+        // number of statements suppressed and not yet reported
+        uint32_t GetSuppressed() const { return mSuppressed; }
+        
+    protected:
+        uint32_t mCount;
+        uint32_t mInterval;
+        uint64_t mWindowStart;
+        uint32_t mWindowCount;
+        uint32_t mSuppressed;
+    };
+};
+
+#endif
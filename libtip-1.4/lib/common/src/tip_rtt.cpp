@@ -0,0 +1,87 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tip_rtt.h"
+using namespace LibTip;
+
+// clock granularity in milliseconds
+static const uint32_t kRttClockGranularity = 1;
+
+// largest sample accepted, keeps the scaled values from overflowing
+static const uint32_t kRttMaxSample = 0x0FFFFFFF;
+
+CTipRttEstimator::CTipRttEstimator(uint32_t minRto, uint32_t maxRto)
+{
+    SetBounds(minRto, maxRto);
+    Reset();
+}
+
+void CTipRttEstimator::SetBounds(uint32_t minRto, uint32_t maxRto)
+{
+    mMinRto = minRto;
+    mMaxRto = (maxRto < minRto ? minRto : maxRto);
+}
+
+void CTipRttEstimator::Reset()
+{
+    mSrtt8      = 0;
+    mRttvar4    = 0;
+    mHaveSample = false;
+    mNumSamples = 0;
+}
+
+void CTipRttEstimator::AddSample(uint32_t rtt)
+{
+    if (rtt > kRttMaxSample) {
+        rtt = kRttMaxSample;
+    }
+    
+    if (! mHaveSample) {
+        // first measurement, SRTT = R and RTTVAR = R / 2
+        mSrtt8      = (rtt << 3);
+        mRttvar4    = (rtt << 1);
+        mHaveSample = true;
+    } else {
+        // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R| using the old SRTT,
+        // then SRTT = 7/8 SRTT + 1/8 R
+        uint32_t srtt = (mSrtt8 >> 3);
+        uint32_t err  = (srtt > rtt ? (srtt - rtt) : (rtt - srtt));
+
+        mRttvar4 = mRttvar4 - (mRttvar4 >> 2) + err;
+        mSrtt8   = mSrtt8 - (mSrtt8 >> 3) + rtt;
+    }
+
+    mNumSamples++;
+}
+
+uint32_t CTipRttEstimator::GetRTO() const
+{
+    if (! mHaveSample) {
+        return 0;
+    }
+
+    // mRttvar4 is already 4 * RTTVAR
+    uint32_t var = (mRttvar4 > kRttClockGranularity ? mRttvar4 : kRttClockGranularity);
+    uint32_t rto = (mSrtt8 >> 3) + var;
+
+    if (rto < mMinRto) {
+        rto = mMinRto;
+    } else if (rto > mMaxRto) {
+        rto = mMaxRto;
+    }
+
+    return rto;
+}
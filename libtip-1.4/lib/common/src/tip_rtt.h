@@ -0,0 +1,77 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIP_RTT_H
+#define TIP_RTT_H
+
+#include <stdint.h>
+
+namespace LibTip {
+
+    // round trip time estimator following RFC 6298.  keeps a smoothed
+    // round trip time (SRTT) and its variation (RTTVAR) and derives a
+    // retransmission timeout (RTO) from them.  all times are in
+    // milliseconds.
+    class CTipRttEstimator {
+    public:
+        CTipRttEstimator(uint32_t minRto = DEFAULT_MIN_RTO,
+                         uint32_t maxRto = DEFAULT_MAX_RTO);
+
+        // default bounds on the RTO.  RFC 6298 recommends a 1 second
+        // floor which is far above the 250ms TIP default, so the floor
+        // is left to the user.
+        static const uint32_t DEFAULT_MIN_RTO = 50;
+        static const uint32_t DEFAULT_MAX_RTO = 60000;
+        
+        // set the bounds on the RTO
+        void SetBounds(uint32_t minRto, uint32_t maxRto);
+
+        uint32_t GetMinRto() const { return mMinRto; }
+        uint32_t GetMaxRto() const { return mMaxRto; }
+        
+        // add a round trip time measurement.  callers must follow
+        // Karn's rule and never sample retransmitted packets.
+        void AddSample(uint32_t rtt);
+
+        // forget all samples
+        void Reset();
+
+        // true once at least one sample has been added
+        bool HasSample() const { return mHaveSample; }
+
+        uint32_t GetNumSamples() const { return mNumSamples; }
+        
+        // smoothed round trip time and variation, 0 if no samples
+        uint32_t GetSRTT() const { return (mSrtt8 >> 3); }
+        uint32_t GetRTTVAR() const { return (mRttvar4 >> 2); }
+
+        // retransmission timeout, SRTT + max(G, 4 * RTTVAR) clamped to
+        // the configured bounds.  returns 0 if there are no samples.
+        uint32_t GetRTO() const;
+
+    protected:
+        // SRTT scaled by 8 and RTTVAR scaled by 4 so the 1/8 and 1/4
+        // gains are exact in integer math
+        uint32_t mSrtt8;
+        uint32_t mRttvar4;
+        bool     mHaveSample;
+        uint32_t mNumSamples;
+        uint32_t mMinRto;
+        uint32_t mMaxRto;
+    };
+};
+
+#endif
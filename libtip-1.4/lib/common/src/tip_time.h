@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <time.h>
 
 namespace LibTip {
 
@@ -48,10 +49,82 @@ namespace LibTip {
         return GetUsecTimestampFromTimeval(&tv);
     }
 
+    // interface for the millisecond clock used for timers and
+    // retransmissions.  only differences between values are used so
+    // the clock does not need to be related to wall clock time.
+    // users can install their own (e.g. one driven by their event
+    // loop) with SetClock().
+    class CTipClock {
+    public:
+        CTipClock() {}
+        virtual ~CTipClock() {}
+
+        // get the current time in milliseconds
+        virtual uint64_t GetMsec() = 0;
+    };
+
+    // install a clock, NULL restores the default monotonic clock.
+    // the clock is not owned by the library.
+    void SetClock(CTipClock* clock);
+
+    // the installed clock, NULL when using the default
+    extern CTipClock* gpClock;
+    
+    // cached time for this thread, only valid while gCachedValid is
+    // set.  0 is a legal time for a user clock so it cannot be used
+    // to mean "nothing cached".
+    extern __thread uint64_t gCachedMsec;
+    extern __thread bool gCachedValid;
+    
+    // default clock, milliseconds from a monotonic source.  note
+    // that CLOCK_MONOTONIC_COARSE only moves once per kernel tick
+    // which is too slow for 1ms retransmission intervals.
+    inline uint64_t GetMonotonicMsec() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ((((uint64_t) ts.tv_sec) * kMsecTimeScale) +
+                (((uint64_t) ts.tv_nsec) / (kNsecTimeScale / kMsecTimeScale)));
+    }
+    
     inline uint64_t GetMsecTimestamp() {
-        return RescaleTimestamp(GetUsecTimestamp(), kUsecTimeScale, kMsecTimeScale);
+        if (gCachedValid) {
+            return gCachedMsec;
+        }
+
+        if (gpClock != NULL) {
+            return gpClock->GetMsec();
+        }
+        
+        return GetMonotonicMsec();
     }
 
+    // caches the current millisecond time for this thread while in
+    // scope so that all timer and retransmission checks done while
+    // handling one event see the same "now" and read the clock once.
+    // nested instances keep the outer value.
+    class CTipTimeCache {
+    public:
+        CTipTimeCache() : mOwner(! gCachedValid) {
+            if (mOwner) {
+                gCachedMsec  = GetMsecTimestamp();
+                gCachedValid = true;
+            }
+        }
+        
+        ~CTipTimeCache() {
+            if (mOwner) {
+                gCachedValid = false;
+            }
+        }
+
+    private:
+        bool mOwner;
+
+        // do not allow copy or assignment
+        CTipTimeCache(const CTipTimeCache&);
+        CTipTimeCache& operator=(const CTipTimeCache&);
+    };
+
     inline uint64_t GetNtpTimestampFromTimeval(struct timeval* pTimeval) {
         const uint64_t kNtpToUnixTime = 2208988800LL;
         
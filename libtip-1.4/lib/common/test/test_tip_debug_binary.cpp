@@ -0,0 +1,338 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+// the statements below exercise the backend itself, keep them whatever
+// debug areas the library is built with
+#undef AMDEBUG_COMPILED_AREAS
+
+#include "tip_debug_print.h"
+#include "tip_debug_binary.h"
+using namespace LibTip;
+
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+static const uint32_t kThreadRecords = 1000;
+
+static void* LogThread(void* arg)
+{
+    long id = (long) arg;
+    for (uint32_t i = 0; i < kThreadRecords; i++) {
+        AMDEBUG(USER, ("thread %ld seq %u", id, i));
+    }
+
+    return NULL;
+}
+
+class CTipDebugBinaryTest : public CppUnit::TestFixture {
+private:
+    FILE* log;
+    uint32_t savedFlags;
+    uint32_t savedAreas;
+
+    // decode the log written so far into text
+    std::string Decode(int& count) {
+        FILE* text = tmpfile();
+        CPPUNIT_ASSERT( text != NULL );
+
+        rewind(log);
+        count = DebugBinaryDecode(log, text);
+
+        std::string out;
+        char buffer[4096];
+        size_t len;
+        rewind(text);
+        while ((len = fread(buffer, 1, sizeof(buffer), text)) > 0) {
+            out.append(buffer, len);
+        }
+        fclose(text);
+        
+        return out;
+    }
+    
+public:
+    void setUp() {
+        savedFlags = gDebugFlags;
+        savedAreas = gDebugAreas;
+        if (getenv("TEST_TIP_DEBUG") == NULL) {
+            gDebugFlags = 0;
+        }
+        gDebugAreas = DEBUG_ALL;
+
+        log = tmpfile();
+        CPPUNIT_ASSERT( log != NULL );
+    }
+
+    void tearDown() {
+        DebugBinaryStop();
+        fclose(log);
+        gDebugFlags = savedFlags;
+        gDebugAreas = savedAreas;
+    }
+
+    void testStartStop() {
+        DebugPrefixFunc prefix = gDebugPrefixFunc;
+        DebugPrintfFunc print = gDebugPrintfFunc;
+        FILE* output = gDebugOutput;
+
+        CPPUNIT_ASSERT_EQUAL( DebugBinaryStart(log), 0 );
+        CPPUNIT_ASSERT( gDebugPrefixFunc != prefix );
+        CPPUNIT_ASSERT( gDebugPrintfFunc != print );
+        CPPUNIT_ASSERT( gDebugOutput == NULL );
+        CPPUNIT_ASSERT( AMDEBUG_ENABLED(USER) );
+
+        // only one backend at a time
+        CPPUNIT_ASSERT_EQUAL( DebugBinaryStart(log), -1 );
+
+        DebugBinaryStop();
+        CPPUNIT_ASSERT( gDebugPrefixFunc == prefix );
+        CPPUNIT_ASSERT( gDebugPrintfFunc == print );
+        CPPUNIT_ASSERT( gDebugOutput == output );
+
+        int count;
+        CPPUNIT_ASSERT_EQUAL( Decode(count), std::string() );
+        CPPUNIT_ASSERT_EQUAL( count, 0 );
+    }
+
+    void testRoundTrip() {
+        CPPUNIT_ASSERT_EQUAL( DebugBinaryStart(log), 0 );
+        AMDEBUG(USER, ("int %d neg %i hex 0x%08x str %s", 42, -7, 0xbeef, "hello"));
+        AMDEBUG(TIPNEG, ("%lu %lld %zu %.2f %c [%5s] [%-4d] %%", 123456789UL,
+                         -1234567890123LL, (size_t) 77, 3.14159, 'z', "ab", 9));
+        AMDEBUG(PKTERR, ("%hhu %hd %p %Lg", 300, 70000, (void*) 0x1234, (long double) 0.5));
+        AMDEBUG(XMIT, ("no arguments"));
+        DebugBinaryStop();
+
+        char expect[1024];
+        snprintf(expect, sizeof(expect),
+                 "int %d neg %i hex 0x%08x str %s\n"
+                 "%lu %lld %zu %.2f %c [%5s] [%-4d] %%\n"
+                 "%hhu %hd %p %Lg\n"
+                 "no arguments\n",
+                 42, -7, 0xbeef, "hello",
+                 123456789UL, -1234567890123LL, (size_t) 77, 3.14159, 'z', "ab", 9,
+                 300, 70000, (void*) 0x1234, (long double) 0.5);
+
+        gDebugFlags = PRINT_NEWLINE;
+        int count;
+        CPPUNIT_ASSERT_EQUAL( Decode(count), std::string(expect) );
+        CPPUNIT_ASSERT_EQUAL( count, 4 );
+    }
+
+    void testStarsAndStrings() {
+        char unterminated[4] = { 'a', 'b', 'c', 'd' };
+        const char* none = NULL;
+        
+        CPPUNIT_ASSERT_EQUAL( DebugBinaryStart(log), 0 );
+        AMDEBUG(USER, ("[%*d] [%-*.*s] [%.3s] [%.*s] [%s]", 6, 12, 8, 2, "xyz",
+                       "truncate", 4, unterminated, none));
+        DebugBinaryStop();
+
+        gDebugFlags = 0;
+        int count;
+        CPPUNIT_ASSERT_EQUAL( Decode(count),
+                              std::string("[    12] [xy      ] [tru] [abcd] [(null)]") );
+    }
+
+    void testManyArgs() {
+        CPPUNIT_ASSERT_EQUAL( DebugBinaryStart(log), 0 );
+        for (int i = 0; i < 2; i++) {
+            AMDEBUG(USER, ("%d %d %d %d %d %d %d %d %d %d %d %d %d %s %d",
+                           1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, "fourteen", i));
+        }
+        DebugBinaryStop();
+
+        gDebugFlags = PRINT_NEWLINE;
+        int count;
+        CPPUNIT_ASSERT_EQUAL( Decode(count),
+                              std::string("1 2 3 4 5 6 7 8 9 10 11 12 13 fourteen 0\n"
+                                          "1 2 3 4 5 6 7 8 9 10 11 12 13 fourteen 1\n") );
+    }
+
+    void testLongString() {
+        std::string big(4000, 'x');
+
+        CPPUNIT_ASSERT_EQUAL( DebugBinaryStart(log), 0 );
+        AMDEBUG(USER, ("%s|%d", big.c_str(), 5));
+        DebugBinaryStop();
+
+        // the string is cut to fit the record, the rest of the format
+        // is printed as is
+        gDebugFlags = 0;
+        int count;
+        std::string out = Decode(count);
+        CPPUNIT_ASSERT_EQUAL( count, 1 );
+        CPPUNIT_ASSERT( out.size() > 900 );
+        CPPUNIT_ASSERT( out.size() < 1024 );
+        CPPUNIT_ASSERT_EQUAL( out.find_first_not_of('x'), out.size() - 3 );
+        CPPUNIT_ASSERT_EQUAL( out.substr(out.size() - 3), std::string("|%d") );
+    }
+
+    void testPrefix() {
+        CPPUNIT_ASSERT_EQUAL( DebugBinaryStart(log), 0 );
+        int line = __LINE__; AMDEBUG(TIPNEG, ("value %u", 17));
+        DebugBinaryStop();
+
+        gDebugFlags = (PRINT_PROC | PRINT_AREA | PRINT_FUNCTION | PRINT_FILE |
+                       PRINT_LINE | PRINT_NEWLINE);
+        char expect[1024];
+        snprintf(expect, sizeof(expect), "[pid %u] [TIPNEG] testPrefix %s %u value 17\n",
+                 getpid(), __FILE__, line);
+
+        int count;
+        CPPUNIT_ASSERT_EQUAL( Decode(count), std::string(expect) );
+
+        // time stamps are formatted like DebugPrefix
+        gDebugFlags = (PRINT_TIME | PRINT_DATE | PRINT_UTC);
+        std::string out = Decode(count);
+        CPPUNIT_ASSERT_EQUAL( out.size(), strlen("YYYY-MM-DD HH:MM:SS.mmm: value 17") );
+        CPPUNIT_ASSERT_EQUAL( out.substr(19, 1), std::string(".") );
+        CPPUNIT_ASSERT_EQUAL( out.substr(23), std::string(": value 17") );
+    }
+
+    void testFlush() {
+        CPPUNIT_ASSERT_EQUAL( DebugBinaryStart(log), 0 );
+        AMDEBUG(USER, ("before flush"));
+        DebugBinaryFlush();
+
+        // written while the backend is still running
+        gDebugFlags = 0;
+        int count;
+        CPPUNIT_ASSERT_EQUAL( Decode(count), std::string("before flush") );
+        fseek(log, 0, SEEK_END);
+    }
+
+    void testThreads() {
+        const long kNumThreads = 4;
+        pthread_t threads[kNumThreads];
+
+        CPPUNIT_ASSERT_EQUAL( DebugBinaryStart(log, 1 << 20), 0 );
+        for (long i = 0; i < kNumThreads; i++) {
+            CPPUNIT_ASSERT_EQUAL( pthread_create(&threads[i], NULL, LogThread, (void*) i), 0 );
+        }
+        for (long i = 0; i < kNumThreads; i++) {
+            pthread_join(threads[i], NULL);
+        }
+
+        // rings of exited threads are reused
+        LogThread((void*) kNumThreads);
+        DebugBinaryStop();
+        CPPUNIT_ASSERT_EQUAL( DebugBinaryGetDropped(), (uint64_t) 0 );
+
+        gDebugFlags = PRINT_NEWLINE;
+        int count;
+        std::string out = Decode(count);
+        CPPUNIT_ASSERT_EQUAL( count, (int) ((kNumThreads + 1) * kThreadRecords) );
+
+        // each thread's statements come out in order
+        std::vector<uint32_t> next(kNumThreads + 1, 0);
+        size_t pos = 0;
+        while (pos < out.size()) {
+            size_t end = out.find('\n', pos);
+            CPPUNIT_ASSERT( end != std::string::npos );
+
+            long id;
+            uint32_t seq;
+            CPPUNIT_ASSERT_EQUAL( sscanf(out.c_str() + pos, "thread %ld seq %u", &id, &seq), 2 );
+            CPPUNIT_ASSERT( id >= 0 && id <= kNumThreads );
+            CPPUNIT_ASSERT_EQUAL( seq, next[id] );
+            next[id]++;
+            pos = end + 1;
+        }
+    }
+
+    void testDropped() {
+        const uint32_t kRecords = 10000;
+        std::string big(900, 'x');
+
+        // the smallest ring only holds a few of these
+        CPPUNIT_ASSERT_EQUAL( DebugBinaryStart(log, 0), 0 );
+        for (uint32_t i = 0; i < kRecords; i++) {
+            AMDEBUG(USER, ("%s", big.c_str()));
+        }
+        DebugBinaryStop();
+
+        uint64_t dropped = DebugBinaryGetDropped();
+        CPPUNIT_ASSERT( dropped > 0 );
+
+        gDebugFlags = PRINT_NEWLINE;
+        int count;
+        std::string out = Decode(count);
+        CPPUNIT_ASSERT_EQUAL( count + dropped, (uint64_t) kRecords );
+
+        // the drop notices add up
+        uint64_t noted = 0;
+        size_t pos = 0;
+        while ((pos = out.find("[binary log dropped ", pos)) != std::string::npos) {
+            uint32_t n;
+            CPPUNIT_ASSERT_EQUAL( sscanf(out.c_str() + pos, "[binary log dropped %u", &n), 1 );
+            noted += n;
+            pos++;
+        }
+        CPPUNIT_ASSERT_EQUAL( noted, dropped );
+    }
+
+    void testRestart() {
+        CPPUNIT_ASSERT_EQUAL( DebugBinaryStart(log), 0 );
+        AMDEBUG(USER, ("first %d", 1));
+        DebugBinaryStop();
+
+        FILE* second = tmpfile();
+        CPPUNIT_ASSERT_EQUAL( DebugBinaryStart(second), 0 );
+        AMDEBUG(USER, ("second %d", 2));
+        DebugBinaryStop();
+
+        gDebugFlags = 0;
+        int count;
+        CPPUNIT_ASSERT_EQUAL( Decode(count), std::string("first 1") );
+
+        fclose(log);
+        log = second;
+        CPPUNIT_ASSERT_EQUAL( Decode(count), std::string("second 2") );
+    }
+
+    void testBadInput() {
+        fputs("not a binary log", log);
+
+        int count;
+        Decode(count);
+        CPPUNIT_ASSERT_EQUAL( count, -1 );
+    }
+    
+    CPPUNIT_TEST_SUITE( CTipDebugBinaryTest );
+    CPPUNIT_TEST( testStartStop );
+    CPPUNIT_TEST( testRoundTrip );
+    CPPUNIT_TEST( testStarsAndStrings );
+    CPPUNIT_TEST( testManyArgs );
+    CPPUNIT_TEST( testLongString );
+    CPPUNIT_TEST( testPrefix );
+    CPPUNIT_TEST( testFlush );
+    CPPUNIT_TEST( testThreads );
+    CPPUNIT_TEST( testDropped );
+    CPPUNIT_TEST( testRestart );
+    CPPUNIT_TEST( testBadInput );
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CTipDebugBinaryTest );
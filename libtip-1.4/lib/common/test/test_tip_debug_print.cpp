@@ -0,0 +1,142 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+
+#include "tip_debug_print.h"
+using namespace LibTip;
+
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+static uint32_t gPrefixCalls = 0;
+
+static void CountPrefix(const char* inFunction, const char* area,
+                        const char* inFile, int inLine)
+{
+    gPrefixCalls++;
+}
+
+class CTipDebugPrintTest : public CppUnit::TestFixture {
+private:
+    FILE* saveOutput;
+    uint32_t saveFlags;
+    uint32_t saveAreas;
+    DebugPrefixFunc savePrefix;
+    FILE* fileA;
+    FILE* fileB;
+
+    std::string Contents(FILE* file) {
+        char buffer[256];
+        size_t len;
+
+        rewind(file);
+        len = fread(buffer, 1, (sizeof(buffer) - 1), file);
+        buffer[len] = '\0';
+        return std::string(buffer);
+    }
+    
+public:
+    void setUp() {
+        saveOutput = gDebugOutput;
+        saveFlags  = gDebugFlags;
+        saveAreas  = gDebugAreas;
+        savePrefix = gDebugPrefixFunc;
+
+        fileA = tmpfile();
+        fileB = tmpfile();
+        CPPUNIT_ASSERT( fileA != NULL );
+        CPPUNIT_ASSERT( fileB != NULL );
+
+        gDebugOutput = fileA;
+        gDebugFlags  = (PRINT_ENABLE | PRINT_AREA);
+        gDebugAreas  = DEBUG_ALL;
+        gPrefixCalls = 0;
+    }
+
+    void tearDown() {
+        gDebugOutput     = saveOutput;
+        gDebugFlags      = saveFlags;
+        gDebugAreas      = saveAreas;
+        gDebugPrefixFunc = savePrefix;
+
+        fclose(fileA);
+        fclose(fileB);
+    }
+
+    void testPrint() {
+        AMDEBUG(USER, ("value %u", 7));
+        CPPUNIT_ASSERT_EQUAL( Contents(fileA), std::string("[USER  ] value 7") );
+    }
+
+    void testArea() {
+        gDebugAreas = DEBUG_XMIT;
+        AMDEBUG(USER, ("value %u", 7));
+        CPPUNIT_ASSERT_EQUAL( Contents(fileA), std::string("") );
+    }
+
+    void testDisabled() {
+        // nothing would be printed so the statement is skipped,
+        // including the prefix
+        gDebugPrefixFunc = &CountPrefix;
+        gDebugFlags = 0;
+        CPPUNIT_ASSERT( ! AMDEBUG_ENABLED(USER) );
+        
+        AMDEBUG(USER, ("value %u", 7));
+        CPPUNIT_ASSERT_EQUAL( gPrefixCalls, (uint32_t) 0 );
+
+        gDebugFlags = PRINT_ENABLE;
+        AMDEBUG(USER, ("value %u", 7));
+        CPPUNIT_ASSERT_EQUAL( gPrefixCalls, (uint32_t) 1 );
+    }
+
+    void testOutputSwapped() {
+        // the output changing while locked does not redirect the
+        // rest of the statement to the unlocked file
+        FILE* locked = DebugLock();
+        CPPUNIT_ASSERT( locked == fileA );
+
+        gDebugOutput = fileB;
+        DebugPrefix("func", "USER", "file", 1);
+        DebugPrintf("value %u", 7);
+        DebugUnlock(locked);
+
+        CPPUNIT_ASSERT_EQUAL( Contents(fileA), std::string("[USER  ] value 7") );
+        CPPUNIT_ASSERT_EQUAL( Contents(fileB), std::string("") );
+
+        // unlocked calls use the current output
+        DebugPrintf("other");
+        CPPUNIT_ASSERT_EQUAL( Contents(fileB), std::string("other") );
+    }
+
+    void testNoOutput() {
+        gDebugOutput = NULL;
+        CPPUNIT_ASSERT( DebugLock() == NULL );
+        DebugPrintf("value %u", 7);
+        DebugUnlock(NULL);
+    }
+    
+    CPPUNIT_TEST_SUITE( CTipDebugPrintTest );
+    CPPUNIT_TEST( testPrint );
+    CPPUNIT_TEST( testArea );
+    CPPUNIT_TEST( testDisabled );
+    CPPUNIT_TEST( testOutputSwapped );
+    CPPUNIT_TEST( testNoOutput );
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CTipDebugPrintTest );
@@ -0,0 +1,175 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tip_histogram.h"
+using namespace LibTip;
+
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class CTipHistogramTest : public CppUnit::TestFixture {
+private:
+    CTipHistogram* hist;
+
+public:
+    void setUp() {
+        hist = new CTipHistogram();
+        CPPUNIT_ASSERT( hist != NULL );
+    }
+
+    void tearDown() {
+        delete hist;
+    }
+
+    void testCreate() {
+        CPPUNIT_ASSERT_EQUAL( hist->GetCount(), (uint64_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetSum(), (uint64_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetMin(), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetMax(), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetMean(), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetValueAtPercentile(50.0), (uint32_t) 0 );
+    }
+
+    void testBuckets() {
+        // small values are exact
+        for (uint32_t i = 0; i < CTipHistogram::SUB_BUCKETS; i++) {
+            CPPUNIT_ASSERT_EQUAL( CTipHistogram::GetBucketIndex(i), i );
+            CPPUNIT_ASSERT_EQUAL( CTipHistogram::GetBucketLow(i), i );
+            CPPUNIT_ASSERT_EQUAL( CTipHistogram::GetBucketHigh(i), i );
+        }
+
+        // 16 - 31 are still exact, 32 - 63 are two wide
+        CPPUNIT_ASSERT_EQUAL( CTipHistogram::GetBucketIndex(16), (uint32_t) 16 );
+        CPPUNIT_ASSERT_EQUAL( CTipHistogram::GetBucketIndex(31), (uint32_t) 31 );
+        CPPUNIT_ASSERT_EQUAL( CTipHistogram::GetBucketIndex(32), (uint32_t) 32 );
+        CPPUNIT_ASSERT_EQUAL( CTipHistogram::GetBucketIndex(33), (uint32_t) 32 );
+        CPPUNIT_ASSERT_EQUAL( CTipHistogram::GetBucketLow(32), (uint32_t) 32 );
+        CPPUNIT_ASSERT_EQUAL( CTipHistogram::GetBucketHigh(32), (uint32_t) 33 );
+
+        // the largest value lands in the last bucket
+        CPPUNIT_ASSERT_EQUAL( CTipHistogram::GetBucketIndex(0xFFFFFFFF),
+                              (CTipHistogram::NUM_BUCKETS - 1) );
+        CPPUNIT_ASSERT_EQUAL( CTipHistogram::GetBucketHigh(CTipHistogram::NUM_BUCKETS - 1),
+                              (uint32_t) 0xFFFFFFFF );
+    }
+
+    void testBucketRanges() {
+        // buckets are contiguous, every value falls in the bucket
+        // whose range holds it and no bucket is wider than 1/16th of
+        // its values
+        for (uint32_t i = 0; i < CTipHistogram::NUM_BUCKETS; i++) {
+            uint32_t low = CTipHistogram::GetBucketLow(i);
+            uint32_t high = CTipHistogram::GetBucketHigh(i);
+
+            CPPUNIT_ASSERT( low <= high );
+            CPPUNIT_ASSERT_EQUAL( CTipHistogram::GetBucketIndex(low), i );
+            CPPUNIT_ASSERT_EQUAL( CTipHistogram::GetBucketIndex(high), i );
+            CPPUNIT_ASSERT( (high - low) <= (low / CTipHistogram::SUB_BUCKETS) );
+
+            if (i + 1 < CTipHistogram::NUM_BUCKETS) {
+                CPPUNIT_ASSERT_EQUAL( CTipHistogram::GetBucketLow(i + 1), (high + 1) );
+            }
+        }
+    }
+
+    void testAdd() {
+        hist->Add(10);
+        hist->Add(20);
+        hist->Add(30);
+        hist->Add(1000);
+
+        CPPUNIT_ASSERT_EQUAL( hist->GetCount(), (uint64_t) 4 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetSum(), (uint64_t) 1060 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetMin(), (uint32_t) 10 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetMax(), (uint32_t) 1000 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetMean(), (uint32_t) 265 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetBucketCount(10), (uint32_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetBucketCount(CTipHistogram::GetBucketIndex(1000)),
+                              (uint32_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetBucketCount(CTipHistogram::NUM_BUCKETS),
+                              (uint32_t) 0 );
+    }
+
+    void testPercentile() {
+        for (uint32_t i = 1; i <= 100; i++) {
+            hist->Add(i);
+        }
+
+        CPPUNIT_ASSERT_EQUAL( hist->GetValueAtPercentile(0.0), (uint32_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetValueAtPercentile(100.0), (uint32_t) 100 );
+
+        // above 31 the answer is the top of the bucket, within 1/16th
+        uint32_t p50 = hist->GetValueAtPercentile(50.0);
+        CPPUNIT_ASSERT( p50 >= 50 && p50 <= 53 );
+        uint32_t p99 = hist->GetValueAtPercentile(99.0);
+        CPPUNIT_ASSERT( p99 >= 99 && p99 <= 100 );
+
+        // out of range percentiles are clamped
+        CPPUNIT_ASSERT_EQUAL( hist->GetValueAtPercentile(-1.0), (uint32_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetValueAtPercentile(200.0), (uint32_t) 100 );
+    }
+
+    void testLargeValues() {
+        hist->Add(0xFFFFFFFF);
+        hist->Add(0xFFFFFFFF);
+
+        CPPUNIT_ASSERT_EQUAL( hist->GetSum(), (uint64_t) 0x1FFFFFFFEULL );
+        CPPUNIT_ASSERT_EQUAL( hist->GetMean(), (uint32_t) 0xFFFFFFFF );
+        CPPUNIT_ASSERT_EQUAL( hist->GetValueAtPercentile(50.0), (uint32_t) 0xFFFFFFFF );
+    }
+
+    void testCopy() {
+        hist->Add(5);
+        hist->Add(500);
+
+        CTipHistogram copy(*hist);
+        hist->Add(7);
+
+        CPPUNIT_ASSERT_EQUAL( copy.GetCount(), (uint64_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( copy.GetMin(), (uint32_t) 5 );
+        CPPUNIT_ASSERT_EQUAL( copy.GetMax(), (uint32_t) 500 );
+        CPPUNIT_ASSERT_EQUAL( copy.GetBucketCount(7), (uint32_t) 0 );
+
+        copy = *hist;
+        CPPUNIT_ASSERT_EQUAL( copy.GetCount(), (uint64_t) 3 );
+        CPPUNIT_ASSERT_EQUAL( copy.GetBucketCount(7), (uint32_t) 1 );
+    }
+
+    void testReset() {
+        hist->Add(100);
+        hist->Reset();
+        CPPUNIT_ASSERT_EQUAL( hist->GetCount(), (uint64_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( hist->GetBucketCount(CTipHistogram::GetBucketIndex(100)),
+                              (uint32_t) 0 );
+
+        // min starts over after a reset
+        hist->Add(200);
+        CPPUNIT_ASSERT_EQUAL( hist->GetMin(), (uint32_t) 200 );
+    }
+    
+    CPPUNIT_TEST_SUITE( CTipHistogramTest );
+    CPPUNIT_TEST( testCreate );
+    CPPUNIT_TEST( testBuckets );
+    CPPUNIT_TEST( testBucketRanges );
+    CPPUNIT_TEST( testAdd );
+    CPPUNIT_TEST( testPercentile );
+    CPPUNIT_TEST( testLargeValues );
+    CPPUNIT_TEST( testCopy );
+    CPPUNIT_TEST( testReset );
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CTipHistogramTest );
@@ -0,0 +1,102 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tip_log_limit.h"
+using namespace LibTip;
+
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class CTipLogLimiterTest : public CppUnit::TestFixture {
+private:
+    CTipLogLimiter* limit;
+
+public:
+    void setUp() {
+        limit = new CTipLogLimiter();
+        CPPUNIT_ASSERT( limit != NULL );
+    }
+
+    void tearDown() {
+        delete limit;
+    }
+
+    void testUnlimited() {
+        uint32_t suppressed = 1;
+
+        CPPUNIT_ASSERT_EQUAL( limit->GetCount(), (uint32_t) 0 );
+        for (uint32_t i = 0; i < 1000; i++) {
+            CPPUNIT_ASSERT_EQUAL( limit->Allow(0, suppressed), true );
+            CPPUNIT_ASSERT_EQUAL( suppressed, (uint32_t) 0 );
+        }
+    }
+
+    void testLimit() {
+        uint32_t suppressed = 0;
+
+        limit->SetLimit(2, 1000);
+        CPPUNIT_ASSERT_EQUAL( limit->Allow(5000, suppressed), true );
+        CPPUNIT_ASSERT_EQUAL( limit->Allow(5001, suppressed), true );
+        CPPUNIT_ASSERT_EQUAL( limit->Allow(5002, suppressed), false );
+        CPPUNIT_ASSERT_EQUAL( limit->Allow(5999, suppressed), false );
+        CPPUNIT_ASSERT_EQUAL( limit->GetSuppressed(), (uint32_t) 2 );
+
+        // next interval reports what was dropped
+        CPPUNIT_ASSERT_EQUAL( limit->Allow(6000, suppressed), true );
+        CPPUNIT_ASSERT_EQUAL( suppressed, (uint32_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( limit->GetSuppressed(), (uint32_t) 0 );
+
+        CPPUNIT_ASSERT_EQUAL( limit->Allow(6001, suppressed), true );
+        CPPUNIT_ASSERT_EQUAL( suppressed, (uint32_t) 0 );
+    }
+
+    void testIdle() {
+        uint32_t suppressed = 0;
+
+        // the interval starts with the first statement, not at 0
+        limit->SetLimit(1, 1000);
+        CPPUNIT_ASSERT_EQUAL( limit->Allow(100, suppressed), true );
+        CPPUNIT_ASSERT_EQUAL( limit->Allow(1099, suppressed), false );
+        CPPUNIT_ASSERT_EQUAL( limit->Allow(1100, suppressed), true );
+        CPPUNIT_ASSERT_EQUAL( suppressed, (uint32_t) 1 );
+
+        // long idle periods start a fresh interval
+        CPPUNIT_ASSERT_EQUAL( limit->Allow(50000, suppressed), true );
+        CPPUNIT_ASSERT_EQUAL( limit->Allow(50999, suppressed), false );
+    }
+
+    void testReset() {
+        uint32_t suppressed = 0;
+
+        limit->SetLimit(1, 1000);
+        CPPUNIT_ASSERT_EQUAL( limit->Allow(0, suppressed), true );
+        CPPUNIT_ASSERT_EQUAL( limit->Allow(1, suppressed), false );
+
+        limit->SetLimit(0, 0);
+        CPPUNIT_ASSERT_EQUAL( limit->GetSuppressed(), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( limit->Allow(2, suppressed), true );
+    }
+    
+    CPPUNIT_TEST_SUITE( CTipLogLimiterTest );
+    CPPUNIT_TEST( testUnlimited );
+    CPPUNIT_TEST( testLimit );
+    CPPUNIT_TEST( testIdle );
+    CPPUNIT_TEST( testReset );
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CTipLogLimiterTest );
@@ -0,0 +1,120 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tip_rtt.h"
+using namespace LibTip;
+
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class CTipRttEstimatorTest : public CppUnit::TestFixture {
+private:
+    CTipRttEstimator* rtt;
+
+public:
+    void setUp() {
+        rtt = new CTipRttEstimator(1, 60000);
+        CPPUNIT_ASSERT( rtt != NULL );
+    }
+
+    void tearDown() {
+        delete rtt;
+    }
+
+    void testCreate() {
+        CPPUNIT_ASSERT_EQUAL( rtt->HasSample(), false );
+        CPPUNIT_ASSERT_EQUAL( rtt->GetNumSamples(), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( rtt->GetSRTT(), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( rtt->GetRTO(), (uint32_t) 0 );
+    }
+
+    void testFirstSample() {
+        rtt->AddSample(100);
+
+        // SRTT = R, RTTVAR = R/2, RTO = SRTT + 4 * RTTVAR
+        CPPUNIT_ASSERT_EQUAL( rtt->HasSample(), true );
+        CPPUNIT_ASSERT_EQUAL( rtt->GetSRTT(), (uint32_t) 100 );
+        CPPUNIT_ASSERT_EQUAL( rtt->GetRTTVAR(), (uint32_t) 50 );
+        CPPUNIT_ASSERT_EQUAL( rtt->GetRTO(), (uint32_t) 300 );
+    }
+
+    void testSecondSample() {
+        rtt->AddSample(100);
+        rtt->AddSample(180);
+
+        // RTTVAR = 3/4 * 50 + 1/4 * 80 = 57.5
+        // SRTT   = 7/8 * 100 + 1/8 * 180 = 110
+        CPPUNIT_ASSERT_EQUAL( rtt->GetSRTT(), (uint32_t) 110 );
+        CPPUNIT_ASSERT_EQUAL( rtt->GetRTTVAR(), (uint32_t) 57 );
+        CPPUNIT_ASSERT_EQUAL( rtt->GetRTO(), (uint32_t) 340 );
+        CPPUNIT_ASSERT_EQUAL( rtt->GetNumSamples(), (uint32_t) 2 );
+    }
+
+    void testConverge() {
+        for (uint32_t i = 0; i < 100; i++) {
+            rtt->AddSample(20);
+        }
+
+        // steady samples drive the variation toward zero so the RTO
+        // approaches the clock granularity above SRTT
+        CPPUNIT_ASSERT_EQUAL( rtt->GetSRTT(), (uint32_t) 20 );
+        CPPUNIT_ASSERT( rtt->GetRTO() >= 21 );
+        CPPUNIT_ASSERT( rtt->GetRTO() <= 25 );
+    }
+
+    void testBounds() {
+        rtt->SetBounds(500, 1000);
+        CPPUNIT_ASSERT_EQUAL( rtt->GetMinRto(), (uint32_t) 500 );
+        CPPUNIT_ASSERT_EQUAL( rtt->GetMaxRto(), (uint32_t) 1000 );
+        
+        rtt->AddSample(10);
+        CPPUNIT_ASSERT_EQUAL( rtt->GetRTO(), (uint32_t) 500 );
+
+        rtt->Reset();
+        rtt->AddSample(900);
+        CPPUNIT_ASSERT_EQUAL( rtt->GetRTO(), (uint32_t) 1000 );
+
+        // max below min is raised to min
+        rtt->SetBounds(500, 100);
+        CPPUNIT_ASSERT_EQUAL( rtt->GetMaxRto(), (uint32_t) 500 );
+    }
+
+    void testLargeSample() {
+        rtt->AddSample(0xFFFFFFFF);
+        rtt->AddSample(0xFFFFFFFF);
+        CPPUNIT_ASSERT_EQUAL( rtt->GetRTO(), (uint32_t) 60000 );
+    }
+
+    void testReset() {
+        rtt->AddSample(100);
+        rtt->Reset();
+        CPPUNIT_ASSERT_EQUAL( rtt->HasSample(), false );
+        CPPUNIT_ASSERT_EQUAL( rtt->GetRTO(), (uint32_t) 0 );
+    }
+    
+    CPPUNIT_TEST_SUITE( CTipRttEstimatorTest );
+    CPPUNIT_TEST( testCreate );
+    CPPUNIT_TEST( testFirstSample );
+    CPPUNIT_TEST( testSecondSample );
+    CPPUNIT_TEST( testConverge );
+    CPPUNIT_TEST( testBounds );
+    CPPUNIT_TEST( testLargeSample );
+    CPPUNIT_TEST( testReset );
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CTipRttEstimatorTest );
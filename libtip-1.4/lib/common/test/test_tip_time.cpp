@@ -0,0 +1,140 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include "tip_time.h"
+using namespace LibTip;
+
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+// clock that only moves when told to
+class CTipTestClock : public CTipClock {
+public:
+    CTipTestClock() : mMsec(1000), mReads(0) {}
+
+    virtual uint64_t GetMsec() {
+        mReads++;
+        return mMsec;
+    }
+
+    uint64_t mMsec;
+    uint32_t mReads;
+};
+
+class CTipTimeTest : public CppUnit::TestFixture {
+private:
+    CTipTestClock* clock;
+
+public:
+    void setUp() {
+        clock = new CTipTestClock();
+        CPPUNIT_ASSERT( clock != NULL );
+    }
+
+    void tearDown() {
+        SetClock(NULL);
+        delete clock;
+    }
+
+    void testMonotonic() {
+        uint64_t start = GetMsecTimestamp();
+        usleep(50000);
+        uint64_t end = GetMsecTimestamp();
+
+        CPPUNIT_ASSERT( end >= (start + 40) );
+        CPPUNIT_ASSERT( end < (start + 500) );
+    }
+
+    void testSetClock() {
+        SetClock(clock);
+        CPPUNIT_ASSERT_EQUAL( GetMsecTimestamp(), (uint64_t) 1000 );
+
+        clock->mMsec = 2000;
+        CPPUNIT_ASSERT_EQUAL( GetMsecTimestamp(), (uint64_t) 2000 );
+
+        SetClock(NULL);
+        CPPUNIT_ASSERT_EQUAL( GetMsecTimestamp(), GetMonotonicMsec() );
+    }
+
+    void testCache() {
+        SetClock(clock);
+
+        {
+            CTipTimeCache now;
+            clock->mMsec = 2000;
+            CPPUNIT_ASSERT_EQUAL( GetMsecTimestamp(), (uint64_t) 1000 );
+            CPPUNIT_ASSERT_EQUAL( GetMsecTimestamp(), (uint64_t) 1000 );
+
+            // clock is read once per cache
+            CPPUNIT_ASSERT_EQUAL( clock->mReads, (uint32_t) 1 );
+        }
+
+        CPPUNIT_ASSERT_EQUAL( GetMsecTimestamp(), (uint64_t) 2000 );
+    }
+
+    void testCacheNested() {
+        SetClock(clock);
+
+        {
+            CTipTimeCache outer;
+            clock->mMsec = 2000;
+
+            {
+                CTipTimeCache inner;
+                CPPUNIT_ASSERT_EQUAL( GetMsecTimestamp(), (uint64_t) 1000 );
+            }
+
+            // inner cache must not clear the outer one
+            CPPUNIT_ASSERT_EQUAL( GetMsecTimestamp(), (uint64_t) 1000 );
+        }
+
+        CPPUNIT_ASSERT_EQUAL( GetMsecTimestamp(), (uint64_t) 2000 );
+    }
+
+    void testCacheZero() {
+        SetClock(clock);
+        clock->mMsec = 0;
+
+        {
+            CTipTimeCache outer;
+            clock->mMsec = 5;
+
+            {
+                // a cached time of 0 is still a cached time
+                CTipTimeCache inner;
+                CPPUNIT_ASSERT_EQUAL( GetMsecTimestamp(), (uint64_t) 0 );
+            }
+
+            CPPUNIT_ASSERT_EQUAL( GetMsecTimestamp(), (uint64_t) 0 );
+            CPPUNIT_ASSERT_EQUAL( clock->mReads, (uint32_t) 1 );
+        }
+
+        CPPUNIT_ASSERT_EQUAL( GetMsecTimestamp(), (uint64_t) 5 );
+    }
+    
+    CPPUNIT_TEST_SUITE( CTipTimeTest );
+    CPPUNIT_TEST( testMonotonic );
+    CPPUNIT_TEST( testSetClock );
+    CPPUNIT_TEST( testCache );
+    CPPUNIT_TEST( testCacheNested );
+    CPPUNIT_TEST( testCacheZero );
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CTipTimeTest );
@@ -32,10 +32,11 @@ namespace LibTip {
             mLength  = length;
             mHead    = 0;
             mTail    = length;
+            mOverflow = false;
         }
 
         // destructor, data is not freed
-        ~CPacketBuffer() {}
+        virtual ~CPacketBuffer() {}
 
         // get a pointer to the buffer data
         uint8_t* GetBuffer() {
@@ -52,11 +53,19 @@ namespace LibTip {
             return mHead;
         }
     
+        // true if an Add() did not fit in the buffer and data was
+        // dropped.  cleared by Reset().
+        bool IsOverflow() const {
+            return mOverflow;
+        }
+
         // add a uint8_t buffer of given size to the end of the buffer, data
-        // is copied
+        // is copied.  if the buffer cannot grow to hold the data it is
+        // truncated and the overflow flag is set.
         void Add(const uint8_t* data, uint32_t length) {
-            if ((mTail + length) > mLength) {
+            if ((mTail + length) > mLength && !Grow(mTail + length)) {
                 length = (mLength - mTail);
+                mOverflow = true;
             }
         
             memcpy((mpBuffer + mTail), data, length);
@@ -141,6 +150,7 @@ namespace LibTip {
         void Reset() {
             mHead = 0;
             mTail = 0;
+            mOverflow = false;
         }
 
         // reset a packet buffer head so data can be removed again
@@ -162,31 +172,77 @@ namespace LibTip {
         }
         
     protected:
+        // make room for at least size bytes.  a user supplied buffer
+        // cannot grow.
+        virtual bool Grow(uint32_t size) {
+            return false;
+        }
+        
         uint8_t* mpBuffer;
         uint32_t mLength;
         uint32_t mHead;
         uint32_t mTail;
+        bool     mOverflow;
 
     private:
         // no access to default constructor
         CPacketBuffer();
     };
 
-    // packet buffer implementation that provides its own buffer
+    // packet buffer implementation that provides its own buffer.
+    // small packets fit in the inline buffer, larger ones move the
+    // data to the heap, doubling up to kMaxBufferSize.
     class CPacketBufferData : public CPacketBuffer {
     public:
-        CPacketBufferData() : CPacketBuffer(mBuffer, kMaxBufferSize) {
+        CPacketBufferData() : CPacketBuffer(mBuffer, kInlineBufferSize) {
             // reset tail as we want to start off empty
             mTail = 0;
         }
             
-        ~CPacketBufferData() {
-            
+        virtual ~CPacketBufferData() {
+            if (mpBuffer != mBuffer) {
+                delete [] mpBuffer;
+            }
         }
-            
+
+        // largest amount of data the buffer will hold
+        static const uint32_t kMaxBufferSize = 65536;
+        
     protected:
-        static const uint32_t kMaxBufferSize = 2048;
-        uint8_t mBuffer[kMaxBufferSize];
+        virtual bool Grow(uint32_t size) {
+            uint32_t length = mLength;
+            while (length < size && length < kMaxBufferSize) {
+                length *= 2;
+            }
+            if (length > kMaxBufferSize) {
+                length = kMaxBufferSize;
+            }
+
+            if (length > mLength) {
+                uint8_t* buffer = new uint8_t[length];
+                if (buffer == NULL) {
+                    return false;
+                }
+            
+                memcpy(buffer, mpBuffer, mTail);
+                if (mpBuffer != mBuffer) {
+                    delete [] mpBuffer;
+                }
+
+                mpBuffer = buffer;
+                mLength  = length;
+            }
+            
+            return (mLength >= size);
+        }
+        
+        static const uint32_t kInlineBufferSize = 256;
+        uint8_t mBuffer[kInlineBufferSize];
+
+    private:
+        // do not allow copy or assignment
+        CPacketBufferData(const CPacketBufferData&);
+        CPacketBufferData& operator=(const CPacketBufferData&);
     };
 
 };
@@ -43,6 +43,12 @@ uint32_t CRtcpPacket::Pack(CPacketBuffer& buffer) const
     // pad data to 4 byte alignment
     Pad(buffer);
 
+    if (buffer.IsOverflow()) {
+        AMDEBUG(PKTERR, ("packet of %u bytes overflowed the packet buffer",
+                         GetPackSize()));
+        return 0;
+    }
+    
     return buffer.GetBufferSize();
 }
 
@@ -137,7 +143,7 @@ void CRtcpPacket::Pad(CPacketBuffer& buffer) const
 {
     uint8_t pad = 0;
 
-    while ((buffer.GetBufferSize() % 4) != 0) {
+    while ((buffer.GetBufferSize() % 4) != 0 && !buffer.IsOverflow()) {
         buffer.Add(pad);
     }
 }
@@ -24,6 +24,7 @@
 #include "tip_constants.h"
 #include "rtcp_tip_types.h"
 #include "packet_buffer.h"
+#include "rtcp_packet_pool.h"
 
 namespace LibTip {
     
@@ -31,6 +32,15 @@ namespace LibTip {
     public:
         CRtcpPacket();
         virtual ~CRtcpPacket();
+
+        // packets (and all derived types) allocated with new come
+        // from CRtcpPacketPool
+        static void* operator new(size_t size) {
+            return CRtcpPacketPool::Allocate(size);
+        }
+        static void operator delete(void* packet, size_t size) {
+            CRtcpPacketPool::Free(packet, size);
+        }
     
         /* get version */
         enum { RTCP_VERSION = 2 };
@@ -70,7 +80,9 @@ namespace LibTip {
         /* non-virtual functions for writing and reading data from a
            packet (network) buffer.  derived classes should not
            inherit these but inherit the PackData and UnpackData
-           version instead (which are called by these functions). */
+           version instead (which are called by these functions).
+           Pack returns the size of the buffer or 0 if the packet
+           did not fit. */
         uint32_t Pack(CPacketBuffer& buffer) const;
 
         uint32_t GetPackSize() const;
@@ -15,6 +15,7 @@
  */
 
 #include "tip_time.h"
+#include "tip_debug_print.h"
 #include "rtcp_packet_factory.h"
 #include "rtcp_rr_packet.h"
 #include "rtcp_sdes_packet.h"
@@ -32,14 +33,16 @@ using namespace LibTip;
 
 // template mapping function, can be used for constructing any simple
 // (e.g. not versioned) TIP packet.
-template< class T > static CRtcpTipPacket* mapTipPacket(CPacketBuffer& buffer);
+template< class T > static CRtcpTipPacket* mapTipPacket(CPacketBuffer& buffer,
+                                                        const CRtcpPacketView& view);
 
-// predeclare mapping funcs
-static CRtcpTipPacket* mapMuxCtrl(CPacketBuffer& buffer);
-static CRtcpTipPacket* mapTxFlowCtrl(CPacketBuffer& buffer);
-static CRtcpTipPacket* mapAck(CPacketBuffer& buffer);
+// predeclare mapping funcs.  versioned packets pick the class to
+// create from the view so that only one unpack is done.
+static CRtcpTipPacket* mapMuxCtrl(CPacketBuffer& buffer, const CRtcpPacketView& view);
+static CRtcpTipPacket* mapTxFlowCtrl(CPacketBuffer& buffer, const CRtcpPacketView& view);
+static CRtcpTipPacket* mapAck(CPacketBuffer& buffer, const CRtcpPacketView& view);
 
-typedef CRtcpTipPacket* (*MapFunc)(CPacketBuffer& buffer);
+typedef CRtcpTipPacket* (*MapFunc)(CPacketBuffer& buffer, const CRtcpPacketView& view);
 static MapFunc gTipMapFunc[] = {
     NULL, // RESERVED0
     mapMuxCtrl, // MUXCTRL
@@ -77,34 +80,33 @@ static MapFunc gTipMapFunc[] = {
 
 CRtcpPacket* CRtcpPacketFactory::CreatePacketFromBuffer(CPacketBuffer& buffer)
 {
-    // the offset into the buffer that we started at
-    uint32_t sOffset = buffer.GetBufferOffset();
-
-    // the length (in bytes) of this part of the packet
-    uint32_t length = 0;
-
-    // unpack as a minimum rtcp packet to figure out what we are
+    // validate the rtcp header in place to figure out what we are
     // dealing with.
-    CRtcpPacket rtcpPacket;
-    if (rtcpPacket.Unpack(buffer) != 0) {
+    CRtcpPacketView view(buffer.GetBuffer(), buffer.GetBufferSize());
+    if (! view.IsValid()) {
         // set buffer to empty as we cannot do anything more with it.
         buffer.RemAll();
         return NULL;
     }
 
-    // reset back to the beginning to unpack as the correct type
-    buffer.ResetHead(sOffset);
+    // move the overall buffer forward past the consumed data
+    buffer.ResetHead((buffer.GetBufferOffset() + view.GetSize()));
+
+    return CreatePacketFromView(view);
+}
 
+CRtcpPacket* CRtcpPacketFactory::CreatePacketFromView(const CRtcpPacketView& view)
+{
+    if (! view.IsValid()) {
+        return NULL;
+    }
+    
     // create a temp buffer with just the data from this RTCP packet.
     // this prevents an RTCP Unpack from consuming more data than it
     // should.
-    length = CRtcpPacket::RtcpLengthToBytes(rtcpPacket.GetLength());
-    CPacketBuffer tmp(buffer.GetBuffer(), length);
+    CPacketBuffer tmp(view.GetData(), view.GetSize());
 
-    // move the overall buffer forward past the consumed data
-    buffer.ResetHead((sOffset + length));
-    
-    switch (rtcpPacket.GetType()) {
+    switch (view.GetType()) {
     case CRtcpPacket::RR:
         return CreateRRFromBuffer(tmp);
 
@@ -112,10 +114,10 @@ CRtcpPacket* CRtcpPacketFactory::CreatePacketFromBuffer(CPacketBuffer& buffer)
         return CreateSDESFromBuffer(tmp);
 
     case CRtcpPacket::RTPFB:
-        return CreateFBFromBuffer(tmp);
+        return CreateFBFromBuffer(tmp, view);
         
     case CRtcpPacket::APP:
-        return CreateAPPFromBuffer(tmp);
+        return CreateAPPFromBuffer(tmp, view);
 
     default:
         // nothing else handled yet
@@ -149,23 +151,18 @@ CRtcpPacket* CRtcpPacketFactory::CreateSDESFromBuffer(CPacketBuffer& buffer)
     return sdes;
 }
 
-CRtcpPacket* CRtcpPacketFactory::CreateFBFromBuffer(CPacketBuffer& buffer)
+CRtcpPacket* CRtcpPacketFactory::CreateFBFromBuffer(CPacketBuffer& buffer,
+                                                   const CRtcpPacketView& view)
 {
-    // try to create extended first.  if that doesn't work, create
-    // non-extended.
-    CRtcpAppExtendedFeedbackPacket* ext = new CRtcpAppExtendedFeedbackPacket();
-    if (ext != NULL) {
-        if (ext->Unpack(buffer) != 0) {
-            delete ext;
-            ext = NULL;
-        }
-    }
-
-    if (ext != NULL) {
-        return ext;
+    // the length tells us whether this is an extended or a normal
+    // feedback packet
+    CRtcpAppFeedbackPacket* fb = NULL;
+    if (view.GetSize() >= CRtcpPacketView::FB_EXT_MIN_SIZE) {
+        fb = new CRtcpAppExtendedFeedbackPacket();
+    } else {
+        fb = new CRtcpAppFeedbackPacket();
     }
     
-    CRtcpAppFeedbackPacket* fb = new CRtcpAppFeedbackPacket();
     if (fb != NULL) {
         if (fb->Unpack(buffer) != 0) {
             delete fb;
@@ -176,57 +173,46 @@ CRtcpPacket* CRtcpPacketFactory::CreateFBFromBuffer(CPacketBuffer& buffer)
     return fb;
 }
 
-CRtcpPacket* CRtcpPacketFactory::CreateAPPFromBuffer(CPacketBuffer& buffer)
+CRtcpPacket* CRtcpPacketFactory::CreateAPPFromBuffer(CPacketBuffer& buffer,
+                                                    const CRtcpPacketView& view)
 {
-    CRtcpAppPacket appPacket;
     CRtcpTipPacket* retPacket = NULL;
 
-    // unpack just the header so we can figure out what type it is
-    if (appPacket.Unpack(buffer) != 0) {
-        // something wrong with the app portion of the header
-        return NULL;
-    }
-
-    TipPacketType type = ConvertRtcpToTip(appPacket.GetSubType(),
-                                          appPacket.GetAppName().mName);
+    // figure out the type from the header in place
+    TipPacketType type = view.GetTipPacketType();
     if (type == MAX_PACKET_TYPE) {
-        // something wrong with the app name and/or type.  we
-        // shouldn't get here.
+        // not a TIP packet or too short to be one
+        AMDEBUG(PKTERR, ("RTCP APP packet (%u bytes) is not a TIP packet",
+                         view.GetSize()));
         return NULL;
     }
     
-    // reset buffer back to the start so we can unpack it again as a
-    // full packet instead of just the header.
-    buffer.ResetHead();
-
     if (gTipMapFunc[type] != NULL) {
-        retPacket = gTipMapFunc[type](buffer);
+        retPacket = gTipMapFunc[type](buffer, view);
     }
     
     return retPacket;
 }
 
-static CRtcpTipPacket* mapMuxCtrl(CPacketBuffer& buffer)
+static CRtcpTipPacket* mapMuxCtrl(CPacketBuffer& buffer, const CRtcpPacketView& view)
 {
-    CRtcpAppMuxCtrlPacketBase* packet = new CRtcpAppMuxCtrlPacket();
-    if (packet == NULL) {
+    // V6 must match exactly, anything newer is unpacked as V7
+    CRtcpAppMuxCtrlPacketBase* packet = NULL;
+    uint8_t version = view.GetMuxCtrlVersion();
+    
+    if (version == CRtcpAppMuxCtrlPacket::DEFAULT_VERSION) {
+        packet = new CRtcpAppMuxCtrlPacket();
+    } else if (version >= CRtcpAppMuxCtrlV7Packet::DEFAULT_VERSION) {
+        packet = new CRtcpAppMuxCtrlV7Packet();
+    } else {
+        AMDEBUG(PKTERR, ("unsupported MUXCTRL version %hhu", version));
         return NULL;
     }
-
-    // unpack as V6 first
-    if (packet->Unpack(buffer) == 0) {
-        return packet;
-    }
-
-    // if that fails, try to unpack as V7 instead.
-    delete packet;
-    buffer.ResetHead();
-
-    packet = new CRtcpAppMuxCtrlV7Packet();
+    
     if (packet == NULL) {
         return NULL;
     }
-        
+
     if (packet->Unpack(buffer) != 0) {
         delete packet;
         return NULL;
@@ -235,21 +221,16 @@ static CRtcpTipPacket* mapMuxCtrl(CPacketBuffer& buffer)
     return packet;
 }
 
-static CRtcpTipPacket* mapTxFlowCtrl(CPacketBuffer& buffer)
+static CRtcpTipPacket* mapTxFlowCtrl(CPacketBuffer& buffer, const CRtcpPacketView& view)
 {
-    // try create V8 version first
-    CRtcpTipPacket* packet = new CRtcpAppTXFlowCtrlPacketV8();
-    if (packet == NULL) {
-        return NULL;
+    // the length tells us whether this is a V8 or an older packet
+    CRtcpTipPacket* packet = NULL;
+    if (view.GetSize() >= CRtcpPacketView::TXFLOWCTRL_V8_MIN_SIZE) {
+        packet = new CRtcpAppTXFlowCtrlPacketV8();
+    } else {
+        packet = new CRtcpAppTXFlowCtrlPacket();
     }
-
-    if (packet->Unpack(buffer) == 0) {
-        return packet;
-    }
-
-    // if that fails, try to unpack as non-V8 instead
-    delete packet;
-    packet = new CRtcpAppTXFlowCtrlPacket();
+    
     if (packet == NULL) {
         return NULL;
     }
@@ -262,7 +243,7 @@ static CRtcpTipPacket* mapTxFlowCtrl(CPacketBuffer& buffer)
     return packet;
 }
 
-static CRtcpTipPacket* mapAck(CPacketBuffer& buffer)
+static CRtcpTipPacket* mapAck(CPacketBuffer& buffer, const CRtcpPacketView& view)
 {
     // create with temp type until we know the real type
     CRtcpTipAckPacket* packet = new CRtcpTipAckPacket(RESERVED0);
@@ -275,7 +256,8 @@ static CRtcpTipPacket* mapAck(CPacketBuffer& buffer)
     return packet;
 }
 
-template< class T > static CRtcpTipPacket* mapTipPacket(CPacketBuffer& buffer) {
+template< class T > static CRtcpTipPacket* mapTipPacket(CPacketBuffer& buffer,
+                                                        const CRtcpPacketView& view) {
     T* packet = new T();
     if (packet != NULL) {
         if (packet->Unpack(buffer) != 0) {
@@ -20,6 +20,7 @@
 #include "packet_buffer.h"
 #include "rtcp_packet.h"
 #include "rtcp_tip_ack_packet.h"
+#include "rtcp_packet_view.h"
 
 namespace LibTip {
 
@@ -30,6 +31,13 @@ namespace LibTip {
         // returned, caller owns the returned pointer.
         static CRtcpPacket* CreatePacketFromBuffer(CPacketBuffer& buffer);
 
+        // create an rtcp packet from the packet referenced by the
+        // given view.  callers walking a compound packet with
+        // CRtcpCompoundView can use the view to skip packets they do
+        // not care about without constructing them.  caller owns the
+        // returned pointer.
+        static CRtcpPacket* CreatePacketFromView(const CRtcpPacketView& view);
+
         // create an ACK packet for the given packet.  caller owns
         // returned packet.
         static CRtcpTipPacket* CreateAckPacket(const CRtcpTipPacket& packet);
@@ -38,8 +46,10 @@ namespace LibTip {
         // helper functions
         static CRtcpPacket* CreateRRFromBuffer(CPacketBuffer& buffer);
         static CRtcpPacket* CreateSDESFromBuffer(CPacketBuffer& buffer);
-        static CRtcpPacket* CreateFBFromBuffer(CPacketBuffer& buffer);
-        static CRtcpPacket* CreateAPPFromBuffer(CPacketBuffer& buffer);
+        static CRtcpPacket* CreateFBFromBuffer(CPacketBuffer& buffer,
+                                               const CRtcpPacketView& view);
+        static CRtcpPacket* CreateAPPFromBuffer(CPacketBuffer& buffer,
+                                                const CRtcpPacketView& view);
         
     private:
         CRtcpPacketFactory();  // do not implement
@@ -0,0 +1,147 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <new>
+#include <pthread.h>
+
+#include "rtcp_packet_pool.h"
+using namespace LibTip;
+
+// free blocks are linked through their first bytes
+struct FreeBlock {
+    FreeBlock* mpNext;
+};
+
+// per-thread state.  only plain data can be thread local so the
+// lists and counters are kept as separate arrays.
+static __thread FreeBlock* tFreeList[CRtcpPacketPool::NUM_BUCKETS];
+static __thread uint32_t   tFreeCount[CRtcpPacketPool::NUM_BUCKETS];
+static __thread uint64_t   tAllocs;
+static __thread uint64_t   tFrees;
+static __thread uint64_t   tHeapAllocs;
+static __thread uint64_t   tHeapFrees;
+static __thread bool       tRegistered;
+
+// the key only exists for its destructor, which returns the cached
+// blocks of an exiting thread to the heap
+static pthread_key_t gPoolKey;
+static pthread_once_t gPoolKeyOnce = PTHREAD_ONCE_INIT;
+
+static void ReleaseCache(void* arg)
+{
+    CRtcpPacketPool::Trim();
+
+    // a block freed later in the thread's teardown registers again so
+    // the destructor runs another round for it
+    tRegistered = false;
+}
+
+static void CreatePoolKey()
+{
+    pthread_key_create(&gPoolKey, &ReleaseCache);
+}
+
+// called before the first block is cached on this thread
+static void RegisterThread()
+{
+    pthread_once(&gPoolKeyOnce, &CreatePoolKey);
+
+    // any non-NULL value makes the destructor run at thread exit
+    pthread_setspecific(gPoolKey, &tRegistered);
+    tRegistered = true;
+}
+
+static inline uint32_t GetBucket(size_t size)
+{
+    return ((size - 1) / CRtcpPacketPool::BUCKET_GRANULARITY);
+}
+
+void* CRtcpPacketPool::Allocate(size_t size)
+{
+    tAllocs++;
+    
+    if (size != 0 && size <= MAX_POOLED_SIZE) {
+        uint32_t bucket = GetBucket(size);
+        FreeBlock* block = tFreeList[bucket];
+        if (block != NULL) {
+            tFreeList[bucket] = block->mpNext;
+            tFreeCount[bucket]--;
+            return block;
+        }
+
+        // allocate the full bucket size so the block can be reused
+        // by any object in the same bucket
+        size = ((bucket + 1) * BUCKET_GRANULARITY);
+    }
+
+    tHeapAllocs++;
+    return ::operator new(size);
+}
+
+void CRtcpPacketPool::Free(void* block, size_t size)
+{
+    if (block == NULL) {
+        return;
+    }
+
+    tFrees++;
+
+    if (size != 0 && size <= MAX_POOLED_SIZE) {
+        uint32_t bucket = GetBucket(size);
+        if (tFreeCount[bucket] < MAX_CACHED_BLOCKS) {
+            if (! tRegistered) {
+                RegisterThread();
+            }
+
+            FreeBlock* entry = static_cast<FreeBlock*>(block);
+            entry->mpNext = tFreeList[bucket];
+            tFreeList[bucket] = entry;
+            tFreeCount[bucket]++;
+            return;
+        }
+    }
+
+    tHeapFrees++;
+    ::operator delete(block);
+}
+
+void CRtcpPacketPool::GetStats(Stats& stats)
+{
+    stats.mAllocs     = tAllocs;
+    stats.mFrees      = tFrees;
+    stats.mHeapAllocs = tHeapAllocs;
+    stats.mHeapFrees  = tHeapFrees;
+}
+
+void CRtcpPacketPool::ResetStats()
+{
+    tAllocs     = 0;
+    tFrees      = 0;
+    tHeapAllocs = 0;
+    tHeapFrees  = 0;
+}
+
+void CRtcpPacketPool::Trim()
+{
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++) {
+        while (tFreeList[i] != NULL) {
+            FreeBlock* block = tFreeList[i];
+            tFreeList[i] = block->mpNext;
+            ::operator delete(block);
+        }
+        tFreeCount[i] = 0;
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RTCP_PACKET_POOL_H
+#define RTCP_PACKET_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace LibTip {
+
+    // memory pool used for all packet objects created with new.
+    // freed blocks are cached on per-thread free lists, bucketed by
+    // size, so that steady state packet creation (receive, ACK) does
+    // not go to the heap.  blocks larger than the largest bucket go
+    // straight to the heap.
+    class CRtcpPacketPool {
+    public:
+        // allocate and free a block of the given size.  the size
+        // passed to Free() must be the size passed to Allocate().
+        static void* Allocate(size_t size);
+        static void Free(void* block, size_t size);
+
+        // allocation counters for the calling thread
+        struct Stats {
+            uint64_t mAllocs;     // blocks allocated
+            uint64_t mFrees;      // blocks freed
+            uint64_t mHeapAllocs; // allocations that went to the heap
+            uint64_t mHeapFrees;  // frees that went to the heap
+        };
+        static void GetStats(Stats& stats);
+        static void ResetStats();
+
+        // return all cached blocks of the calling thread to the heap.
+        // this is also done automatically when a thread exits.
+        static void Trim();
+
+        // sizes of the pool buckets
+        enum {
+            BUCKET_GRANULARITY = 8,
+            MAX_POOLED_SIZE    = 256,
+            NUM_BUCKETS        = (MAX_POOLED_SIZE / BUCKET_GRANULARITY),
+            MAX_CACHED_BLOCKS  = 64 // per bucket
+        };
+        
+    private:
+        CRtcpPacketPool();  // do not implement
+        ~CRtcpPacketPool(); // do not implement
+    };
+
+};
+
+#endif
@@ -0,0 +1,185 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tip_debug_print.h"
+#include "rtcp_packet.h"
+#include "rtcp_packet_view.h"
+#include "rtcp_tip_muxctrl_packet.h"
+using namespace LibTip;
+
+// minimum packed size of each TIP packet type as created by
+// CRtcpPacketFactory, 0 for types the factory does not create.
+static const uint32_t gTipPacketMinSize[MAX_PACKET_TYPE] = {
+    0,  // RESERVED0
+    36, // MUXCTRL (V6, V7 is 40)
+    0,  // UNUSED
+    20, // NOTIFY
+    28, // ECHO
+    28, // TXFLOWCTRL (pre V8, V8 is 48)
+    28, // RXFLOWCTRL
+    24, // MEDIAOPTS
+    24, // REFRESH (flags are optional)
+    0,  // UNUSED
+    0,  // UNUSED
+    0,  // UNUSED
+    56, // SPIMAP
+    0,  // UNUSED
+    0,  // UNUSED
+    28, // REQTOSEND
+    0,  // ACK_UNUSED
+    20, // ACK_MUXCTRL
+    0,  // ACK_UNUSED
+    20, // ACK_NOTIFY
+    0,  // ACK_ECHO, echo replies use the ECHO type
+    20, // ACK_TXFLOWCTRL
+    20, // ACK_RXFLOWCTRL
+    20, // ACK_MEDIAOPTS
+    20, // ACK_REFRESH
+    0,  // ACK_UNUSED
+    0,  // ACK_UNUSED
+    0,  // ACK_UNUSED
+    20, // ACK_SPIMAP
+    0,  // ACK_UNUSED
+    0,  // ACK_UNUSED
+    28  // ACK_REQTOSEND
+};
+
+CRtcpPacketView::CRtcpPacketView(uint8_t* data, uint32_t size) :
+    mpData(NULL), mSize(0)
+{
+    if (data == NULL) {
+        return;
+    }
+    
+    // same checks as CRtcpPacket::Unpack() for a bare RTCP header
+    if (size < HEADER_SIZE) {
+        AMDEBUG(PKTERR,
+                ("buffer (%u bytes) is too small for an RTCP header", size));
+        return;
+    }
+
+    uint8_t version = ((data[0] & 0xC0) >> 6);
+    if (version != CRtcpPacket::RTCP_VERSION) {
+        AMDEBUG(PKTERR, ("invalid RTCP version %hhu", version));
+        return;
+    }
+
+    uint16_t length;
+    memcpy(&length, (data + 2), sizeof(length));
+    uint32_t bytes = CRtcpPacket::RtcpLengthToBytes(ntohs(length));
+    if (bytes > size) {
+        AMDEBUG(PKTERR,
+                ("RTCP length (%u bytes) is too large for packet buffer (%u bytes)",
+                 bytes, size));
+        return;
+    }
+
+    mpData = data;
+    mSize  = bytes;
+}
+
+const char* CRtcpPacketView::GetAppName() const
+{
+    if (mpData == NULL || GetType() != CRtcpPacket::APP ||
+        !HasBytes(APPNAME_OFFSET, CRtcpAppPacket::RTCP_APPNAME_LENGTH)) {
+        return NULL;
+    }
+
+    return (const char*) (mpData + APPNAME_OFFSET);
+}
+
+TipPacketType CRtcpPacketView::GetTipPacketType() const
+{
+    const char* name = GetAppName();
+    if (name == NULL || mSize < TIP_HEADER_SIZE) {
+        return MAX_PACKET_TYPE;
+    }
+
+    return ConvertRtcpToTip(GetSubType(), name);
+}
+
+uint32_t CRtcpPacketView::GetTipPacketMinSize(TipPacketType type)
+{
+    if (type >= MAX_PACKET_TYPE) {
+        return 0;
+    }
+
+    return gTipPacketMinSize[type];
+}
+
+bool CRtcpPacketView::IsTipPacketComplete() const
+{
+    TipPacketType type = GetTipPacketType();
+    uint32_t minSize = GetTipPacketMinSize(type);
+    if (minSize == 0 || mSize < minSize) {
+        return false;
+    }
+
+    if (type == MUXCTRL) {
+        // MUXCTRL V6 must match exactly, anything newer is parsed as V7
+        uint8_t version = GetMuxCtrlVersion();
+        if (version == CRtcpAppMuxCtrlPacket::DEFAULT_VERSION) {
+            return true;
+        }
+
+        return (version >= CRtcpAppMuxCtrlV7Packet::DEFAULT_VERSION &&
+                mSize >= MUXCTRL_V7_MIN_SIZE);
+    }
+
+    return true;
+}
+
+uint8_t CRtcpPacketView::GetMuxCtrlVersion() const
+{
+    if (GetTipPacketType() != MUXCTRL) {
+        return 0;
+    }
+
+    return ((Get8(MUX_VERSION_OFFSET) & 0xF0) >> 4);
+}
+
+uint64_t CRtcpPacketView::GetTipNtpTime() const
+{
+    TipPacketType type = GetTipPacketType();
+    if (type == MAX_PACKET_TYPE) {
+        return 0;
+    }
+
+    // MUXCTRL puts its version and options ahead of the ntp time
+    if (type == MUXCTRL) {
+        return Get64(MUX_NTP_OFFSET);
+    }
+
+    return Get64(TIP_NTP_OFFSET);
+}
+
+int CRtcpCompoundView::Next(CRtcpPacketView& view)
+{
+    if (mOffset >= mSize) {
+        return -1;
+    }
+
+    view = CRtcpPacketView((mpBuffer + mOffset), (mSize - mOffset));
+    if (! view.IsValid()) {
+        // nothing more can be located, consume everything
+        mOffset = mSize;
+        mError  = true;
+        return -1;
+    }
+
+    mOffset += view.GetSize();
+    return 0;
+}
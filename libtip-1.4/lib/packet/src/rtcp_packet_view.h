@@ -0,0 +1,176 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RTCP_PACKET_VIEW_H
+#define RTCP_PACKET_VIEW_H
+
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "rtcp_tip_types.h"
+
+namespace LibTip {
+
+    // read-only view of a single RTCP packet inside a caller owned
+    // buffer.  no data is copied and nothing is allocated, all fields
+    // are decoded in place from the wire format.  a view is only
+    // valid for as long as the underlying buffer is.
+    class CRtcpPacketView {
+    public:
+        CRtcpPacketView() : mpData(NULL), mSize(0) {}
+
+        // construct a view of the first RTCP packet in the given
+        // buffer.  the view is empty (IsValid() returns false) if the
+        // buffer does not start with a valid RTCP header or the RTCP
+        // length does not fit in the buffer.
+        CRtcpPacketView(uint8_t* data, uint32_t size);
+
+        // does this view reference a packet with a valid RTCP header
+        bool IsValid() const { return (mpData != NULL); }
+
+        // pointer to the first byte of the packet
+        uint8_t* GetData() const { return mpData; }
+
+        // size of the packet in bytes as given by the RTCP length
+        uint32_t GetSize() const { return mSize; }
+
+        // header fields, see CRtcpPacket for the meaning of each
+        uint8_t GetVersion() const { return ((mpData[0] & 0xC0) >> 6); }
+        uint8_t GetPadding() const { return ((mpData[0] & 0x20) >> 5); }
+        uint8_t GetSubType() const { return (mpData[0] & 0x1F); }
+        uint8_t GetType() const { return mpData[1]; }
+        uint16_t GetLength() const { return Get16(2); }
+
+        // SSRC of the sender, 0 if the packet is too short to have one
+        uint32_t GetSSRC() const { return Get32(4); }
+
+        // pointer to the 4 byte APP name, NULL if this is not an APP
+        // packet or the packet is too short to have an APP name.
+        const char* GetAppName() const;
+
+        // TIP packet type of this packet.  returns MAX_PACKET_TYPE
+        // for anything that is not an APP packet with a TIP APP name
+        // and room for the generic TIP header.
+        TipPacketType GetTipPacketType() const;
+
+        // is the packet long enough to hold the fixed fields of its
+        // TIP packet type.  this mirrors the minimum size checks done
+        // when unpacking the full packet (including the MUXCTRL
+        // version) but does not look at variable length data such
+        // as TLVs.  returns false for TIP types the factory does not
+        // create.
+        bool IsTipPacketComplete() const;
+
+        // minimum size (in bytes) of a packet of the given TIP type,
+        // 0 if the factory does not create packets of that type.
+        // MUXCTRL returns the V6 size, see IsTipPacketComplete().
+        static uint32_t GetTipPacketMinSize(TipPacketType type);
+
+        // version field of a MUXCTRL packet, 0 if this is not a
+        // MUXCTRL packet
+        uint8_t GetMuxCtrlVersion() const;
+
+        // the transmit NTP time of a TIP packet.  MUXCTRL packets
+        // carry this in a different place, that is handled here.
+        uint64_t GetTipNtpTime() const;
+
+        // does the packet contain len bytes starting at offset
+        bool HasBytes(uint32_t offset, uint32_t len) const {
+            return (mpData != NULL && offset <= mSize && len <= (mSize - offset));
+        }
+
+        // read host order fields at the given byte offset.  reads
+        // past the end of the packet return 0.
+        uint8_t Get8(uint32_t offset) const {
+            return (HasBytes(offset, sizeof(uint8_t)) ? mpData[offset] : 0);
+        }
+        uint16_t Get16(uint32_t offset) const {
+            uint16_t val = 0;
+            if (HasBytes(offset, sizeof(val))) {
+                memcpy(&val, (mpData + offset), sizeof(val));
+            }
+            return ntohs(val);
+        }
+        uint32_t Get32(uint32_t offset) const {
+            uint32_t val = 0;
+            if (HasBytes(offset, sizeof(val))) {
+                memcpy(&val, (mpData + offset), sizeof(val));
+            }
+            return ntohl(val);
+        }
+        uint64_t Get64(uint32_t offset) const {
+            return ((((uint64_t) Get32(offset)) << 32) | Get32(offset + 4));
+        }
+
+        // byte offsets and sizes of common fields
+        enum {
+            HEADER_SIZE            = 4,
+            SSRC_OFFSET            = 4,
+            APPNAME_OFFSET         = 8,
+            TIP_NTP_OFFSET         = 12,
+            MUX_VERSION_OFFSET     = 12,
+            MUX_NTP_OFFSET         = 16,
+            TIP_HEADER_SIZE        = 20,
+            TIP_TARGET_OFFSET      = 20,
+            FLOWCTRL_TARGET_OFFSET = 24,
+            FB_TARGET_OFFSET       = 8,
+            FB_PACKETID_OFFSET     = 12,
+            FB_ACKS_OFFSET         = 14,
+            FB_MIN_SIZE            = 28,
+            FB_EXT_MIN_SIZE        = 44,
+            MUXCTRL_V7_MIN_SIZE    = 40,
+            TXFLOWCTRL_V8_MIN_SIZE = 48
+        };
+
+    private:
+        uint8_t*  mpData;
+        uint32_t  mSize;
+    };
+
+    // walk an RTCP compound packet in place, producing a view of each
+    // contained packet in order.  like
+    // CRtcpPacketFactory::CreatePacketFromBuffer() walking stops at
+    // the first packet with an invalid RTCP header as nothing after
+    // that can be located.
+    class CRtcpCompoundView {
+    public:
+        CRtcpCompoundView(uint8_t* buffer, uint32_t size) :
+            mpBuffer(buffer), mSize(((buffer != NULL) ? size : 0)), mOffset(0),
+            mError(false) {}
+
+        // get a view of the next packet.  returns 0 on success, -1
+        // when there are no more packets.
+        int Next(CRtcpPacketView& view);
+
+        // number of bytes not yet walked
+        uint32_t GetRemaining() const { return (mSize - mOffset); }
+
+        // true if Next() stopped on data that was not a valid packet
+        // (bad header or a length past the end of the buffer) rather
+        // than at the end of the buffer
+        bool HasError() const { return mError; }
+
+    private:
+        uint8_t*  mpBuffer;
+        uint32_t  mSize;
+        uint32_t  mOffset;
+        bool      mError;
+    };
+
+};
+
+#endif
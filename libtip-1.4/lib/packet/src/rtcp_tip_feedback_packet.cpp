@@ -87,6 +87,22 @@ uint16_t CRtcpAppFeedbackPacket::ConvertSeqNumToIndex(uint16_t seqno) const
     return ((NUM_ACK_BITS + seqno) - mFB.mPacketID);
 }
 
+int CRtcpAppFeedbackPacket::PackAcks(uint8_t* packed, uint32_t size) const
+{
+    // the packet id and acks follow the rtcp header, SSRC, and target
+    uint32_t offset = (sizeof(RtcpHeader) + sizeof(mSSRC) + sizeof(mFB.mTarget));
+    if (size < (offset + sizeof(mFB.mPacketID) + sizeof(mFB.mAcks))) {
+        return -1;
+    }
+
+    CPacketBuffer buffer((packed + offset), (size - offset));
+    buffer.Reset();
+    buffer.Add(mFB.mPacketID);
+    buffer.Add(mFB.mAcks, sizeof(mFB.mAcks));
+
+    return 0;
+}
+
 uint32_t CRtcpAppFeedbackPacket::PackData(CPacketBuffer& buffer) const
 {
     CRtcpPacketSSRC::PackData(buffer);
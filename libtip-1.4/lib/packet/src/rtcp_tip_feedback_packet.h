@@ -67,6 +67,13 @@ namespace LibTip {
         AckValue GetPacketAckBySeqNum(uint16_t seqno) const;
         void SetPacketAckBySeqNum(uint16_t seqno, AckValue ack);
 
+        // write the packet id and ACK bitfield into a copy of this
+        // packet that was already packed into the given buffer,
+        // leaving the rest of the packed data alone.  lets a packed
+        // packet be reused when only the acks change.  returns -1 if
+        // the buffer is too small to hold the packet.
+        int PackAcks(uint8_t* packed, uint32_t size) const;
+
         virtual void ToStream(std::ostream& o, MediaType mType = MT_MAX) const;
         
     protected:
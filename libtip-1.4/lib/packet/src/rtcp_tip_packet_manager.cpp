@@ -24,27 +24,47 @@ CTipPacketManager::CTipPacketManager(uint32_t intervalMS, uint32_t maxTx)
 {
     mTxInterval = intervalMS;
     mTxMax = maxTx;
-    mNextTxTime = 0;
+    mTxBackoff = 1;
+    mTxMaxInterval = 0;
+    mTxJitter = 0;
+    mJitterSeed = (uint32_t) (GetUsecTimestamp() ^ (uintptr_t) this);
+    mAdaptive = false;
     mWrapper = true;
     mWrapperSSRC = 0;
-    mPacketListTxIterator = mPacketList.end();
+
+    for (uint32_t i = 0; i < MAX_SLOTS; i++) {
+        mSlots[i].mpPacket = NULL;
+        mSlots[i].mTxCount = 0;
+        mSlots[i].mNextTxTime = 0;
+        mSlots[i].mFirstTxTime = 0;
+        mSlots[i].mInterval = 0;
+        mSlots[i].mPrev    = INVALID_SLOT;
+        mSlots[i].mNext    = INVALID_SLOT;
+    }
+    mHead       = INVALID_SLOT;
+    mTail       = INVALID_SLOT;
+    mNumPackets = 0;
+    
+    PackWrapper();
 }
 
 CTipPacketManager::~CTipPacketManager()
 {
     // free any pending packet pointers here
-    while (! mPacketList.empty()) {
-        PacketEntry pe = mPacketList.front();
-        mPacketList.pop_front();
-
-        delete pe.mpPacket;
-        delete pe.mpBuffer;
+    for (uint32_t i = 0; i < MAX_SLOTS; i++) {
+        delete mSlots[i].mpPacket;
     }
 }
 
 void CTipPacketManager::SetRetransmissionInterval(uint32_t intervalMS)
 {
     mTxInterval = intervalMS;
+
+    // queued packets switch over starting with their next
+    // retransmission
+    for (uint32_t i = 0; i < MAX_SLOTS; i++) {
+        mSlots[i].mInterval = intervalMS;
+    }
 }
 
 void CTipPacketManager::SetRetransmissionLimit(uint32_t limit)
@@ -52,10 +72,70 @@ void CTipPacketManager::SetRetransmissionLimit(uint32_t limit)
     mTxMax = limit;
 }
 
+void CTipPacketManager::SetRetransmissionBackoff(uint32_t multiplier,
+                                                 uint32_t maxIntervalMS)
+{
+    mTxBackoff = (multiplier == 0 ? 1 : multiplier);
+    mTxMaxInterval = maxIntervalMS;
+}
+
+void CTipPacketManager::SetRetransmissionJitter(uint32_t percent)
+{
+    mTxJitter = (percent > 100 ? 100 : percent);
+}
+
+void CTipPacketManager::EnableAdaptiveInterval(uint32_t minIntervalMS,
+                                               uint32_t maxIntervalMS)
+{
+    mAdaptive = true;
+    mRtt.SetBounds(minIntervalMS, maxIntervalMS);
+}
+
+void CTipPacketManager::DisableAdaptiveInterval()
+{
+    mAdaptive = false;
+}
+
+uint32_t CTipPacketManager::GetBaseInterval() const
+{
+    if (mAdaptive && mRtt.HasSample()) {
+        return mRtt.GetRTO();
+    }
+
+    return mTxInterval;
+}
+
+uint64_t CTipPacketManager::GetPacketTimeoutMsec() const
+{
+    return GetTimeoutMsec(GetBaseInterval());
+}
+
+uint64_t CTipPacketManager::GetConfiguredTimeoutMsec() const
+{
+    return GetTimeoutMsec(mTxInterval);
+}
+
+uint64_t CTipPacketManager::GetTimeoutMsec(uint32_t interval) const
+{
+    uint64_t timeout = 0;
+    
+    for (uint32_t i = 0; i < mTxMax; i++) {
+        // worst case of GetJitteredInterval()
+        uint64_t range = (((uint64_t) interval * mTxJitter) / 100);
+        uint64_t step = (interval + range);
+
+        timeout += (step == 0 ? 1 : step);
+        interval = GetBackoffInterval(interval);
+    }
+
+    return timeout;
+}
+
 void CTipPacketManager::EnableWrapper(uint32_t ssrc)
 {
     mWrapper     = true;
     mWrapperSSRC = ssrc;
+    PackWrapper();
 }
 
 void CTipPacketManager::DisableWrapper()
@@ -68,10 +148,14 @@ int CTipPacketManager::Add(CRtcpTipPacket* packet)
     if (packet == NULL) {
         return -1;
     }
+
+    // ACKs are not tracked and only one packet per type can be
+    TipPacketType pType = packet->GetTipPacketType();
+    if (pType >= MAX_SLOTS || mSlots[pType].mpPacket != NULL) {
+        return -1;
+    }
     
-    PacketEntry pe;
-    pe.mpPacket = packet;
-    pe.mTxCount = 0;
+    PacketEntry& pe = mSlots[pType];
 
     // if NTP timestamp is 0 then set timestamp of packet to now,
     // otherwise just leave it as is
@@ -80,93 +164,173 @@ int CTipPacketManager::Add(CRtcpTipPacket* packet)
     }
     
     // pack this packet once during the Add() so we don't have to do
-    // it each time we retransmit
-    pe.mpBuffer = new CPacketBufferData();
-    if (pe.mpBuffer == NULL) {
+    // it each time we retransmit.  pack packet plus any needed
+    // wrappers into the buffer.
+    pe.mBuffer.Reset();
+    if (Pack(*packet, pe.mBuffer) != 0) {
         return -1;
     }
 
-    // pack packet plus any needed wrappers into the buffer
-    Pack(*packet, *pe.mpBuffer);
+    pe.mpPacket = packet;
+    pe.mTxCount = 0;
+    pe.mInterval = GetBaseInterval();
 
-    mPacketList.push_back(pe);
+    // schedule the first transmit for now
+    pe.mNextTxTime = GetMsecTimestamp();
+    Link(pType);
+    mNumPackets++;
     
-    if (mPacketList.size() == 1) {
-        mPacketListTxIterator = mPacketList.begin();
+    return 0;
+}
 
-        // schedule ourselves to run now
-        mNextTxTime = GetMsecTimestamp();
+CRtcpTipPacket* CTipPacketManager::Ack(const CRtcpTipPacket& ack, uint32_t* latencyMS)
+{
+    // the only packet an ACK can match is the one in the slot of the
+    // corresponding non-ACK type
+    TipPacketType pType = ConvertTipAckToNonAck(ack.GetTipPacketType());
+    if (pType >= MAX_SLOTS || mSlots[pType].mpPacket == NULL) {
+        return NULL;
     }
 
-    return 0;
+    PacketEntry& pe = mSlots[pType];
+    if (! pe.mpPacket->IsMyAck(ack)) {
+        return NULL;
+    }
+
+    uint64_t elapsed = 0;
+    if (pe.mTxCount != 0) {
+        elapsed = (GetMsecTimestamp() - pe.mFirstTxTime);
+        if (elapsed > 0xFFFFFFFF) {
+            elapsed = 0xFFFFFFFF;
+        }
+    }
+    
+    // Karn's rule, an ACK of a retransmitted packet could be for any
+    // of the copies so only time packets that were sent once
+    if (pe.mTxCount == 1) {
+        mRtt.AddSample((uint32_t) elapsed);
+    }
+
+    if (latencyMS != NULL) {
+        *latencyMS = (uint32_t) elapsed;
+    }
+    
+    return RemoveSlot(pType);
 }
 
-CRtcpTipPacket* CTipPacketManager::Ack(const CRtcpTipPacket& ack)
+uint32_t CTipPacketManager::GetTxCount(TipPacketType pType) const
 {
-    CRtcpPacketList::iterator i;
-    for (i = mPacketList.begin(); i != mPacketList.end(); ++i) {
-        if ((*i).mpPacket->IsMyAck(ack)) {
-            CRtcpTipPacket* ret = (*i).mpPacket;
-            Remove(i);
-            return ret;
-        }
+    if (pType >= MAX_SLOTS || mSlots[pType].mpPacket == NULL) {
+        return 0;
     }
 
-    return NULL;
+    return mSlots[pType].mTxCount;
 }
 
 CRtcpTipPacket* CTipPacketManager::Remove(TipPacketType pType)
 {
-    CRtcpPacketList::iterator i = FindPacket(pType);
-
-    if (i != mPacketList.end()) {
-        CRtcpTipPacket* ret = (*i).mpPacket;
-        Remove(i);
-        return ret;
+    if (pType >= MAX_SLOTS || mSlots[pType].mpPacket == NULL) {
+        return NULL;
     }
 
-    return NULL;
+    return RemoveSlot(pType);
 }
 
 CRtcpTipPacket* CTipPacketManager::Find(TipPacketType pType)
 {
-    CRtcpPacketList::iterator i = FindPacket(pType);
+    if (pType >= MAX_SLOTS) {
+        return NULL;
+    }
+
+    return mSlots[pType].mpPacket;
+}
 
-    if (i != mPacketList.end()) {
-        return (*i).mpPacket;
+CRtcpTipPacket* CTipPacketManager::RemoveSlot(uint8_t slot)
+{
+    PacketEntry& pe = mSlots[slot];
+    CRtcpTipPacket* ret = pe.mpPacket;
+    
+    Unlink(slot);
+    pe.mpPacket = NULL;
+    mNumPackets--;
+
+    return ret;
+}
+
+void CTipPacketManager::Link(uint8_t slot)
+{
+    PacketEntry& pe = mSlots[slot];
+    
+    // walk back from the end to find our spot.  packets due at the
+    // same time keep the order they were scheduled in.
+    uint8_t prev = mTail;
+    while (prev != INVALID_SLOT && mSlots[prev].mNextTxTime > pe.mNextTxTime) {
+        prev = mSlots[prev].mPrev;
     }
 
-    return NULL;
+    pe.mPrev = prev;
+    if (prev != INVALID_SLOT) {
+        pe.mNext = mSlots[prev].mNext;
+        mSlots[prev].mNext = slot;
+    } else {
+        pe.mNext = mHead;
+        mHead = slot;
+    }
+
+    if (pe.mNext != INVALID_SLOT) {
+        mSlots[pe.mNext].mPrev = slot;
+    } else {
+        mTail = slot;
+    }
 }
 
-CTipPacketManager::CRtcpPacketList::iterator
-CTipPacketManager::FindPacket(TipPacketType pType)
+void CTipPacketManager::Unlink(uint8_t slot)
 {
-    CRtcpPacketList::iterator i;
+    PacketEntry& pe = mSlots[slot];
 
-    for (i = mPacketList.begin(); i != mPacketList.end(); ++i) {
-        if ((*i).mpPacket->GetTipPacketType() == pType) {
-            break;
-        }
+    if (pe.mPrev != INVALID_SLOT) {
+        mSlots[pe.mPrev].mNext = pe.mNext;
+    } else {
+        mHead = pe.mNext;
+    }
+    if (pe.mNext != INVALID_SLOT) {
+        mSlots[pe.mNext].mPrev = pe.mPrev;
+    } else {
+        mTail = pe.mPrev;
     }
 
-    return i;
+    pe.mPrev = INVALID_SLOT;
+    pe.mNext = INVALID_SLOT;
 }
 
-void CTipPacketManager::Remove(CRtcpPacketList::iterator iter) {
-    if (mPacketListTxIterator == iter) {
-        ++mPacketListTxIterator;
+uint32_t CTipPacketManager::GetJitteredInterval(uint32_t interval)
+{
+    if (mTxJitter != 0) {
+        uint32_t range = (uint32_t) (((uint64_t) interval * mTxJitter) / 100);
+        if (range != 0) {
+            uint32_t offset = ((uint32_t) rand_r(&mJitterSeed) % ((2 * range) + 1));
+            interval = (interval - range) + offset;
+        }
     }
 
-    // free memory associated with packet buffer
-    delete (*iter).mpBuffer;
+    // never schedule a retransmit for the same millisecond, callers
+    // loop on GetPacket() until nothing is due
+    return (interval == 0 ? 1 : interval);
+}
 
-    mPacketList.erase(iter);
+uint32_t CTipPacketManager::GetBackoffInterval(uint32_t interval) const
+{
+    uint64_t next = ((uint64_t) interval * mTxBackoff);
+    if (mTxMaxInterval != 0 && next > mTxMaxInterval) {
+        next = mTxMaxInterval;
+    }
 
-    // if this was the last packet in the list then we have nothing to do
-    if (mPacketList.size() == 0) {
-        mNextTxTime = 0;
+    // a cap below the base interval should not shrink it
+    if (next < interval) {
+        next = interval;
     }
+
+    return (uint32_t) (next > 0xFFFFFFFF ? 0xFFFFFFFF : next);
 }
 
 CRtcpTipPacket* CTipPacketManager::GetPacket(bool& expired, CPacketBuffer** buffer)
@@ -176,34 +340,37 @@ CRtcpTipPacket* CTipPacketManager::GetPacket(bool& expired, CPacketBuffer** buff
         return NULL;
     }
     
-    // just in case we get called with an empty list...
-    if (mPacketList.size() == 0) {
-        *buffer = NULL;
-        return NULL;
-    }
-
-    if (mPacketListTxIterator == mPacketList.end()) {
-        // end of the road, reset to the beginning and return NULL
-        mPacketListTxIterator = mPacketList.begin();
-        mNextTxTime = GetMsecTimestamp() + (uint64_t) mTxInterval;
+    // nothing queued or the earliest packet is not due yet
+    uint64_t now = GetMsecTimestamp();
+    if (mHead == INVALID_SLOT || mSlots[mHead].mNextTxTime > now) {
         *buffer = NULL;
         return NULL;
     }
 
-    CRtcpTipPacket* ret = (*mPacketListTxIterator).mpPacket;
+    uint8_t slot = mHead;
+    PacketEntry& pe = mSlots[slot];
+    CRtcpTipPacket* ret = pe.mpPacket;
 
-    if ((*mPacketListTxIterator).mTxCount >= mTxMax) {
+    if (pe.mTxCount >= mTxMax) {
         // too many xmits on this guy, remove from list and return as expired
         expired = true;
         *buffer = NULL;
         
-        Remove(mPacketListTxIterator);
+        RemoveSlot(slot);
     } else {
         expired = false;
-        *buffer = (*mPacketListTxIterator).mpBuffer;
+        *buffer = &pe.mBuffer;
         
-        (*mPacketListTxIterator).mTxCount++;
-        ++mPacketListTxIterator;
+        if (pe.mTxCount == 0) {
+            pe.mFirstTxTime = now;
+        }
+        pe.mTxCount++;
+
+        // reschedule for the next retransmission
+        Unlink(slot);
+        pe.mNextTxTime = now + GetJitteredInterval(pe.mInterval);
+        pe.mInterval = GetBackoffInterval(pe.mInterval);
+        Link(slot);
     }
 
     return ret;
@@ -211,30 +378,71 @@ CRtcpTipPacket* CTipPacketManager::GetPacket(bool& expired, CPacketBuffer** buff
 
 uint64_t CTipPacketManager::GetNextTransmitTime() const
 {
-    if (mNextTxTime == 0) {
+    if (mHead == INVALID_SLOT) {
         // nothing to do
         return (uint64_t) -1;
     }
     
     uint64_t now = GetMsecTimestamp();
-    if (now > mNextTxTime) {
+    if (now > mSlots[mHead].mNextTxTime) {
         return 0;
     }
 
-    return (mNextTxTime - now);
+    return (mSlots[mHead].mNextTxTime - now);
 }
 
-void CTipPacketManager::Pack(const CRtcpPacket& packet, CPacketBuffer& buffer)
+int CTipPacketManager::Pack(const CRtcpPacket& packet, CPacketBuffer& buffer)
 {
+    // wrappers only depend on the SSRC so copy in the pre-packed
+    // version
     if (mWrapper) {
-        CRtcpRRPacket rr;
-        rr.SetSSRC(mWrapperSSRC);
-        rr.Pack(buffer);
+        buffer.Add(mWrapperBuffer.GetBuffer(), mWrapperBuffer.GetBufferSize());
+    }
+    
+    if (packet.Pack(buffer) == 0) {
+        return -1;
+    }
+
+    return 0;
+}
 
-        CRtcpSDESPacket sdes;
-        sdes.AddChunk(mWrapperSSRC);
-        sdes.Pack(buffer);
+uint32_t CTipPacketManager::PackV(const CRtcpPacket& packet, CPacketBuffer& buffer,
+                                  struct iovec iov[MAX_SEGMENTS])
+{
+    uint32_t offset = buffer.GetBufferSize();
+    if (packet.Pack(buffer) == 0) {
+        return 0;
+    }
+
+    return WrapV((buffer.GetBuffer() + offset), (buffer.GetBufferSize() - offset), iov);
+}
+
+uint32_t CTipPacketManager::WrapV(uint8_t* data, uint32_t size,
+                                  struct iovec iov[MAX_SEGMENTS])
+{
+    uint32_t count = 0;
+    if (mWrapper) {
+        iov[count].iov_base = mWrapperBuffer.GetBuffer();
+        iov[count].iov_len  = mWrapperBuffer.GetBufferSize();
+        count++;
     }
+
+    iov[count].iov_base = data;
+    iov[count].iov_len  = size;
+    count++;
     
-    packet.Pack(buffer);
+    return count;
+}
+
+void CTipPacketManager::PackWrapper()
+{
+    mWrapperBuffer.Reset();
+
+    CRtcpRRPacket rr;
+    rr.SetSSRC(mWrapperSSRC);
+    rr.Pack(mWrapperBuffer);
+
+    CRtcpSDESPacket sdes;
+    sdes.AddChunk(mWrapperSSRC);
+    sdes.Pack(mWrapperBuffer);
 }
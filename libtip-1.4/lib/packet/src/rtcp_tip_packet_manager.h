@@ -17,12 +17,13 @@
 #ifndef RTCP_TIP_PACKET_MANAGER_H
 #define RTCP_TIP_PACKET_MANAGER_H
 
-#include <list>
+#include <sys/uio.h>
 
 #include "rtcp_tip_types.h"
 #include "rtcp_packet.h"
 #include "rtcp_tip_ack_packet.h"
 #include "packet_buffer.h"
+#include "tip_rtt.h"
 
 namespace LibTip {
 
@@ -38,7 +39,47 @@ namespace LibTip {
         uint32_t GetRetransmissionInterval() const { return mTxInterval; }
         uint32_t GetRetransmissionLimit() const { return mTxMax; }
 
-        uint64_t GetPacketTimeoutMsec() const { return mTxInterval * mTxMax; }
+        // exponential backoff, each retransmission interval is the
+        // previous one times multiplier (1 disables backoff), capped
+        // at maxIntervalMS (0 means no cap).
+        void SetRetransmissionBackoff(uint32_t multiplier, uint32_t maxIntervalMS);
+
+        uint32_t GetRetransmissionBackoff() const { return mTxBackoff; }
+        uint32_t GetRetransmissionMaxInterval() const { return mTxMaxInterval; }
+
+        // randomize each retransmission interval by up to +/- percent
+        // so packets queued together do not stay in lock step.  0
+        // (the default) disables jitter.
+        void SetRetransmissionJitter(uint32_t percent);
+
+        uint32_t GetRetransmissionJitter() const { return mTxJitter; }
+        
+        // total time from the first transmission of a packet until it
+        // expires, with every interval stretched by the most jitter
+        // can add
+        uint64_t GetPacketTimeoutMsec() const;
+
+        // same as above but always starting from the configured
+        // interval.  used to bound waits on the remote side, whose
+        // retransmissions do not follow our round trip estimate.
+        uint64_t GetConfiguredTimeoutMsec() const;
+
+        // use the measured round trip time (see GetRttEstimator())
+        // for the retransmission interval once a sample is available,
+        // bounded by minIntervalMS and maxIntervalMS.  the configured
+        // interval is used until then.
+        void EnableAdaptiveInterval(uint32_t minIntervalMS, uint32_t maxIntervalMS);
+        void DisableAdaptiveInterval();
+
+        bool IsAdaptiveInterval() const { return mAdaptive; }
+
+        // interval used for the first retransmission of newly added
+        // packets
+        uint32_t GetBaseInterval() const;
+        
+        // round trip time estimator, fed by ACKs of packets that were
+        // only transmitted once
+        const CTipRttEstimator& GetRttEstimator() const { return mRtt; }
 
         // enable packing each TipPacket with an empty RR and SDES
         // prior to transmission
@@ -50,37 +91,66 @@ namespace LibTip {
         // add a new packet to be tracked, returns 0 if the packet was
         // successfully added.  packet memory is now owned by the
         // manager, will be returned to the user when the packet is
-        // ack'ed or times out.
+        // ack'ed or times out.  only one packet of each non-ACK type
+        // may be tracked at a time, adding a second one of the same
+        // type fails.
         int Add(CRtcpTipPacket* packet);
 
         // ack a packet in the queue removing it, returns the ACK'ed
-        // packet or NULL if no packet was found
-        CRtcpTipPacket* Ack(const CRtcpTipPacket& ack);
+        // packet or NULL if no packet was found.  if latencyMS is not
+        // NULL it is set to the time (in milliseconds) from the first
+        // transmission of the packet until now.
+        CRtcpTipPacket* Ack(const CRtcpTipPacket& ack, uint32_t* latencyMS = NULL);
 
-        // remove a packet from the queue, returns the removed packet.
-        // NOTE only removes the first packet with matching pType
+        // remove the packet with matching pType from the queue,
+        // returns the removed packet.
         CRtcpTipPacket* Remove(TipPacketType pType);
 
-        // find a packet in the queue.  NOTE only finds the first packet
-        // with the matching pType.
+        // find the packet with matching pType in the queue.
         CRtcpTipPacket* Find(TipPacketType pType);
+
+        // number of packets currently being tracked
+        uint32_t GetNumPackets() const { return mNumPackets; }
+
+        // number of times the tracked packet of type pType has been
+        // transmitted, 0 if there is no such packet
+        uint32_t GetTxCount(TipPacketType pType) const;
     
-        // get the next packet to be transmitted.  the packet's tx count
-        // will be inremented each time it is retrieved.  if NULL is
-        // returned, all packets have been transmitted for this interval.
-        // the next call to GetPacket will start over at the first packet.
-        // if expired returns as true then this packet has expired and
-        // should be free'd.  the buffer pointer (cannot be NULL) will be
-        // set to a network ready buffer containing the packet data.
+        // get the next packet due to be transmitted.  the packet's tx
+        // count will be inremented each time it is retrieved and it
+        // is rescheduled for its next retransmission.  if NULL is
+        // returned, no more packets are due right now.  if expired
+        // returns as true then this packet has expired and should be
+        // free'd.  the buffer pointer (cannot be NULL) will be set to
+        // a network ready buffer containing the packet data.
         CRtcpTipPacket* GetPacket(bool& expired, CPacketBuffer** buffer);
 
         // get the amount of time (in milliseconds) between now and when
-        // the next packets are scheduled to be transmitted.
+        // the earliest packet is due to be transmitted.
         uint64_t GetNextTransmitTime() const;
 
         // place the given packet into the given buffer, adding
-        // wrappers if configured to do so
-        void Pack(const CRtcpPacket& packet, CPacketBuffer& buffer);
+        // wrappers if configured to do so.  returns -1 if the
+        // packet does not fit in the buffer.
+        int Pack(const CRtcpPacket& packet, CPacketBuffer& buffer);
+
+        // max number of segments filled in by PackV()
+        enum { MAX_SEGMENTS = 2 };
+        
+        // place the given packet into the given buffer and describe
+        // the wrapper (if configured) and the packet as separate
+        // segments.  the wrapper segment points at data owned by the
+        // manager which is valid until the wrapper is changed.
+        // returns the number of segments or 0 if the packet does not
+        // fit in the buffer.
+        uint32_t PackV(const CRtcpPacket& packet, CPacketBuffer& buffer,
+                       struct iovec iov[MAX_SEGMENTS]);
+
+        // describe an already packed packet of size bytes as segments
+        // the same way PackV() does, adding the wrapper segment if
+        // configured.  returns the number of segments.
+        uint32_t WrapV(uint8_t* data, uint32_t size,
+                       struct iovec iov[MAX_SEGMENTS]);
         
     protected:
         // interval between transmits (in milliseconds)
@@ -89,29 +159,64 @@ namespace LibTip {
         // max number of transmits
         uint32_t mTxMax;
 
-        // time of next transmit (in milliseconds)
-        uint64_t mNextTxTime;
+        // backoff multiplier and cap on the interval (in milliseconds)
+        uint32_t mTxBackoff;
+        uint32_t mTxMaxInterval;
+
+        // jitter (in percent of the interval) and its random state
+        uint32_t mTxJitter;
+        uint32_t mJitterSeed;
+
+        // round trip time estimate and whether it drives the interval
+        CTipRttEstimator mRtt;
+        bool             mAdaptive;
 
         // should we add the empty RR and SDES wrapper
         bool mWrapper;
 
         // SSRC used for empty RR and SDES wrappers
         uint32_t mWrapperSSRC;
+
+        // wrappers packed for mWrapperSSRC, packed once when the
+        // SSRC is set and copied (Pack) or referenced (PackV) when
+        // sending
+        CPacketBufferData mWrapperBuffer;
         
-        // structure used to manage an outgoing packet
+        // structure used to manage an outgoing packet.  the packed
+        // form of the packet is kept inline so retransmits do not
+        // need a separate allocation.
         struct PacketEntry {
             CRtcpTipPacket*    mpPacket;
-            CPacketBuffer*     mpBuffer;
             uint32_t           mTxCount;
+            uint64_t           mNextTxTime;
+            uint64_t           mFirstTxTime;
+            uint32_t           mInterval;
+            uint8_t            mPrev;
+            uint8_t            mNext;
+            CPacketBufferData  mBuffer;
         };
-        typedef std::list<PacketEntry> CRtcpPacketList;
-        CRtcpPacketList mPacketList;
-        CRtcpPacketList::iterator mPacketListTxIterator;
+
+        // ACKs are never retransmitted so one slot per non-ACK packet
+        // type is enough.  slots are indexed by TipPacketType and
+        // linked together in order of mNextTxTime, earliest first.
+        static const uint32_t MAX_SLOTS    = ACK_RESERVED0;
+        static const uint8_t  INVALID_SLOT = MAX_SLOTS;
+        PacketEntry mSlots[MAX_SLOTS];
+        uint8_t     mHead;
+        uint8_t     mTail;
+        uint32_t    mNumPackets;
 
         // helper functions
-        CRtcpPacketList::iterator FindPacket(TipPacketType pType);
+        void PackWrapper();
     
-        void Remove(CRtcpPacketList::iterator iter);
+        CRtcpTipPacket* RemoveSlot(uint8_t slot);
+
+        void Link(uint8_t slot);
+        void Unlink(uint8_t slot);
+
+        uint32_t GetJitteredInterval(uint32_t interval);
+        uint32_t GetBackoffInterval(uint32_t interval) const;
+        uint64_t GetTimeoutMsec(uint32_t interval) const;
 
     private:
         // no copy of assignment
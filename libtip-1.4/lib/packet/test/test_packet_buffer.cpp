@@ -175,6 +175,10 @@ public:
         uint8_t add[2048];
         buf->Add(add, sizeof(add));
         CPPUNIT_ASSERT_EQUAL( buf->GetBufferSize(), data_size );
+        CPPUNIT_ASSERT( buf->IsOverflow() );
+
+        buf->Reset();
+        CPPUNIT_ASSERT( ! buf->IsOverflow() );
     }
 
     void testRemInvalid() {
@@ -255,6 +259,34 @@ public:
         CPacketBufferData data;
         CPPUNIT_ASSERT_EQUAL( data.GetBufferSize(), (uint32_t) 0 );
     }
+
+    void testBufferDataGrow() {
+        CPacketBufferData data;
+
+        // add more than fits inline, data must survive the move
+        for (uint32_t i = 0; i < 1024; i++) {
+            data.Add(i);
+        }
+        CPPUNIT_ASSERT_EQUAL( data.GetBufferSize(), (uint32_t) 4096 );
+        CPPUNIT_ASSERT( ! data.IsOverflow() );
+
+        for (uint32_t i = 0; i < 1024; i++) {
+            uint32_t val;
+            data.Rem(val);
+            CPPUNIT_ASSERT_EQUAL( val, i );
+        }
+    }
+
+    void testBufferDataOverflow() {
+        CPacketBufferData data;
+
+        uint8_t* add = new uint8_t[CPacketBufferData::kMaxBufferSize + 1];
+        data.Add(add, (CPacketBufferData::kMaxBufferSize + 1));
+        delete [] add;
+        
+        CPPUNIT_ASSERT_EQUAL( data.GetBufferSize(), CPacketBufferData::kMaxBufferSize );
+        CPPUNIT_ASSERT( data.IsOverflow() );
+    }
     
     CPPUNIT_TEST_SUITE( CPacketBufferTest );
     CPPUNIT_TEST( testDefaults );
@@ -270,6 +302,8 @@ public:
     CPPUNIT_TEST( testResetTail );
     CPPUNIT_TEST( testRemAll );
     CPPUNIT_TEST( testBufferData );
+    CPPUNIT_TEST( testBufferDataGrow );
+    CPPUNIT_TEST( testBufferDataOverflow );
     CPPUNIT_TEST_SUITE_END();
 };
 
@@ -105,6 +105,15 @@ public:
         }
     }
 
+    void testPackOverflow() {
+        uint8_t data[2];
+        CPacketBuffer buffer(data, sizeof(data));
+        buffer.Reset();
+
+        CPPUNIT_ASSERT_EQUAL( packet->Pack(buffer), (uint32_t) 0 );
+        CPPUNIT_ASSERT( buffer.IsOverflow() );
+    }
+    
     void testUnpack() {
         CRtcpPacket packet2;
         CPacketBufferData buffer;
@@ -209,6 +218,7 @@ public:
     CPPUNIT_TEST( testLengthConversion );
     CPPUNIT_TEST( testPackSize );
     CPPUNIT_TEST( testPack );
+    CPPUNIT_TEST( testPackOverflow );
     CPPUNIT_TEST( testUnpack );
     CPPUNIT_TEST( testUnpackFail );
     CPPUNIT_TEST( testUnpackFail2 );
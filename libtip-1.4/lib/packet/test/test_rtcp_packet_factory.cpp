@@ -679,6 +679,34 @@ public:
         CPPUNIT_ASSERT_EQUAL( buffer.GetBufferSize(), (uint32_t) 0 );
     }
 
+    void testCreateFromView() {
+        CRtcpRRPacket rr;
+        CRtcpAppRXFlowCtrlPacket rx;
+        rx.SetTarget(0x12345678);
+
+        CPacketBufferData buffer;
+        rr.Pack(buffer);
+        rx.Pack(buffer);
+
+        CRtcpCompoundView compound(buffer.GetBuffer(), buffer.GetBufferSize());
+        CRtcpPacketView view;
+
+        CPPUNIT_ASSERT( CRtcpPacketFactory::CreatePacketFromView(view) == NULL );
+
+        // skip the RR without creating it
+        CPPUNIT_ASSERT_EQUAL( compound.Next(view), 0 );
+        CPPUNIT_ASSERT_EQUAL( view.GetTipPacketType(), MAX_PACKET_TYPE );
+        
+        CPPUNIT_ASSERT_EQUAL( compound.Next(view), 0 );
+        CPPUNIT_ASSERT_EQUAL( view.GetTipPacketType(), RXFLOWCTRL );
+
+        CRtcpPacket* ret = CRtcpPacketFactory::CreatePacketFromView(view);
+        CRtcpAppRXFlowCtrlPacket* rxRet = dynamic_cast<CRtcpAppRXFlowCtrlPacket*>(ret);
+        CPPUNIT_ASSERT( rxRet != NULL );
+        CPPUNIT_ASSERT_EQUAL( rxRet->GetTarget(), (uint32_t) 0x12345678 );
+        delete ret;
+    }
+    
     void testCreateMultipleInvalid() {
         CRtcpRRPacket rr;
         CRtcpSDESPacket sdes;
@@ -989,6 +1017,7 @@ public:
     CPPUNIT_TEST( testCreateMultiple2 );
     CPPUNIT_TEST( testCreateMultiple3 );
     CPPUNIT_TEST( testCreateMultipleInvalid );
+    CPPUNIT_TEST( testCreateFromView );
     CPPUNIT_TEST( testCreateAckMuxCtrl );
     CPPUNIT_TEST( testCreateAckMO );
     CPPUNIT_TEST( testCreateAckTXFlowCtrl );
@@ -0,0 +1,217 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <pthread.h>
+using namespace std;
+
+#include "rtcp_packet_pool.h"
+#include "rtcp_packet_factory.h"
+#include "rtcp_tip_echo_packet.h"
+#include "rtcp_tip_refresh_packet.h"
+using namespace LibTip;
+
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+// blocks cached by a worker thread, counted as they reach the heap
+static const uint32_t kThreadBlocks = 16;
+static void* gThreadBlocks[kThreadBlocks];
+static uint32_t gThreadBlocksFreed = 0;
+static uint32_t gThreadBlocksFreedBeforeExit = 0;
+
+void operator delete(void* block) throw()
+{
+    for (uint32_t i = 0; i < kThreadBlocks; i++) {
+        if (block != NULL && block == gThreadBlocks[i]) {
+            gThreadBlocks[i] = NULL;
+            gThreadBlocksFreed++;
+        }
+    }
+    free(block);
+}
+
+static void* CacheBlocksThread(void* arg)
+{
+    for (uint32_t i = 0; i < kThreadBlocks; i++) {
+        gThreadBlocks[i] = CRtcpPacketPool::Allocate(32);
+    }
+    for (uint32_t i = 0; i < kThreadBlocks; i++) {
+        CRtcpPacketPool::Free(gThreadBlocks[i], 32);
+    }
+
+    gThreadBlocksFreedBeforeExit = gThreadBlocksFreed;
+    return NULL;
+}
+
+// a block freed by another thread-specific destructor, after the
+// pool has already released the thread's cache
+static pthread_key_t gLateKey;
+
+static void LateFree(void* block)
+{
+    CRtcpPacketPool::Free(block, 32);
+}
+
+static void* LateFreeThread(void* arg)
+{
+    // caching a block creates the pool key first, so on glibc its
+    // destructor runs before the one for gLateKey
+    gThreadBlocks[0] = CRtcpPacketPool::Allocate(32);
+    CRtcpPacketPool::Free(gThreadBlocks[0], 32);
+
+    gThreadBlocks[1] = CRtcpPacketPool::Allocate(32);
+    pthread_setspecific(gLateKey, gThreadBlocks[1]);
+    return NULL;
+}
+
+class CRtcpPacketPoolTest : public CppUnit::TestFixture {
+private:
+    CRtcpPacketPool::Stats stats;
+
+public:
+    void setUp() {
+        CRtcpPacketPool::Trim();
+        CRtcpPacketPool::ResetStats();
+    }
+
+    void tearDown() {
+        CRtcpPacketPool::Trim();
+    }
+    
+    void testStats() {
+        CRtcpPacketPool::GetStats(stats);
+        CPPUNIT_ASSERT_EQUAL( stats.mAllocs, (uint64_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( stats.mFrees, (uint64_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( stats.mHeapAllocs, (uint64_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( stats.mHeapFrees, (uint64_t) 0 );
+    }
+    
+    void testReuse() {
+        CRtcpAppEchoPacket* packet = new CRtcpAppEchoPacket();
+        void* first = packet;
+        delete packet;
+
+        CRtcpPacketPool::GetStats(stats);
+        CPPUNIT_ASSERT_EQUAL( stats.mAllocs, (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.mFrees, (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.mHeapAllocs, (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.mHeapFrees, (uint64_t) 0 );
+
+        // a different type of the same size gets the same block
+        CRtcpPacket* packet2 = new CRtcpAppRefreshPacket();
+        CPPUNIT_ASSERT( (void*) packet2 == first );
+        delete packet2;
+
+        CRtcpPacketPool::GetStats(stats);
+        CPPUNIT_ASSERT_EQUAL( stats.mAllocs, (uint64_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( stats.mHeapAllocs, (uint64_t) 1 );
+    }
+
+    void testLarge() {
+        void* block = CRtcpPacketPool::Allocate(CRtcpPacketPool::MAX_POOLED_SIZE + 1);
+        CPPUNIT_ASSERT( block != NULL );
+        CRtcpPacketPool::Free(block, CRtcpPacketPool::MAX_POOLED_SIZE + 1);
+
+        CRtcpPacketPool::GetStats(stats);
+        CPPUNIT_ASSERT_EQUAL( stats.mHeapAllocs, (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.mHeapFrees, (uint64_t) 1 );
+    }
+
+    void testCacheLimit() {
+        const uint32_t num = (CRtcpPacketPool::MAX_CACHED_BLOCKS + 10);
+        void* blocks[num];
+
+        for (uint32_t i = 0; i < num; i++) {
+            blocks[i] = CRtcpPacketPool::Allocate(32);
+        }
+        for (uint32_t i = 0; i < num; i++) {
+            CRtcpPacketPool::Free(blocks[i], 32);
+        }
+
+        CRtcpPacketPool::GetStats(stats);
+        CPPUNIT_ASSERT_EQUAL( stats.mHeapAllocs, (uint64_t) num );
+        CPPUNIT_ASSERT_EQUAL( stats.mHeapFrees, (uint64_t) 10 );
+    }
+
+    void testSteadyState() {
+        CRtcpAppEchoPacket echo;
+        CPacketBufferData data;
+        echo.Pack(data);
+
+        for (uint32_t i = 0; i < 100; i++) {
+            if (i == 1) {
+                CRtcpPacketPool::ResetStats();
+            }
+            
+            CPacketBuffer buffer(data.GetBuffer(), data.GetBufferSize());
+            CRtcpTipPacket* packet =
+                dynamic_cast<CRtcpTipPacket*>(CRtcpPacketFactory::CreatePacketFromBuffer(buffer));
+            CPPUNIT_ASSERT( packet != NULL );
+
+            CRtcpTipPacket* ack = CRtcpPacketFactory::CreateAckPacket(*packet);
+            CPPUNIT_ASSERT( ack != NULL );
+
+            delete ack;
+            delete packet;
+        }
+
+        CRtcpPacketPool::GetStats(stats);
+        CPPUNIT_ASSERT_EQUAL( stats.mAllocs, (uint64_t) 198 );
+        CPPUNIT_ASSERT_EQUAL( stats.mFrees, (uint64_t) 198 );
+        CPPUNIT_ASSERT_EQUAL( stats.mHeapAllocs, (uint64_t) 0 );
+    }
+    
+    void testThreadExit() {
+        for (uint32_t run = 0; run < 3; run++) {
+            gThreadBlocksFreed = 0;
+            
+            pthread_t thread;
+            CPPUNIT_ASSERT_EQUAL( pthread_create(&thread, NULL, &CacheBlocksThread, NULL), 0 );
+            CPPUNIT_ASSERT_EQUAL( pthread_join(thread, NULL), 0 );
+
+            // cached while the thread ran, returned when it exited
+            CPPUNIT_ASSERT_EQUAL( gThreadBlocksFreedBeforeExit, (uint32_t) 0 );
+            CPPUNIT_ASSERT_EQUAL( gThreadBlocksFreed, kThreadBlocks );
+        }
+    }
+    
+    void testThreadExitLateFree() {
+        CPPUNIT_ASSERT_EQUAL( pthread_key_create(&gLateKey, &LateFree), 0 );
+        gThreadBlocksFreed = 0;
+
+        pthread_t thread;
+        CPPUNIT_ASSERT_EQUAL( pthread_create(&thread, NULL, &LateFreeThread, NULL), 0 );
+        CPPUNIT_ASSERT_EQUAL( pthread_join(thread, NULL), 0 );
+        pthread_key_delete(gLateKey);
+
+        CPPUNIT_ASSERT_EQUAL( gThreadBlocksFreed, (uint32_t) 2 );
+    }
+    
+    CPPUNIT_TEST_SUITE( CRtcpPacketPoolTest );
+    CPPUNIT_TEST( testStats );
+    CPPUNIT_TEST( testReuse );
+    CPPUNIT_TEST( testLarge );
+    CPPUNIT_TEST( testCacheLimit );
+    CPPUNIT_TEST( testSteadyState );
+    CPPUNIT_TEST( testThreadExit );
+    CPPUNIT_TEST( testThreadExitLateFree );
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CRtcpPacketPoolTest );
@@ -0,0 +1,310 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+using namespace std;
+
+#include "test_packet_data.h"
+#include "rtcp_packet_view.h"
+#include "rtcp_rr_packet.h"
+#include "rtcp_sdes_packet.h"
+#include "rtcp_tip_ack_packet.h"
+#include "rtcp_tip_echo_packet.h"
+#include "rtcp_tip_feedback_packet.h"
+#include "rtcp_tip_flowctrl_packet.h"
+#include "rtcp_tip_mediaopts_packet.h"
+#include "rtcp_tip_muxctrl_packet.h"
+#include "rtcp_tip_notify_packet.h"
+#include "rtcp_tip_refresh_packet.h"
+#include "rtcp_tip_reqtosend_packet.h"
+#include "rtcp_tip_spimap_packet.h"
+using namespace LibTip;
+
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class CRtcpPacketViewTest : public CppUnit::TestFixture {
+public:
+    void testEmpty() {
+        CRtcpPacketView view;
+        CPPUNIT_ASSERT( ! view.IsValid() );
+
+        CRtcpPacketView view2(NULL, 100);
+        CPPUNIT_ASSERT( ! view2.IsValid() );
+
+        CRtcpCompoundView compound(NULL, 100);
+        CPPUNIT_ASSERT_EQUAL( compound.Next(view), -1 );
+        CPPUNIT_ASSERT_EQUAL( compound.GetRemaining(), (uint32_t) 0 );
+        CPPUNIT_ASSERT( ! compound.HasError() );
+    }
+
+    void testInvalid() {
+        // too short for a header
+        uint8_t data[] = { RTCP_HEADER_BYTES(0, 201, 1) };
+        CRtcpPacketView view(data, 3);
+        CPPUNIT_ASSERT( ! view.IsValid() );
+
+        // rtcp length bigger than the buffer
+        CRtcpPacketView view2(data, sizeof(data));
+        CPPUNIT_ASSERT( ! view2.IsValid() );
+
+        // bad version
+        uint8_t data2[] = { 0x40, 201, 0x00, 0x00 };
+        CRtcpPacketView view3(data2, sizeof(data2));
+        CPPUNIT_ASSERT( ! view3.IsValid() );
+    }
+
+    void testHeader() {
+        uint8_t data[] = { RTCP_PACKET_BYTES(3, 204, 2), RTCP_APP_PACKET_BYTES_TP1, 0xAA };
+        data[4] = 0x12;
+        data[5] = 0x34;
+        data[6] = 0x56;
+        data[7] = 0x78;
+        
+        CRtcpPacketView view(data, sizeof(data));
+        CPPUNIT_ASSERT( view.IsValid() );
+        CPPUNIT_ASSERT( view.GetData() == data );
+        CPPUNIT_ASSERT_EQUAL( view.GetVersion(), (uint8_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( view.GetPadding(), (uint8_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( view.GetSubType(), (uint8_t) 3 );
+        CPPUNIT_ASSERT_EQUAL( view.GetType(), (uint8_t) 204 );
+        CPPUNIT_ASSERT_EQUAL( view.GetLength(), (uint16_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( view.GetSize(), (uint32_t) 12 );
+        CPPUNIT_ASSERT_EQUAL( view.GetSSRC(), (uint32_t) 0x12345678 );
+        CPPUNIT_ASSERT( memcmp(view.GetAppName(), "xcts", 4) == 0 );
+
+        // too short to be a TIP packet
+        CPPUNIT_ASSERT_EQUAL( view.GetTipPacketType(), MAX_PACKET_TYPE );
+
+        // reads past the end are 0
+        CPPUNIT_ASSERT_EQUAL( view.Get8(12), (uint8_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( view.Get32(10), (uint32_t) 0 );
+    }
+
+    void testTipPacket() {
+        CRtcpAppRXFlowCtrlPacket packet;
+        packet.SetNtpTime(0x0102030405060708ULL);
+        packet.SetTarget(0xABCDEF01);
+        
+        CPacketBufferData buffer;
+        packet.Pack(buffer);
+
+        CRtcpPacketView view(buffer.GetBuffer(), buffer.GetBufferSize());
+        CPPUNIT_ASSERT( view.IsValid() );
+        CPPUNIT_ASSERT_EQUAL( view.GetSize(), buffer.GetBufferSize() );
+        CPPUNIT_ASSERT_EQUAL( view.GetTipPacketType(), RXFLOWCTRL );
+        CPPUNIT_ASSERT_EQUAL( view.GetTipNtpTime(), packet.GetNtpTime() );
+        CPPUNIT_ASSERT_EQUAL( view.Get32(24), packet.GetTarget() );
+    }
+
+    void testMuxCtrl() {
+        CRtcpAppMuxCtrlPacket packet;
+        packet.SetNtpTime(0x0102030405060708ULL);
+        
+        CPacketBufferData buffer;
+        packet.Pack(buffer);
+
+        CRtcpPacketView view(buffer.GetBuffer(), buffer.GetBufferSize());
+        CPPUNIT_ASSERT_EQUAL( view.GetTipPacketType(), MUXCTRL );
+        CPPUNIT_ASSERT_EQUAL( view.GetTipNtpTime(), packet.GetNtpTime() );
+    }
+
+    void testNotTip() {
+        uint8_t data[] = { RTCP_PACKET_BYTES(1, 204, 4), 'a', 'b', 'c', 'd',
+                           RTCP_TIP_PACKET_BYTES };
+        
+        CRtcpPacketView view(data, sizeof(data));
+        CPPUNIT_ASSERT( view.IsValid() );
+        CPPUNIT_ASSERT( view.GetAppName() != NULL );
+        CPPUNIT_ASSERT_EQUAL( view.GetTipPacketType(), MAX_PACKET_TYPE );
+        CPPUNIT_ASSERT_EQUAL( view.GetTipNtpTime(), (uint64_t) 0 );
+
+        // same bytes but not an APP packet
+        data[1] = 201;
+        CRtcpPacketView view2(data, sizeof(data));
+        CPPUNIT_ASSERT( view2.GetAppName() == NULL );
+        CPPUNIT_ASSERT_EQUAL( view2.GetTipPacketType(), MAX_PACKET_TYPE );
+    }
+
+    void checkComplete(const CRtcpTipPacket& packet, uint32_t minSize) {
+        CPacketBufferData buffer;
+        packet.Pack(buffer);
+
+        CRtcpPacketView view(buffer.GetBuffer(), buffer.GetBufferSize());
+        CPPUNIT_ASSERT( view.IsTipPacketComplete() );
+        CPPUNIT_ASSERT_EQUAL( CRtcpPacketView::GetTipPacketMinSize(packet.GetTipPacketType()),
+                              minSize );
+
+        // same packet with the rtcp length cut to the generic header
+        buffer.GetBuffer()[3] = 4;
+        CRtcpPacketView view2(buffer.GetBuffer(), buffer.GetBufferSize());
+        CPPUNIT_ASSERT_EQUAL( view2.IsTipPacketComplete(),
+                              (minSize <= CRtcpPacketView::TIP_HEADER_SIZE) );
+    }
+    
+    void testMinSize() {
+        checkComplete(CRtcpAppMuxCtrlPacket(), CRtcpAppMuxCtrlPacket().GetPackSize());
+        checkComplete(CRtcpAppMuxCtrlV7Packet(), CRtcpAppMuxCtrlPacket().GetPackSize());
+        checkComplete(CRtcpAppNotifyPacket(), CRtcpAppNotifyPacket().GetPackSize());
+        checkComplete(CRtcpAppEchoPacket(), CRtcpAppEchoPacket().GetPackSize());
+        checkComplete(CRtcpAppTXFlowCtrlPacket(), CRtcpAppTXFlowCtrlPacket().GetPackSize());
+        checkComplete(CRtcpAppTXFlowCtrlPacketV8(), CRtcpAppTXFlowCtrlPacket().GetPackSize());
+        checkComplete(CRtcpAppRXFlowCtrlPacket(), CRtcpAppRXFlowCtrlPacket().GetPackSize());
+        checkComplete(CRtcpAppMediaoptsPacket(), CRtcpAppMediaoptsPacket().GetPackSize());
+        checkComplete(CRtcpAppRefreshPacket(), (CRtcpAppRefreshPacket().GetPackSize() - 4));
+        checkComplete(CRtcpAppSpiMapPacket(), CRtcpAppSpiMapPacket().GetPackSize());
+        checkComplete(CRtcpAppReqToSendPacket(), CRtcpAppReqToSendPacket().GetPackSize());
+        checkComplete(CRtcpAppReqToSendAckPacket(), CRtcpAppReqToSendAckPacket().GetPackSize());
+        checkComplete(CRtcpTipAckPacket(ACK_MUXCTRL), CRtcpTipAckPacket(ACK_MUXCTRL).GetPackSize());
+
+        CPPUNIT_ASSERT_EQUAL( CRtcpPacketView::GetTipPacketMinSize(RESERVED0), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( CRtcpPacketView::GetTipPacketMinSize(ACK_TIPECHO), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( CRtcpPacketView::GetTipPacketMinSize(MAX_PACKET_TYPE), (uint32_t) 0 );
+    }
+
+    void testMuxCtrlVersion() {
+        CRtcpAppMuxCtrlPacket packet;
+        packet.SetVersion(5);
+
+        CPacketBufferData buffer;
+        packet.Pack(buffer);
+
+        CRtcpPacketView view(buffer.GetBuffer(), buffer.GetBufferSize());
+        CPPUNIT_ASSERT( ! view.IsTipPacketComplete() );
+
+        // V7 needs the extra V7 fields
+        packet.SetVersion(7);
+        buffer.Reset();
+        packet.Pack(buffer);
+        
+        CRtcpPacketView view2(buffer.GetBuffer(), buffer.GetBufferSize());
+        CPPUNIT_ASSERT( ! view2.IsTipPacketComplete() );
+        CPPUNIT_ASSERT_EQUAL( view2.GetMuxCtrlVersion(), (uint8_t) 7 );
+    }
+
+    void testVersionSizes() {
+        // the factory selects versioned classes by these sizes
+        CPPUNIT_ASSERT_EQUAL( (uint32_t) CRtcpPacketView::MUXCTRL_V7_MIN_SIZE,
+                              CRtcpAppMuxCtrlV7Packet().GetPackSize() );
+        CPPUNIT_ASSERT_EQUAL( (uint32_t) CRtcpPacketView::TXFLOWCTRL_V8_MIN_SIZE,
+                              CRtcpAppTXFlowCtrlPacketV8().GetPackSize() );
+        CPPUNIT_ASSERT_EQUAL( (uint32_t) CRtcpPacketView::FB_MIN_SIZE,
+                              CRtcpAppFeedbackPacket().GetPackSize() );
+        CPPUNIT_ASSERT_EQUAL( (uint32_t) CRtcpPacketView::FB_EXT_MIN_SIZE,
+                              CRtcpAppExtendedFeedbackPacket().GetPackSize() );
+
+        // not a MUXCTRL packet
+        CRtcpAppNotifyPacket notify;
+        CPacketBufferData buffer;
+        notify.Pack(buffer);
+        
+        CRtcpPacketView view(buffer.GetBuffer(), buffer.GetBufferSize());
+        CPPUNIT_ASSERT_EQUAL( view.GetMuxCtrlVersion(), (uint8_t) 0 );
+    }
+    
+    void testCompound() {
+        CRtcpRRPacket rr;
+        CRtcpSDESPacket sdes;
+        CRtcpAppTXFlowCtrlPacket tx;
+
+        rr.SetSSRC(0x11111111);
+        sdes.AddChunk(0x11111111);
+        tx.SetSSRC(0x11111111);
+        tx.SetTarget(0x22222222);
+        
+        CPacketBufferData buffer;
+        rr.Pack(buffer);
+        sdes.Pack(buffer);
+        tx.Pack(buffer);
+
+        CRtcpCompoundView compound(buffer.GetBuffer(), buffer.GetBufferSize());
+        CRtcpPacketView view;
+
+        CPPUNIT_ASSERT_EQUAL( compound.Next(view), 0 );
+        CPPUNIT_ASSERT_EQUAL( view.GetType(), (uint8_t) CRtcpPacket::RR );
+        CPPUNIT_ASSERT_EQUAL( view.GetSSRC(), (uint32_t) 0x11111111 );
+        CPPUNIT_ASSERT_EQUAL( view.GetSize(), rr.GetPackSize() );
+
+        CPPUNIT_ASSERT_EQUAL( compound.Next(view), 0 );
+        CPPUNIT_ASSERT_EQUAL( view.GetType(), (uint8_t) CRtcpPacket::SDES );
+        CPPUNIT_ASSERT_EQUAL( view.GetSize(), sdes.GetPackSize() );
+
+        CPPUNIT_ASSERT_EQUAL( compound.Next(view), 0 );
+        CPPUNIT_ASSERT_EQUAL( view.GetTipPacketType(), TXFLOWCTRL );
+        CPPUNIT_ASSERT_EQUAL( view.Get32(24), (uint32_t) 0x22222222 );
+
+        CPPUNIT_ASSERT_EQUAL( compound.Next(view), -1 );
+        CPPUNIT_ASSERT_EQUAL( compound.GetRemaining(), (uint32_t) 0 );
+        CPPUNIT_ASSERT( ! compound.HasError() );
+    }
+
+    void testCompoundInvalid() {
+        CRtcpRRPacket rr;
+        
+        CPacketBufferData buffer;
+        rr.Pack(buffer);
+
+        // trailing garbage stops the walk
+        uint8_t bad[] = { 0x00, 0x00, 0x00, 0x00 };
+        buffer.Add(bad, sizeof(bad));
+        rr.Pack(buffer);
+
+        CRtcpCompoundView compound(buffer.GetBuffer(), buffer.GetBufferSize());
+        CRtcpPacketView view;
+
+        CPPUNIT_ASSERT_EQUAL( compound.Next(view), 0 );
+        CPPUNIT_ASSERT_EQUAL( view.GetType(), (uint8_t) CRtcpPacket::RR );
+        CPPUNIT_ASSERT_EQUAL( compound.Next(view), -1 );
+        CPPUNIT_ASSERT_EQUAL( compound.GetRemaining(), (uint32_t) 0 );
+        CPPUNIT_ASSERT( compound.HasError() );
+    }
+
+    void testCompoundTruncated() {
+        CRtcpRRPacket rr;
+        
+        CPacketBufferData buffer;
+        rr.Pack(buffer);
+        rr.Pack(buffer);
+
+        // the second packet's length runs past the end of the buffer
+        CRtcpCompoundView compound(buffer.GetBuffer(), (buffer.GetBufferSize() - 4));
+        CRtcpPacketView view;
+
+        CPPUNIT_ASSERT_EQUAL( compound.Next(view), 0 );
+        CPPUNIT_ASSERT( ! compound.HasError() );
+        CPPUNIT_ASSERT_EQUAL( compound.Next(view), -1 );
+        CPPUNIT_ASSERT_EQUAL( compound.GetRemaining(), (uint32_t) 0 );
+        CPPUNIT_ASSERT( compound.HasError() );
+    }
+    
+    CPPUNIT_TEST_SUITE( CRtcpPacketViewTest );
+    CPPUNIT_TEST( testEmpty );
+    CPPUNIT_TEST( testInvalid );
+    CPPUNIT_TEST( testHeader );
+    CPPUNIT_TEST( testTipPacket );
+    CPPUNIT_TEST( testMuxCtrl );
+    CPPUNIT_TEST( testNotTip );
+    CPPUNIT_TEST( testMinSize );
+    CPPUNIT_TEST( testMuxCtrlVersion );
+    CPPUNIT_TEST( testVersionSizes );
+    CPPUNIT_TEST( testCompound );
+    CPPUNIT_TEST( testCompoundInvalid );
+    CPPUNIT_TEST( testCompoundTruncated );
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CRtcpPacketViewTest );
@@ -250,6 +250,34 @@ public:
                                      CRtcpAppFeedbackPacket::NUM_ACK_BYTES), 0 );
     }
 
+    void testPackAcks() {
+        CRtcpAppFeedbackPacket packet2;
+        CPacketBufferData buffer;
+
+        uint8_t acks[] = { RTCP_APP_FB_ACK_BYTES2 };
+        
+        packet->SetTarget(0x12345678);
+        packet->Pack(buffer);
+
+        // update the packed copy
+        packet->SetPacketID(0x90AB);
+        packet->SetPacketAcks(acks);
+        CPPUNIT_ASSERT_EQUAL( packet->PackAcks(buffer.GetBuffer(), buffer.GetBufferSize()), 0 );
+
+        CPPUNIT_ASSERT_EQUAL( packet2.Unpack(buffer), 0 );
+        CPPUNIT_ASSERT_EQUAL( packet2.GetTarget(), (uint32_t) 0x12345678 );
+        CPPUNIT_ASSERT_EQUAL( packet2.GetPacketID(), (uint16_t) 0x90AB );
+        CPPUNIT_ASSERT_EQUAL( memcmp(packet2.GetPacketAcks(), acks,
+                                     CRtcpAppFeedbackPacket::NUM_ACK_BYTES), 0 );
+    }
+
+    void testPackAcksFail() {
+        CPacketBufferData buffer;
+        packet->Pack(buffer);
+
+        CPPUNIT_ASSERT_EQUAL( packet->PackAcks(buffer.GetBuffer(), (buffer.GetBufferSize() - 1)), -1 );
+    }
+    
     void testUnpackFail() {
         uint8_t def[] = { RTCP_PACKET_BYTES(CRtcpAppFeedbackPacket::APPFB_SUBTYPE,
                                             CRtcpPacket::RTPFB, packet->GetLength()),
@@ -528,6 +556,8 @@ public:
     CPPUNIT_TEST( testPack );
     CPPUNIT_TEST( testPack2 );
     CPPUNIT_TEST( testUnpack );
+    CPPUNIT_TEST( testPackAcks );
+    CPPUNIT_TEST( testPackAcksFail );
     CPPUNIT_TEST( testUnpackFail );
     CPPUNIT_TEST( testUnpackFail2 );
     CPPUNIT_TEST( testUnpackFail3 );
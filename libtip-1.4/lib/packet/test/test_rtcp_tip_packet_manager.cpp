@@ -16,26 +16,43 @@
 
 #include "rtcp_rr_packet.h"
 #include "rtcp_sdes_packet.h"
+#include "rtcp_tip_mediaopts_packet.h"
 #include "rtcp_tip_muxctrl_packet.h"
+#include "rtcp_tip_spimap_packet.h"
 #include "rtcp_tip_packet_manager.h"
+#include "tip_time.h"
 using namespace LibTip;
 
 #include <cppunit/TestCaller.h>
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+// clock that only moves when told to
+class CTestClock : public CTipClock {
+public:
+    CTestClock() : mNow(1000) {}
+    virtual uint64_t GetMsec() { return mNow; }
+
+    uint64_t mNow;
+};
+
 class CTipPacketManagerTest : public CppUnit::TestFixture {
 private:
     CTipPacketManager* mgr;
+    CTestClock clock;
 
 public:
     void setUp() {
+        clock.mNow = 1000;
+        SetClock(&clock);
+        
         mgr = new CTipPacketManager(250, 10);
         CPPUNIT_ASSERT( mgr != NULL );
     }
 
     void tearDown() {
         delete mgr;
+        SetClock(NULL);
     }
     
     void testCreate() {
@@ -73,6 +90,7 @@ public:
         CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == NULL );
 
         // do it twice to verify looping
+        clock.mNow += 250;
         CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
         CPPUNIT_ASSERT_EQUAL( expired, false );
         CPPUNIT_ASSERT( buffer != NULL );
@@ -82,29 +100,30 @@ public:
 
     void testAddMulti() {
         CRtcpAppMuxCtrlPacket* muxctrl1 = new CRtcpAppMuxCtrlPacket();
-        CRtcpAppMuxCtrlPacket* muxctrl2 = new CRtcpAppMuxCtrlPacket();
+        CRtcpAppMediaoptsPacket* mediaopts = new CRtcpAppMediaoptsPacket();
         bool expired;
         CPacketBuffer* buffer;
 
         CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl1), 0 );
-        CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl2), 0 );
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(mediaopts), 0 );
     
         CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl1 );
         CPPUNIT_ASSERT_EQUAL( expired, false );
         CPPUNIT_ASSERT( buffer != NULL );
 
-        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl2 );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == mediaopts );
         CPPUNIT_ASSERT_EQUAL( expired, false );
         CPPUNIT_ASSERT( buffer != NULL );
 
         CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == NULL );
 
         // do it twice to verify looping
+        clock.mNow += 250;
         CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl1 );
         CPPUNIT_ASSERT_EQUAL( expired, false );
         CPPUNIT_ASSERT( buffer != NULL );
 
-        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl2 );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == mediaopts );
         CPPUNIT_ASSERT_EQUAL( expired, false );
         CPPUNIT_ASSERT( buffer != NULL );
 
@@ -113,41 +132,42 @@ public:
 
     void testAddMultiMid() {
         CRtcpAppMuxCtrlPacket* muxctrl1 = new CRtcpAppMuxCtrlPacket();
-        CRtcpAppMuxCtrlPacket* muxctrl2 = new CRtcpAppMuxCtrlPacket();
-        CRtcpAppMuxCtrlPacket* muxctrl3 = new CRtcpAppMuxCtrlPacket();
+        CRtcpAppMediaoptsPacket* mediaopts = new CRtcpAppMediaoptsPacket();
+        CRtcpAppSpiMapPacket* spimap = new CRtcpAppSpiMapPacket();
         bool expired;
         CPacketBuffer* buffer;
 
         CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl1), 0 );
-        CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl2), 0 );
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(mediaopts), 0 );
     
         CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl1 );
         CPPUNIT_ASSERT_EQUAL( expired, false );
         CPPUNIT_ASSERT( buffer != NULL );
 
         // add 3rd after 1st has been retrieved
-        CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl3), 0 );
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(spimap), 0 );
     
-        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl2 );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == mediaopts );
         CPPUNIT_ASSERT_EQUAL( expired, false );
         CPPUNIT_ASSERT( buffer != NULL );
 
-        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl3 );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == spimap );
         CPPUNIT_ASSERT_EQUAL( expired, false );
         CPPUNIT_ASSERT( buffer != NULL );
 
         CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == NULL );
 
         // do it twice to verify looping
+        clock.mNow += 250;
         CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl1 );
         CPPUNIT_ASSERT_EQUAL( expired, false );
         CPPUNIT_ASSERT( buffer != NULL );
 
-        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl2 );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == mediaopts );
         CPPUNIT_ASSERT_EQUAL( expired, false );
         CPPUNIT_ASSERT( buffer != NULL );
 
-        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl3 );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == spimap );
         CPPUNIT_ASSERT_EQUAL( expired, false );
         CPPUNIT_ASSERT( buffer != NULL );
 
@@ -158,6 +178,23 @@ public:
         CPPUNIT_ASSERT_EQUAL( mgr->Add(NULL), -1 );
     }
 
+    void testAddDuplicate() {
+        CRtcpAppMuxCtrlPacket* muxctrl1 = new CRtcpAppMuxCtrlPacket();
+        CRtcpAppMuxCtrlPacket muxctrl2;
+        CRtcpTipAckPacket ack(ACK_MUXCTRL);
+
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl1), 0 );
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(&muxctrl2), -1 );
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(&ack), -1 );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetNumPackets(), (uint32_t) 1 );
+
+        // once removed the type can be added again
+        CPPUNIT_ASSERT( mgr->Remove(MUXCTRL) == muxctrl1 );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetNumPackets(), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl1), 0 );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetNumPackets(), (uint32_t) 1 );
+    }
+
     void testGetInvalid() {
         CRtcpAppMuxCtrlPacket* muxctrl = new CRtcpAppMuxCtrlPacket();
         bool expired;
@@ -181,6 +218,7 @@ public:
         CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == NULL );
 
         // do it twice to verify looping
+        clock.mNow += 250;
         CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
         CPPUNIT_ASSERT_EQUAL( expired, false );
         CPPUNIT_ASSERT( buffer != NULL );
@@ -188,6 +226,7 @@ public:
         CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == NULL );
 
         // third time the packet should expire
+        clock.mNow += 250;
         CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
         CPPUNIT_ASSERT_EQUAL( expired, true );
         CPPUNIT_ASSERT( buffer == NULL );
@@ -224,6 +263,38 @@ public:
         delete muxctrl;
     }
 
+    void testAckMid() {
+        CRtcpAppMuxCtrlPacket* muxctrl = new CRtcpAppMuxCtrlPacket();
+        CRtcpAppMediaoptsPacket* mediaopts = new CRtcpAppMediaoptsPacket();
+        CRtcpAppSpiMapPacket* spimap = new CRtcpAppSpiMapPacket();
+        CRtcpTipAckPacket ack(ACK_MEDIAOPTS);
+        bool expired;
+        CPacketBuffer* buffer;
+
+        mediaopts->SetNtpTime(2);
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl), 0 );
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(mediaopts), 0 );
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(spimap), 0 );
+
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
+
+        // ack the next packet to be sent, transmit order should skip it
+        ack.SetNtpTime(2);
+        CPPUNIT_ASSERT_EQUAL( mgr->Ack(ack), (CRtcpTipPacket*) mediaopts );
+        CPPUNIT_ASSERT( mgr->Find(MEDIAOPTS) == NULL );
+
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == spimap );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == NULL );
+
+        clock.mNow += 250;
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == spimap );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == NULL );
+
+        // we own the memory as it was acked
+        delete mediaopts;
+    }
+
     void testRemove() {
         CRtcpAppMuxCtrlPacket* muxctrl = new CRtcpAppMuxCtrlPacket();
         bool expired;
@@ -278,6 +349,67 @@ public:
         CPPUNIT_ASSERT_EQUAL( sdes.GetChunkSSRC(0), (uint32_t) 0x12345678 );
     }
     
+    void testPackV() {
+        CRtcpRRPacket rr;
+        CRtcpSDESPacket sdes;
+        CRtcpAppMuxCtrlPacket muxctrl;
+        CPacketBufferData buffer;
+        struct iovec iov[CTipPacketManager::MAX_SEGMENTS];
+
+        mgr->EnableWrapper(0x12345678);
+        CPPUNIT_ASSERT_EQUAL( mgr->PackV(muxctrl, buffer, iov), (uint32_t) 2 );
+
+        // first segment is the wrapper, second is the packet
+        CPacketBuffer wrapper((uint8_t*) iov[0].iov_base, iov[0].iov_len);
+        CPPUNIT_ASSERT_EQUAL( rr.Unpack(wrapper), 0 );
+        CPPUNIT_ASSERT_EQUAL( sdes.Unpack(wrapper), 0 );
+        CPPUNIT_ASSERT_EQUAL( wrapper.GetBufferSize(), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( rr.GetSSRC(), (uint32_t) 0x12345678 );
+        CPPUNIT_ASSERT_EQUAL( sdes.GetChunkSSRC(0), (uint32_t) 0x12345678 );
+
+        CPPUNIT_ASSERT( iov[1].iov_base == buffer.GetBuffer() );
+        CPPUNIT_ASSERT_EQUAL( (uint32_t) iov[1].iov_len, muxctrl.GetPackSize() );
+
+        // wrapper follows the SSRC
+        mgr->EnableWrapper(0x9ABCDEF0);
+        buffer.Reset();
+        CPPUNIT_ASSERT_EQUAL( mgr->PackV(muxctrl, buffer, iov), (uint32_t) 2 );
+
+        CPacketBuffer wrapper2((uint8_t*) iov[0].iov_base, iov[0].iov_len);
+        CPPUNIT_ASSERT_EQUAL( rr.Unpack(wrapper2), 0 );
+        CPPUNIT_ASSERT_EQUAL( rr.GetSSRC(), (uint32_t) 0x9ABCDEF0 );
+    }
+    
+    void testPackVWithoutWrapper() {
+        CRtcpAppMuxCtrlPacket muxctrl;
+        CPacketBufferData buffer;
+        struct iovec iov[CTipPacketManager::MAX_SEGMENTS];
+
+        mgr->DisableWrapper();
+        CPPUNIT_ASSERT_EQUAL( mgr->PackV(muxctrl, buffer, iov), (uint32_t) 1 );
+        CPPUNIT_ASSERT( iov[0].iov_base == buffer.GetBuffer() );
+        CPPUNIT_ASSERT_EQUAL( (uint32_t) iov[0].iov_len, muxctrl.GetPackSize() );
+    }
+    
+    void testWrapV() {
+        CRtcpRRPacket rr;
+        uint8_t data[8] = { 0 };
+        struct iovec iov[CTipPacketManager::MAX_SEGMENTS];
+
+        mgr->EnableWrapper(0x12345678);
+        CPPUNIT_ASSERT_EQUAL( mgr->WrapV(data, sizeof(data), iov), (uint32_t) 2 );
+
+        CPacketBuffer wrapper((uint8_t*) iov[0].iov_base, iov[0].iov_len);
+        CPPUNIT_ASSERT_EQUAL( rr.Unpack(wrapper), 0 );
+        CPPUNIT_ASSERT_EQUAL( rr.GetSSRC(), (uint32_t) 0x12345678 );
+        CPPUNIT_ASSERT( iov[1].iov_base == data );
+        CPPUNIT_ASSERT_EQUAL( (uint32_t) iov[1].iov_len, (uint32_t) sizeof(data) );
+
+        mgr->DisableWrapper();
+        CPPUNIT_ASSERT_EQUAL( mgr->WrapV(data, sizeof(data), iov), (uint32_t) 1 );
+        CPPUNIT_ASSERT( iov[0].iov_base == data );
+    }
+    
     void testFind() {
         CRtcpAppMuxCtrlPacket* muxctrl = new CRtcpAppMuxCtrlPacket();
 
@@ -307,7 +439,7 @@ public:
         mgr->SetRetransmissionInterval(1000);
         
         CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl), 0 );
-        sleep(1);
+        clock.mNow += 1000;
 
         mgr->GetPacket(expired, &buffer);
         mgr->GetPacket(expired, &buffer);
@@ -316,21 +448,21 @@ public:
 
     void testTimerSend2() {
         CRtcpAppMuxCtrlPacket* muxctrl = new CRtcpAppMuxCtrlPacket();
-        CRtcpAppMuxCtrlPacket* muxctrl2 = new CRtcpAppMuxCtrlPacket();
+        CRtcpAppMediaoptsPacket* mediaopts = new CRtcpAppMediaoptsPacket();
         bool expired;
         CPacketBuffer* buffer;
     
         mgr->SetRetransmissionInterval(1000);
         
         CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl), 0 );
-        CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl2), 0 );
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(mediaopts), 0 );
 
         mgr->GetPacket(expired, &buffer);
         mgr->GetPacket(expired, &buffer);
         mgr->GetPacket(expired, &buffer);
         CPPUNIT_ASSERT( mgr->GetNextTransmitTime() > 900 );
 
-        sleep(1);
+        clock.mNow += 1000;
     
         mgr->GetPacket(expired, &buffer);
         CPPUNIT_ASSERT_EQUAL( mgr->GetNextTransmitTime(), (uint64_t) 0 );
@@ -340,6 +472,206 @@ public:
         CPPUNIT_ASSERT( mgr->GetNextTransmitTime() > 900 );
     }
 
+    void testPerPacketSchedule() {
+        CRtcpAppMuxCtrlPacket* muxctrl = new CRtcpAppMuxCtrlPacket();
+        CRtcpAppMediaoptsPacket* mediaopts = new CRtcpAppMediaoptsPacket();
+        bool expired;
+        CPacketBuffer* buffer;
+
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl), 0 );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetNextTransmitTime(), (uint64_t) 250 );
+
+        // a packet added later goes out right away without waiting
+        // for the first one
+        clock.mNow += 100;
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(mediaopts), 0 );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetNextTransmitTime(), (uint64_t) 0 );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == mediaopts );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == NULL );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetNextTransmitTime(), (uint64_t) 150 );
+
+        // and each is retransmitted on its own schedule
+        clock.mNow += 150;
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == NULL );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetNextTransmitTime(), (uint64_t) 100 );
+
+        clock.mNow += 100;
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == mediaopts );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == NULL );
+    }
+
+    void testBackoff() {
+        CRtcpAppMuxCtrlPacket* muxctrl = new CRtcpAppMuxCtrlPacket();
+        bool expired;
+        CPacketBuffer* buffer;
+
+        mgr->SetRetransmissionBackoff(2, 1000);
+        CPPUNIT_ASSERT_EQUAL( mgr->GetRetransmissionBackoff(), (uint32_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetRetransmissionMaxInterval(), (uint32_t) 1000 );
+        
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl), 0 );
+
+        uint64_t intervals[] = { 250, 500, 1000, 1000 };
+        for (uint32_t i = 0; i < (sizeof(intervals) / sizeof(intervals[0])); i++) {
+            CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
+            CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == NULL );
+            CPPUNIT_ASSERT_EQUAL( mgr->GetNextTransmitTime(), intervals[i] );
+            clock.mNow += intervals[i];
+        }
+    }
+
+    void testBackoffTimeout() {
+        CPPUNIT_ASSERT_EQUAL( mgr->GetPacketTimeoutMsec(), (uint64_t) 2500 );
+
+        // 250 + 500 + 8 * 1000
+        mgr->SetRetransmissionBackoff(2, 1000);
+        CPPUNIT_ASSERT_EQUAL( mgr->GetPacketTimeoutMsec(), (uint64_t) 8750 );
+
+        // without a cap
+        mgr->SetRetransmissionBackoff(2, 0);
+        mgr->SetRetransmissionLimit(3);
+        CPPUNIT_ASSERT_EQUAL( mgr->GetPacketTimeoutMsec(), (uint64_t) 1750 );
+
+        // each interval may be stretched by up to 20%
+        mgr->SetRetransmissionJitter(20);
+        CPPUNIT_ASSERT_EQUAL( mgr->GetPacketTimeoutMsec(), (uint64_t) 2100 );
+    }
+
+    void testJitter() {
+        bool expired;
+        CPacketBuffer* buffer;
+        bool varied = false;
+
+        mgr->SetRetransmissionJitter(20);
+        CPPUNIT_ASSERT_EQUAL( mgr->GetRetransmissionJitter(), (uint32_t) 20 );
+
+        for (uint32_t i = 0; i < 100; i++) {
+            CRtcpAppMuxCtrlPacket* muxctrl = new CRtcpAppMuxCtrlPacket();
+            CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl), 0 );
+            CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
+
+            uint64_t next = mgr->GetNextTransmitTime();
+            CPPUNIT_ASSERT( next >= 200 && next <= 300 );
+            if (next != 250) {
+                varied = true;
+            }
+            
+            delete mgr->Remove(MUXCTRL);
+        }
+
+        CPPUNIT_ASSERT( varied );
+    }
+    
+    void testRttSample() {
+        CRtcpAppMuxCtrlPacket* muxctrl = new CRtcpAppMuxCtrlPacket();
+        CRtcpTipAckPacket ack(ACK_MUXCTRL);
+        bool expired;
+        CPacketBuffer* buffer;
+
+        CPPUNIT_ASSERT_EQUAL( mgr->GetRttEstimator().HasSample(), false );
+
+        muxctrl->SetNtpTime(1);
+        ack.SetNtpTime(1);
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl), 0 );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
+
+        clock.mNow += 40;
+        CPPUNIT_ASSERT_EQUAL( mgr->Ack(ack), (CRtcpTipPacket*) muxctrl );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetRttEstimator().GetSRTT(), (uint32_t) 40 );
+
+        delete muxctrl;
+    }
+
+    void testRttKarn() {
+        CRtcpAppMuxCtrlPacket* muxctrl = new CRtcpAppMuxCtrlPacket();
+        CRtcpTipAckPacket ack(ACK_MUXCTRL);
+        bool expired;
+        CPacketBuffer* buffer;
+
+        muxctrl->SetNtpTime(1);
+        ack.SetNtpTime(1);
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl), 0 );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
+        clock.mNow += 250;
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
+
+        // ACK of a retransmitted packet is not timed
+        clock.mNow += 40;
+        CPPUNIT_ASSERT_EQUAL( mgr->Ack(ack), (CRtcpTipPacket*) muxctrl );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetRttEstimator().HasSample(), false );
+
+        delete muxctrl;
+    }
+
+    void testAckLatency() {
+        CRtcpAppMuxCtrlPacket* muxctrl = new CRtcpAppMuxCtrlPacket();
+        CRtcpTipAckPacket ack(ACK_MUXCTRL);
+        bool expired;
+        CPacketBuffer* buffer;
+        uint32_t latency = 1234;
+
+        muxctrl->SetNtpTime(1);
+        ack.SetNtpTime(1);
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl), 0 );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetTxCount(MUXCTRL), (uint32_t) 0 );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetTxCount(MUXCTRL), (uint32_t) 1 );
+        clock.mNow += 250;
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetTxCount(MUXCTRL), (uint32_t) 2 );
+
+        // latency covers retransmissions, from the first transmission
+        clock.mNow += 40;
+        CPPUNIT_ASSERT_EQUAL( mgr->Ack(ack, &latency), (CRtcpTipPacket*) muxctrl );
+        CPPUNIT_ASSERT_EQUAL( latency, (uint32_t) 290 );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetTxCount(MUXCTRL), (uint32_t) 0 );
+
+        // no match leaves it alone
+        latency = 1234;
+        CPPUNIT_ASSERT( mgr->Ack(ack, &latency) == NULL );
+        CPPUNIT_ASSERT_EQUAL( latency, (uint32_t) 1234 );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetTxCount(MAX_PACKET_TYPE), (uint32_t) 0 );
+
+        delete muxctrl;
+    }
+
+    void testAdaptiveInterval() {
+        CRtcpAppMuxCtrlPacket* muxctrl = new CRtcpAppMuxCtrlPacket();
+        CRtcpTipAckPacket ack(ACK_MUXCTRL);
+        bool expired;
+        CPacketBuffer* buffer;
+
+        mgr->EnableAdaptiveInterval(10, 1000);
+        CPPUNIT_ASSERT_EQUAL( mgr->IsAdaptiveInterval(), true );
+
+        // no measurement yet, use the configured interval
+        CPPUNIT_ASSERT_EQUAL( mgr->GetBaseInterval(), (uint32_t) 250 );
+        
+        muxctrl->SetNtpTime(1);
+        ack.SetNtpTime(1);
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl), 0 );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetNextTransmitTime(), (uint64_t) 250 );
+        
+        clock.mNow += 40;
+        CPPUNIT_ASSERT_EQUAL( mgr->Ack(ack), (CRtcpTipPacket*) muxctrl );
+
+        // SRTT + 4 * RTTVAR = 40 + 4 * 20
+        CPPUNIT_ASSERT_EQUAL( mgr->GetBaseInterval(), (uint32_t) 120 );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetPacketTimeoutMsec(), (uint64_t) 1200 );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetConfiguredTimeoutMsec(), (uint64_t) 2500 );
+
+        muxctrl->SetNtpTime(2);
+        CPPUNIT_ASSERT_EQUAL( mgr->Add(muxctrl), 0 );
+        CPPUNIT_ASSERT( mgr->GetPacket(expired, &buffer) == muxctrl );
+        CPPUNIT_ASSERT_EQUAL( mgr->GetNextTransmitTime(), (uint64_t) 120 );
+
+        mgr->DisableAdaptiveInterval();
+        CPPUNIT_ASSERT_EQUAL( mgr->GetBaseInterval(), (uint32_t) 250 );
+    }
+    
     CPPUNIT_TEST_SUITE( CTipPacketManagerTest );
     CPPUNIT_TEST( testCreate );
     CPPUNIT_TEST( testInterval );
@@ -348,17 +680,30 @@ public:
     CPPUNIT_TEST( testAddMulti );
     CPPUNIT_TEST( testAddMultiMid );
     CPPUNIT_TEST( testAddInvalid );
+    CPPUNIT_TEST( testAddDuplicate );
     CPPUNIT_TEST( testGetInvalid );
     CPPUNIT_TEST( testRetransLimit );
     CPPUNIT_TEST( testAck );
+    CPPUNIT_TEST( testAckMid );
     CPPUNIT_TEST( testRemove );
     CPPUNIT_TEST( testAddWithoutWrapper );
     CPPUNIT_TEST( testAddWithWrapper );
+    CPPUNIT_TEST( testPackV );
+    CPPUNIT_TEST( testPackVWithoutWrapper );
+    CPPUNIT_TEST( testWrapV );
     CPPUNIT_TEST( testFind );
     CPPUNIT_TEST( testTimerDefault );
     CPPUNIT_TEST( testTimerAdd );
     CPPUNIT_TEST( testTimerSend );
     CPPUNIT_TEST( testTimerSend2 );
+    CPPUNIT_TEST( testPerPacketSchedule );
+    CPPUNIT_TEST( testBackoff );
+    CPPUNIT_TEST( testBackoffTimeout );
+    CPPUNIT_TEST( testJitter );
+    CPPUNIT_TEST( testRttSample );
+    CPPUNIT_TEST( testRttKarn );
+    CPPUNIT_TEST( testAckLatency );
+    CPPUNIT_TEST( testAdaptiveInterval );
     CPPUNIT_TEST_SUITE_END();
 };
 
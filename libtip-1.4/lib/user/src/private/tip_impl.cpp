@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
 #include <algorithm>
 
 #include "rtcp_tip_types.h"
@@ -25,6 +29,22 @@
 #include "private/tip_impl.h"
 using namespace LibTip;
 
+// an ECHO carrying a receive time is the remote's reply to our ECHO
+static bool IsEchoReply(const CRtcpTipPacket& packet)
+{
+    if (packet.GetTipPacketType() != TIPECHO) {
+        return false;
+    }
+
+    const CRtcpAppEchoPacket* echo = dynamic_cast<const CRtcpAppEchoPacket*>(&packet);
+    return (echo != NULL && echo->GetRcvNtpTime() != 0);
+}
+
+// number of instances created, mixed into each instance's random
+// seed so sessions created in the same second, possibly on different
+// threads, do not pick the same default SSRC
+static uint32_t gInstanceCount = 0;
+
 CTipImpl::CTipImpl(CTipPacketTransmit& xmit) :
     mPacketXmit(xmit), mPresImpl(this)
 {
@@ -35,16 +55,20 @@ CTipImpl::CTipImpl(CTipPacketTransmit& xmit) :
     CTipCallback* callback = new CTipCallback();
     mpCallback = new CTipCallbackWrapper(callback);
 
-    // seed random with time()
-    srand(time(NULL));
+    // seed random with time() and the instance count
+    unsigned int seed = (time(NULL) ^ getpid() ^
+                         (__atomic_fetch_add(&gInstanceCount, 1, __ATOMIC_RELAXED) * 2654435761U));
     
     for (MediaType mType = VIDEO; mType < MT_MAX; ++mType) {
         mpTipNegLocalState[mType] = &gStopLocalState;
         mpTipNegRemoteState[mType] = &gStopRemoteState;
 
         mMuxCtrlTime[mType] = 0;
+        mTipNegTimerId[mType] = CTipTimer::INVALID_ID;
+        mNegStartTime[mType] = 0;
+        mNegTimed[mType] = false;
 
-        SetRTCPSSRC(mType, rand());
+        SetRTCPSSRC(mType, rand_r(&seed));
     }
 }
 
@@ -83,6 +107,10 @@ Status CTipImpl::StartTipNegotiate(MediaType mType)
         return TIP_ERROR;
     }
 
+    // time the negotiation until our MEDIAOPTS is acked
+    mNegStartTime[mType] = GetMsecTimestamp();
+    mNegTimed[mType] = true;
+    
     AMDEBUG(USER, ("exit %s OK", GetMediaString(mType)));
     return TIP_OK;
 }
@@ -95,6 +123,7 @@ Status CTipImpl::StopTipNegotiate(MediaType mType)
 
     mpTipNegLocalState[mType]->Stop(this, mType);
     mpTipNegRemoteState[mType]->Stop(this, mType);
+    mNegTimed[mType] = false;
     
     return TIP_OK;
 }
@@ -120,6 +149,8 @@ Status CTipImpl::StopPresentation()
 
 Status CTipImpl::ReceivePacket(uint8_t* buffer, uint32_t size, MediaType mType)
 {
+    CTipTimeCache now;
+    
     // only return an error if the packet did not contain any TIP
     // packets
     Status ret = TIP_ERROR;
@@ -128,17 +159,25 @@ Status CTipImpl::ReceivePacket(uint8_t* buffer, uint32_t size, MediaType mType)
         return ret;
     }
     
-    CPacketBuffer packetBuf(buffer, size);
+    CRtcpCompoundView compound(buffer, size);
+    CRtcpPacketView view;
 
     AMDEBUG(RECV, ("recv %s rtcp packet buffer size %d bytes",
                    GetMediaString(mType), size));
     
-    while (packetBuf.GetBufferSize()) {
-        CRtcpPacket* rtcp = CRtcpPacketFactory::CreatePacketFromBuffer(packetBuf);
+    while (compound.Next(view) == 0) {
+        // skip anything that is not a TIP packet (e.g. the RR and
+        // SDES of a compound packet) without constructing it
+        if (view.GetTipPacketType() == MAX_PACKET_TYPE) {
+            continue;
+        }
+
+        CRtcpPacket* rtcp = CRtcpPacketFactory::CreatePacketFromView(view);
 
         if (rtcp == NULL) {
             // something we couldn't parse, keep going until the
             // buffer is empty
+            mStats[mType].Increment(CTipStats::RX_PARSE_ERROR);
             continue;
         }
 
@@ -154,9 +193,10 @@ Status CTipImpl::ReceivePacket(uint8_t* buffer, uint32_t size, MediaType mType)
         // if we make it to here then we have at least one TIP packet
         // to process.
         ret = TIP_OK;
+        mStats[mType].IncrementReceived(packet->GetTipPacketType());
         
-        // process ACK packets
-        if (IsAckTipPacketType(packet->GetTipPacketType())) {
+        // process ACK packets.  replies to our ECHO are ACKs too.
+        if (IsAckTipPacketType(packet->GetTipPacketType()) || IsEchoReply(*packet)) {
             ProcessAckPacket(packet, mType);
             delete packet;
             continue;
@@ -170,6 +210,7 @@ Status CTipImpl::ReceivePacket(uint8_t* buffer, uint32_t size, MediaType mType)
                            packet->GetTipPacketTypeString(),
                            packet->GetNtpTime()));
 
+            mStats[mType].Increment(CTipStats::RX_DROP);
             delete packet;
             
         } else if (action == CTipPacketReceiver::AMPR_DUP) {
@@ -178,6 +219,7 @@ Status CTipImpl::ReceivePacket(uint8_t* buffer, uint32_t size, MediaType mType)
                            packet->GetTipPacketTypeString(),
                            packet->GetNtpTime()));
 
+            mStats[mType].Increment(CTipStats::RX_DUPLICATE);
             AckDuplicatePacket(packet, mType);
             delete packet;
             
@@ -193,6 +235,11 @@ Status CTipImpl::ReceivePacket(uint8_t* buffer, uint32_t size, MediaType mType)
         }
     }
 
+    // the rest of the buffer could not be walked
+    if (compound.HasError()) {
+        mStats[mType].Increment(CTipStats::RX_PARSE_ERROR);
+    }
+
     return ret;
 }
 
@@ -304,11 +351,14 @@ void CTipImpl::ProcessPacket(CRtcpTipPacket* packet, MediaType mType)
 
 void CTipImpl::ProcessAckPacket(CRtcpTipPacket* packet, MediaType mType)
 {
-    CRtcpTipPacket* acked = mPacketManager[mType].Ack(*packet);
+    uint32_t latency;
+    CRtcpTipPacket* acked = mPacketManager[mType].Ack(*packet, &latency);
     if (acked == NULL) {
         // received an ACK for something we don't know anything about.  just drop it.
         return;
     }
+
+    mStats[mType].AddAckLatency(latency);
         
     TipPacketType ackedType = acked->GetTipPacketType();
     AMDEBUG(RECV, ("recv ack for xmit packet type %s",
@@ -328,6 +378,11 @@ void CTipImpl::ProcessAckPacket(CRtcpTipPacket* packet, MediaType mType)
         } else {
             mPresImpl.ProcessAckPacket(rtsack);
         }
+
+    } else if (ackedType == TIPECHO) {
+        AMDEBUG(RECV, ("%s round trip time %u ms",
+                       GetMediaString(mType),
+                       mPacketManager[mType].GetRttEstimator().GetSRTT()));
     }
     
     delete acked;
@@ -345,6 +400,54 @@ void CTipImpl::SetRetransmissionLimit(uint32_t limit)
     mPacketManager[AUDIO].SetRetransmissionLimit(limit);
 }
 
+void CTipImpl::SetRetransmissionBackoff(uint32_t multiplier, uint32_t maxIntervalMS)
+{
+    mPacketManager[VIDEO].SetRetransmissionBackoff(multiplier, maxIntervalMS);
+    mPacketManager[AUDIO].SetRetransmissionBackoff(multiplier, maxIntervalMS);
+}
+
+void CTipImpl::SetRetransmissionJitter(uint32_t percent)
+{
+    mPacketManager[VIDEO].SetRetransmissionJitter(percent);
+    mPacketManager[AUDIO].SetRetransmissionJitter(percent);
+}
+
+void CTipImpl::EnableAdaptiveRetransmission(uint32_t minIntervalMS, uint32_t maxIntervalMS)
+{
+    mPacketManager[VIDEO].EnableAdaptiveInterval(minIntervalMS, maxIntervalMS);
+    mPacketManager[AUDIO].EnableAdaptiveInterval(minIntervalMS, maxIntervalMS);
+}
+
+void CTipImpl::DisableAdaptiveRetransmission()
+{
+    mPacketManager[VIDEO].DisableAdaptiveInterval();
+    mPacketManager[AUDIO].DisableAdaptiveInterval();
+}
+
+uint32_t CTipImpl::GetRoundTripTime(MediaType mType) const
+{
+    if (mType >= MT_MAX) {
+        return 0;
+    }
+
+    return mPacketManager[mType].GetRttEstimator().GetSRTT();
+}
+
+Status CTipImpl::SendEcho(MediaType mType)
+{
+    if (mType >= MT_MAX) {
+        return TIP_ERROR;
+    }
+    
+    CRtcpAppEchoPacket* echo = new CRtcpAppEchoPacket();
+    if (echo == NULL) {
+        return TIP_ERROR;
+    }
+
+    StartPacketTx(echo, mType);
+    return TIP_OK;
+}
+
 void CTipImpl::StartPacketTx(CRtcpTipPacket* packet, MediaType mType)
 {
     AMDEBUG(XMIT, ("starting %s packet tx for type %s",
@@ -362,7 +465,13 @@ void CTipImpl::StartPacketTx(CRtcpTipPacket* packet, MediaType mType)
 
     packet->SetSSRC(mSSRC[mType]);
     packet->SetNtpTime(ntpTime);
-    mPacketManager[mType].Add(packet);
+    if (mPacketManager[mType].Add(packet) != 0) {
+        AMDEBUG(INTERR, ("could not queue %s packet type %s",
+                         GetMediaString(mType),
+                         packet->GetTipPacketTypeString()));
+        delete packet;
+        return;
+    }
     PrintPacket(packet, mType, false);
 }
 
@@ -374,6 +483,8 @@ void CTipImpl::StopPacketTx(TipPacketType pType, MediaType mType)
 
 uint64_t CTipImpl::GetIdleTime() const
 {
+    CTipTimeCache now;
+    
     // return lowest of the packet manager and timer idle times
     uint64_t retV = mPacketManager[VIDEO].GetNextTransmitTime();
     uint64_t retA = mPacketManager[AUDIO].GetNextTransmitTime();
@@ -384,6 +495,8 @@ uint64_t CTipImpl::GetIdleTime() const
 
 void CTipImpl::DoPeriodicActivity()
 {
+    CTipTimeCache now;
+    
     for (MediaType mType = VIDEO; mType < MT_MAX; ++mType) {
         if (mPacketManager[mType].GetNextTransmitTime() == 0) {
             // time to send out some packets
@@ -402,6 +515,12 @@ void CTipImpl::DoPeriodicActivity()
                                    packet->GetTipPacketTypeString(),
                                    buffer->GetBufferSize()));
 
+                    if (mPacketManager[mType].GetTxCount(packet->GetTipPacketType()) > 1) {
+                        mStats[mType].Increment(CTipStats::TX_RETRANSMIT);
+                    } else {
+                        mStats[mType].Increment(CTipStats::TX_FIRST);
+                    }
+                    
                     RelayPacket(buffer, mType);
                 }
             
@@ -445,9 +564,45 @@ void CTipImpl::SetRTCPSSRC(MediaType mType, uint32_t ssrc)
     mPacketManager[mType].EnableWrapper(mSSRC[mType]);
 }
 
+void CTipImpl::SetPacketDumpLimit(uint32_t count, uint32_t intervalMS)
+{
+    mDumpLimit.SetLimit(count, intervalMS);
+}
+
+Status CTipImpl::GetStats(MediaType mType, CTipStats& stats) const
+{
+    if (mType >= MT_MAX) {
+        return TIP_ERROR;
+    }
+
+    stats = mStats[mType];
+    return TIP_OK;
+}
+
+Status CTipImpl::GetNegotiationTime(MediaType mType, CTipHistogram& hist) const
+{
+    if (mType >= MT_MAX) {
+        return TIP_ERROR;
+    }
+
+    hist = mNegotiationTime[mType];
+    return TIP_OK;
+}
+
+void CTipImpl::SetNegotiationTraceSize(uint32_t numEvents)
+{
+    mNegTrace.SetSize(numEvents);
+}
+
+void CTipImpl::WriteNegotiationTrace(std::ostream& output, uint32_t pid, bool complete) const
+{
+    mNegTrace.Write(output, pid, GetUsecTimestamp(), complete);
+}
+
 void CTipImpl::HandleTimeout(CRtcpTipPacket* packet, MediaType mType)
 {
     TipPacketType pType = packet->GetTipPacketType();
+    mStats[mType].Increment(CTipStats::TX_EXPIRED);
 
     AMDEBUG(USER, ("timeout for packet type %s", GetTipPacketTypeString(pType)));
     
@@ -502,16 +657,25 @@ void CTipImpl::TransmitAck(CRtcpTipPacket* ack, const CRtcpTipPacket* packet,
     // setup header
     ack->SetSSRC(mSSRC[mType]);
     
-    // pack ACK into a buffer and sent it out
+    // pack ACK into a buffer and send it out behind the shared
+    // wrapper
     CPacketBufferData buffer;
-    mPacketManager[mType].Pack(*ack, buffer);
+    struct iovec iov[CTipPacketManager::MAX_SEGMENTS];
+    uint32_t iovcnt = mPacketManager[mType].PackV(*ack, buffer, iov);
+    if (iovcnt == 0) {
+        AMDEBUG(INTERR, ("could not pack %s ack type %s",
+                         GetMediaString(mType),
+                         ack->GetTipPacketTypeString()));
+        delete ack;
+        return;
+    }
 
     AMDEBUG(XMIT, ("xmit ack for %s packet type %s.  ack type %s size %d bytes",
                    GetMediaString(mType),
                    packet->GetTipPacketTypeString(),
                    ack->GetTipPacketTypeString(), buffer.GetBufferSize()));
     
-    RelayPacket(&buffer, mType);
+    mPacketXmit.TransmitV(iov, iovcnt, mType);
 
     // notify our receiver that this packet has been acked.
     // duplicates will now be acked as well.  receiver now owns the
@@ -568,6 +732,12 @@ void CTipImpl::OnRxMCAckAfterNegotiate(CRtcpTipPacket& ack, MediaType mType)
 
 void CTipImpl::OnRxMOAck(MediaType mType)
 {
+    if (mNegTimed[mType]) {
+        uint64_t elapsed = (GetMsecTimestamp() - mNegStartTime[mType]);
+        mNegotiationTime[mType].Add(elapsed > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t) elapsed);
+        mNegTimed[mType] = false;
+    }
+    
     SetLocalState(mType, &gDoneLocalState);
     UpdateNegotiatedSystem();
     mpCallback->TipNegotiationLastAckReceived(mType);
@@ -594,6 +764,7 @@ void CTipImpl::OnLocalStop(MediaType mType)
     SetLocalState(mType, &gStopLocalState);
 
     mTimer.Cancel(mTipNegTimerId[mType]);
+    mTipNegTimerId[mType] = CTipTimer::INVALID_ID;
 
     StopPacketTx(MUXCTRL, mType);
     StopPacketTx(MEDIAOPTS, mType);
@@ -606,8 +777,9 @@ void CTipImpl::OnRemoteStart(MediaType mType)
     mPacketReceiver[mType].Forget(MEDIAOPTS);
     
     // start timer waiting for tip negotiation to timeout.  timeout
-    // interval is the packet timeout interval.
-    uint64_t timeout = mPacketManager[mType].GetPacketTimeoutMsec();
+    // interval is the packet timeout interval of the remote side,
+    // which retransmits on the configured interval not our RTO.
+    uint64_t timeout = mPacketManager[mType].GetConfiguredTimeoutMsec();
     mTipNegTimerId[mType] = mTimer.Register(CTipTimer::AMT_TIP_NEGOTIATE,
                                             timeout, mType);
     
@@ -892,6 +1064,7 @@ void CTipImpl::SetLocalState(MediaType mType, CLocalState* state)
                      state->GetName()));
     
     mpTipNegLocalState[mType] = state;
+    mNegTrace.Add(mType, true, state->GetName(), GetUsecTimestamp());
 }
 
 void CTipImpl::SetRemoteState(MediaType mType, CRemoteState* state)
@@ -902,6 +1075,7 @@ void CTipImpl::SetRemoteState(MediaType mType, CRemoteState* state)
                      state->GetName()));
     
     mpTipNegRemoteState[mType] = state;
+    mNegTrace.Add(mType, false, state->GetName(), GetUsecTimestamp());
 }
 
 void CTipImpl::UpdateNegotiatedSystem()
@@ -913,8 +1087,18 @@ void CTipImpl::UpdateNegotiatedSystem()
     AMDEBUG(TIPNEG, ("negotiated system dump:%s", stream.str().c_str()));
 }
 
-void CTipImpl::PrintPacket(const CRtcpTipPacket* packet, MediaType mType, bool isRX) const
+void CTipImpl::PrintPacket(const CRtcpTipPacket* packet, MediaType mType, bool isRX)
 {
+    // only format the dump if it is going to be printed
+    uint32_t suppressed = 0;
+    if (! AMDEBUG_ENABLED(TIPNEG) || ! mDumpLimit.Allow(GetMsecTimestamp(), suppressed)) {
+        return;
+    }
+
+    if (suppressed != 0) {
+        AMDEBUG(TIPNEG, ("%u packet dumps suppressed", suppressed));
+    }
+    
     std::ostringstream stream;
     packet->ToStream(stream, mType);
     AMDEBUG(TIPNEG, ("%s %s packet dump:%s",
@@ -21,12 +21,15 @@
 #include <sstream>
 
 #include "tip_constants.h"
+#include "tip_log_limit.h"
+#include "tip_stats.h"
 #include "rtcp_packet.h"
 #include "rtcp_tip_packet_manager.h"
 #include "rtcp_tip_types.h"
 #include "tip_callback_wrapper.h"
 #include "tip_packet_transmit.h"
 #include "private/tip_negotiate_state.h"
+#include "private/tip_negotiate_trace.h"
 #include "private/map_tip_system.h"
 #include "private/tip_packet_receiver.h"
 #include "private/tip_timer.h"
@@ -177,6 +180,53 @@ namespace LibTip {
          */
         void SetRetransmissionLimit(uint32_t limit);
 
+        /**
+         * Enable exponential backoff of Tip packet retransmissions.
+         *
+         * @param multiplier factor applied to the interval after each
+         * retransmission, 1 disables backoff
+         * @param maxIntervalMS largest interval between
+         * retransmissions, in milliseconds, 0 means no limit
+         */
+        void SetRetransmissionBackoff(uint32_t multiplier, uint32_t maxIntervalMS);
+
+        /**
+         * Randomize Tip packet retransmission intervals.
+         *
+         * @param percent maximum jitter, in percent of the interval
+         */
+        void SetRetransmissionJitter(uint32_t percent);
+
+        /**
+         * Derive the retransmission interval from the measured round
+         * trip time.
+         *
+         * @param minIntervalMS smallest retransmission interval, in milliseconds
+         * @param maxIntervalMS largest retransmission interval, in milliseconds
+         */
+        void EnableAdaptiveRetransmission(uint32_t minIntervalMS, uint32_t maxIntervalMS);
+
+        /**
+         * Go back to the fixed retransmission interval.
+         */
+        void DisableAdaptiveRetransmission();
+
+        /**
+         * Get the smoothed round trip time.
+         *
+         * @param mType the type of media to get the round trip time for
+         * @return round trip time in milliseconds, 0 if unknown
+         */
+        uint32_t GetRoundTripTime(MediaType mType) const;
+
+        /**
+         * Send a Tip ECHO packet.
+         *
+         * @param mType the type of media to send the ECHO on
+         * @return TIP_OK if the ECHO was queued, otherwise TIP_ERROR
+         */
+        Status SendEcho(MediaType mType);
+
         /**
          * Get the idle time until the next Tip action.  Get the
          * amount of time until the next Tip action needs to occur
@@ -219,6 +269,50 @@ namespace LibTip {
          * @param ssrc the new SSRC value
          */
         void SetRTCPSSRC(MediaType mType, uint32_t ssrc);
+
+        /**
+         * Limit the rate of packet dumps.
+         *
+         * @param count packet dumps allowed per interval, 0 for no limit
+         * @param intervalMS length of the interval, in milliseconds
+         */
+        void SetPacketDumpLimit(uint32_t count, uint32_t intervalMS);
+
+        /**
+         * Get the statistics for one media type.
+         *
+         * @param mType the media type to get statistics for
+         * @param stats filled in with a copy of the statistics
+         * @return TIP_OK on success, TIP_ERROR for an invalid type
+         */
+        Status GetStats(MediaType mType, CTipStats& stats) const;
+
+        /**
+         * Get the negotiation time histogram for one media type.
+         *
+         * @param mType the media type to get the histogram for
+         * @param hist filled in with a copy of the histogram
+         * @return TIP_OK on success, TIP_ERROR for an invalid type
+         */
+        Status GetNegotiationTime(MediaType mType, CTipHistogram& hist) const;
+
+        /**
+         * Set the number of state changes kept in the negotiation
+         * trace, 0 disables tracing.
+         *
+         * @param numEvents number of state changes to keep
+         */
+        void SetNegotiationTraceSize(uint32_t numEvents);
+
+        /**
+         * Write the negotiation trace as Chrome trace event JSON.
+         *
+         * @param output stream to write the trace to
+         * @param pid trace process id of this session
+         * @param complete write a complete JSON object or only the
+         * events
+         */
+        void WriteNegotiationTrace(std::ostream& output, uint32_t pid, bool complete) const;
         
         //
         // Impl specific public methods, not exposed to user
@@ -366,7 +460,7 @@ namespace LibTip {
 
         void UpdateNegotiatedSystem();
 
-        void PrintPacket(const CRtcpTipPacket* packet, MediaType mType, bool isRX) const;
+        void PrintPacket(const CRtcpTipPacket* packet, MediaType mType, bool isRX);
         
         CMapTipSystem        mSystem;
         CMapTipSystem        mRemoteSystem;
@@ -386,6 +480,17 @@ namespace LibTip {
         uint32_t             mTipNegTimerId[MT_MAX];
         uint64_t             mMuxCtrlTime[MT_MAX];
 
+        CTipLogLimiter       mDumpLimit;
+
+        // statistics and the start of the negotiation being timed
+        CTipStats            mStats[MT_MAX];
+        CTipHistogram        mNegotiationTime[MT_MAX];
+        uint64_t             mNegStartTime[MT_MAX];
+        bool                 mNegTimed[MT_MAX];
+
+        // timeline of local and remote state changes
+        CTipNegotiateTrace   mNegTrace;
+
     private:
         // do not allow copy or assignment
         CTipImpl(const CTipImpl&);
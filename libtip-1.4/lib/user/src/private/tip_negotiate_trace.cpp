@@ -0,0 +1,112 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "private/tip_negotiate_trace.h"
+using namespace LibTip;
+
+CTipNegotiateTrace::CTipNegotiateTrace(uint32_t maxEvents)
+{
+    SetSize(maxEvents);
+}
+
+void CTipNegotiateTrace::SetSize(uint32_t maxEvents)
+{
+    mEvents.resize(maxEvents);
+    Clear();
+}
+
+void CTipNegotiateTrace::Clear()
+{
+    mHead = 0;
+    mNumEvents = 0;
+}
+
+void CTipNegotiateTrace::Add(MediaType mType, bool local, const char* state,
+                             uint64_t timeUsec)
+{
+    if (mEvents.empty() || mType >= MT_MAX) {
+        return;
+    }
+
+    uint32_t index;
+    if (mNumEvents < mEvents.size()) {
+        index = ((mHead + mNumEvents) % mEvents.size());
+        mNumEvents++;
+    } else {
+        // full, replace the oldest
+        index = mHead;
+        mHead = ((mHead + 1) % mEvents.size());
+    }
+
+    mEvents[index].mTime = timeUsec;
+    mEvents[index].mState = state;
+    mEvents[index].mTrack = GetTrack(mType, local);
+}
+
+void CTipNegotiateTrace::Write(std::ostream& o, uint32_t pid, uint64_t nowUsec,
+                               bool complete) const
+{
+    // walk newest to oldest to find when each state was left, the
+    // current state of each track lasts until now
+    std::vector<uint64_t> end(mNumEvents);
+    uint64_t trackEnd[NUM_TRACKS];
+    bool used[NUM_TRACKS];
+
+    for (uint32_t i = 0; i < NUM_TRACKS; i++) {
+        trackEnd[i] = nowUsec;
+        used[i] = false;
+    }
+    
+    for (uint32_t i = mNumEvents; i > 0; i--) {
+        const Event& event = mEvents[((mHead + i - 1) % mEvents.size())];
+
+        end[i - 1] = trackEnd[event.mTrack];
+        trackEnd[event.mTrack] = event.mTime;
+        used[event.mTrack] = true;
+    }
+
+    if (complete) {
+        o << "{\"traceEvents\":[\n";
+    }
+
+    // name the tracks that have events
+    const char* sep = "";
+    for (uint32_t i = 0; i < NUM_TRACKS; i++) {
+        if (! used[i]) {
+            continue;
+        }
+
+        o << sep << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+          << ",\"tid\":" << (i + 1) << ",\"args\":{\"name\":\""
+          << GetMediaString((MediaType) (i / 2))
+          << (((i % 2) == 0) ? " local" : " remote") << "\"}}";
+        sep = ",\n";
+    }
+    
+    for (uint32_t i = 0; i < mNumEvents; i++) {
+        const Event& event = mEvents[((mHead + i) % mEvents.size())];
+        uint64_t dur = (end[i] > event.mTime ? (end[i] - event.mTime) : 0);
+
+        o << sep << "{\"name\":\"" << event.mState
+          << "\",\"cat\":\"tipneg\",\"ph\":\"X\",\"ts\":" << event.mTime
+          << ",\"dur\":" << dur << ",\"pid\":" << pid
+          << ",\"tid\":" << (event.mTrack + 1) << "}";
+        sep = ",\n";
+    }
+
+    if (complete) {
+        o << "\n]}\n";
+    }
+}
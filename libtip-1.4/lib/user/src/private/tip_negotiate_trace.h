@@ -0,0 +1,83 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TIP_NEGOTIATE_TRACE_H
+#define TIP_NEGOTIATE_TRACE_H
+
+#include <iostream>
+#include <vector>
+#include "tip_constants.h"
+
+namespace LibTip {
+
+    // trace of Tip negotiation state changes.  the most recent
+    // changes of the local and remote state machines of each media
+    // type are kept in a fixed size ring with a microsecond
+    // timestamp and can be written out as Chrome trace event JSON
+    // (chrome://tracing, Perfetto) to show the time spent in each
+    // state on a timeline.
+    class CTipNegotiateTrace {
+    public:
+        CTipNegotiateTrace(uint32_t maxEvents = DEFAULT_SIZE);
+
+        static const uint32_t DEFAULT_SIZE = 64;
+
+        // change the number of events kept, clears the trace.  0
+        // disables tracing.
+        void SetSize(uint32_t maxEvents);
+        uint32_t GetSize() const { return mEvents.size(); }
+
+        // number of events held, at most GetSize()
+        uint32_t GetNumEvents() const { return mNumEvents; }
+
+        // forget all events
+        void Clear();
+
+        // record that the local or remote state machine of mType
+        // entered state at timeUsec.  state must outlive the trace,
+        // the state names are string literals.  once the ring is full
+        // the oldest event is replaced.
+        void Add(MediaType mType, bool local, const char* state, uint64_t timeUsec);
+
+        // write the trace as Chrome trace event JSON.  each state is
+        // a complete event lasting until the next change of the same
+        // state machine, the current state lasts until nowUsec.  pid
+        // identifies the session in the trace.  if complete is false
+        // only the events are written, separated by commas, so the
+        // events of several sessions can be joined into one
+        // traceEvents array.
+        void Write(std::ostream& o, uint32_t pid, uint64_t nowUsec, bool complete) const;
+
+    protected:
+        struct Event {
+            uint64_t    mTime;
+            const char* mState;
+            uint8_t     mTrack;
+        };
+
+        // one track (trace thread) per media type and side
+        static const uint32_t NUM_TRACKS = (MT_MAX * 2);
+
+        static uint8_t GetTrack(MediaType mType, bool local) {
+            return ((mType * 2) + (local ? 0 : 1));
+        }
+        
+        std::vector<Event> mEvents;
+        uint32_t           mHead;
+        uint32_t           mNumEvents;
+    };
+};
+
+#endif
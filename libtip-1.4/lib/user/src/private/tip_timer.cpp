@@ -19,7 +19,7 @@
 using namespace LibTip;
 
 CTipTimer::CTipTimer() :
-    mNextId(0), mNextExpired((uint64_t) -1)
+    mNextSeq(0)
 {
 
 }
@@ -31,77 +31,168 @@ CTipTimer::~CTipTimer()
 
 uint32_t CTipTimer::Register(TimerType type, uint64_t timeoutMsec, uint32_t data)
 {
-    TimerData tdata;
-
-    tdata.mId      = mNextId++;
-    tdata.mType    = type;
-    tdata.mExpires = (GetMsecTimestamp() + timeoutMsec);
-    tdata.mData    = data;
+    uint32_t slot;
+    uint32_t id;
+    
+    if (! mFreeSlots.empty()) {
+        slot = mFreeSlots.back();
+        mFreeSlots.pop_back();
+
+        // bump the generation of the slot
+        id = (mSlots[slot].mId + (1 << SLOT_BITS));
+        if (id == INVALID_ID) {
+            id = slot;
+        }
+    } else {
+        if (mSlots.size() >= MAX_SLOTS) {
+            return INVALID_ID;
+        }
+        
+        slot = mSlots.size();
+        mSlots.push_back(TimerData());
+        id = slot;
+    }
 
-    mList.push_back(tdata);
+    TimerData& tdata = mSlots[slot];
+    tdata.mId        = id;
+    tdata.mType      = type;
+    tdata.mExpires   = (GetMsecTimestamp() + timeoutMsec);
+    tdata.mData      = data;
+    tdata.mSeq       = mNextSeq++;
+    tdata.mHeapIndex = mHeap.size();
 
-    if (timeoutMsec < mNextExpired) {
-        mNextExpired = timeoutMsec;
-    }
+    mHeap.push_back(slot);
+    SiftUp(tdata.mHeapIndex);
     
-    return tdata.mId;
+    return id;
 }
 
 Status CTipTimer::GetExpired(TimerType& type, uint32_t& data)
 {
-    uint64_t nowMsec = GetMsecTimestamp();
-    
-    TimerList::iterator iter;
-    for (iter = mList.begin(); iter != mList.end(); iter++) {
-        if (iter->mExpires <= nowMsec) {
-            type = iter->mType;
-            data = iter->mData;
-
-            mList.erase(iter);
-            return TIP_OK;
-        }
+    if (mHeap.empty()) {
+        return TIP_ERROR;
     }
 
-    CalcNextExpired();
-    return TIP_ERROR;
+    const TimerData& tdata = mSlots[mHeap.front()];
+    if (tdata.mExpires > GetMsecTimestamp()) {
+        return TIP_ERROR;
+    }
+
+    type = tdata.mType;
+    data = tdata.mData;
+
+    Remove(0);
+    return TIP_OK;
 }
 
 Status CTipTimer::Cancel(uint32_t id)
 {
-    TimerList::iterator iter;
-    for (iter = mList.begin(); iter != mList.end(); iter++) {
-        if (iter->mId == id) {
-            mList.erase(iter);
-            CalcNextExpired();
-            return TIP_OK;
-        }
+    uint32_t slot = (id & SLOT_MASK);
+    if (slot >= mSlots.size()) {
+        return TIP_ERROR;
+    }
+
+    const TimerData& tdata = mSlots[slot];
+    if (tdata.mId != id || tdata.mHeapIndex == INVALID_ID) {
+        return TIP_ERROR;
     }
 
-    return TIP_ERROR;
+    Remove(tdata.mHeapIndex);
+    return TIP_OK;
 }
 
 uint64_t CTipTimer::GetNextExpiredTime() const
 {
-    return mNextExpired;
+    if (mHeap.empty()) {
+        return (uint64_t) -1;
+    }
+
+    uint64_t expires = mSlots[mHeap.front()].mExpires;
+    uint64_t nowMsec = GetMsecTimestamp();
+    if (expires <= nowMsec) {
+        // doh!  we are late already
+        return 0;
+    }
+
+    return (expires - nowMsec);
 }
 
-void CTipTimer::CalcNextExpired()
+bool CTipTimer::Before(uint32_t a, uint32_t b) const
 {
-    uint64_t nowMsec = GetMsecTimestamp();
-    mNextExpired = (uint64_t) -1;
-    
-    TimerList::iterator iter;
-    for (iter = mList.begin(); iter != mList.end(); iter++) {
+    const TimerData& ta = mSlots[mHeap[a]];
+    const TimerData& tb = mSlots[mHeap[b]];
+
+    if (ta.mExpires != tb.mExpires) {
+        return (ta.mExpires < tb.mExpires);
+    }
 
-        if (iter->mExpires <= nowMsec) {
-            // doh!  we are late already
-            mNextExpired = 0;
-            return;
+    // same expiration, first registered goes first
+    return ((int32_t) (ta.mSeq - tb.mSeq) < 0);
+}
+
+void CTipTimer::Swap(uint32_t a, uint32_t b)
+{
+    uint32_t tmp = mHeap[a];
+    mHeap[a] = mHeap[b];
+    mHeap[b] = tmp;
+
+    mSlots[mHeap[a]].mHeapIndex = a;
+    mSlots[mHeap[b]].mHeapIndex = b;
+}
+
+void CTipTimer::SiftUp(uint32_t pos)
+{
+    while (pos > 0) {
+        uint32_t parent = ((pos - 1) / 2);
+        if (! Before(pos, parent)) {
+            break;
         }
 
-        uint64_t diffMsec = (iter->mExpires - nowMsec);
-        if (diffMsec < mNextExpired) {
-            mNextExpired = diffMsec;
+        Swap(pos, parent);
+        pos = parent;
+    }
+}
+
+void CTipTimer::SiftDown(uint32_t pos)
+{
+    uint32_t size = mHeap.size();
+    
+    while (true) {
+        uint32_t left  = ((pos * 2) + 1);
+        uint32_t right = (left + 1);
+        uint32_t first = pos;
+        
+        if (left < size && Before(left, first)) {
+            first = left;
         }
+        if (right < size && Before(right, first)) {
+            first = right;
+        }
+        if (first == pos) {
+            break;
+        }
+
+        Swap(pos, first);
+        pos = first;
+    }
+}
+
+void CTipTimer::Remove(uint32_t pos)
+{
+    uint32_t slot = mHeap[pos];
+    uint32_t last = (mHeap.size() - 1);
+
+    if (pos != last) {
+        Swap(pos, last);
+    }
+
+    mHeap.pop_back();
+    mSlots[slot].mHeapIndex = INVALID_ID;
+    mFreeSlots.push_back(slot);
+
+    // the entry moved into pos may need to go either way
+    if (pos < mHeap.size()) {
+        SiftDown(pos);
+        SiftUp(pos);
     }
 }
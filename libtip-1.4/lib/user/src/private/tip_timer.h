@@ -17,12 +17,16 @@
 #ifndef TIP_TIMER_H_
 #define TIP_TIMER_H_
 
-#include <list>
+#include <stddef.h>
+#include <vector>
 #include "tip_constants.h"
 
 namespace LibTip {
 
-    // simple timer class for tracking pending actions
+    // timer class for tracking pending actions.  timers are kept in
+    // an indexed binary min-heap ordered by expiration time so
+    // registering, cancelling and popping an expired timer are all
+    // O(log n).
     class CTipTimer {
     public:
         CTipTimer();
@@ -34,15 +38,19 @@ namespace LibTip {
             AMT_DELAYED_ACK
         };
 
+        // timer id never returned by Register()
+        static const uint32_t INVALID_ID = 0xFFFFFFFF;
+        
         // register a timer, returns a timer id that can be used to
-        // cancel the timer
+        // cancel the timer or INVALID_ID if no more timers can be
+        // registered
         uint32_t Register(TimerType type, uint64_t timeoutMsec, uint32_t data);
 
         // get an expired timer, returns TIP_OK if a timer expired,
         // otherwise returns TIP_ERROR.  timer type and user data are
-        // returned in the params.  caller should invoke this in a
-        // loop until TIP_ERROR is returned, internal state depends on
-        // this caller behavior.
+        // returned in the params.  timers are returned in order of
+        // expiration, caller should invoke this in a loop until
+        // TIP_ERROR is returned.
         Status GetExpired(TimerType& type, uint32_t& data);
 
         // cancel a pending timer, return TIP_OK if the timer was removed
@@ -51,23 +59,46 @@ namespace LibTip {
         // get the amount of time until the next timeout.  a return of
         // (uint64_t) -1 indicates no pending timers.
         uint64_t GetNextExpiredTime() const;
+
+        // get the number of pending timers
+        uint32_t GetNumTimers() const { return mHeap.size(); }
         
     protected:
-        // calculate the amount of time until the next timer expires
-        void CalcNextExpired();
-        
-        uint32_t mNextId;
-        uint64_t mNextExpired;
+        // timer ids are a slot index plus a generation count in the
+        // upper bits, a stale id never matches a newer timer that
+        // reuses the same slot
+        enum {
+            SLOT_BITS = 20,
+            SLOT_MASK = ((1 << SLOT_BITS) - 1),
+            MAX_SLOTS = SLOT_MASK
+        };
         
         // structure to hold a single timer
         struct TimerData {
-            uint32_t  mId;      // timer id
-            TimerType mType;    // type of timer
-            uint64_t  mExpires; // time of expiration
-            uint32_t  mData;    // user data
+            uint32_t  mId;        // timer id
+            TimerType mType;      // type of timer
+            uint64_t  mExpires;   // time of expiration
+            uint32_t  mData;      // user data
+            uint32_t  mSeq;       // registration order, breaks ties
+            uint32_t  mHeapIndex; // position in mHeap, INVALID_ID if free
         };
-        typedef std::list<TimerData> TimerList;
-        TimerList mList;
+        typedef std::vector<TimerData> TimerSlots;
+        TimerSlots mSlots;
+
+        // unused entries in mSlots
+        std::vector<uint32_t> mFreeSlots;
+
+        // slot indexes ordered as a min-heap, next timer at the front
+        std::vector<uint32_t> mHeap;
+
+        uint32_t mNextSeq;
+        
+        // heap helpers
+        bool Before(uint32_t a, uint32_t b) const;
+        void Swap(uint32_t a, uint32_t b);
+        void SiftUp(uint32_t pos);
+        void SiftDown(uint32_t pos);
+        void Remove(uint32_t pos);
     };
 
 };
@@ -48,32 +48,44 @@ void CTip::SetCallback(CTipCallback* callback)
 
 Status CTip::StartTipNegotiate(MediaType mType)
 {
-    return mImpl->StartTipNegotiate(mType);
+    Status ret = mImpl->StartTipNegotiate(mType);
+    Reschedule();
+    return ret;
 }
 
 Status CTip::StopTipNegotiate(MediaType mType)
 {
-    return mImpl->StopTipNegotiate(mType);
+    Status ret = mImpl->StopTipNegotiate(mType);
+    Reschedule();
+    return ret;
 }
 
 Status CTip::StartPresentation()
 {
-    return mImpl->StartPresentation();
+    Status ret = mImpl->StartPresentation();
+    Reschedule();
+    return ret;
 }
 
 Status CTip::StopPresentation()
 {
-    return mImpl->StopPresentation();
+    Status ret = mImpl->StopPresentation();
+    Reschedule();
+    return ret;
 }
 
 Status CTip::ReceivePacket(uint8_t* buffer, uint32_t size, MediaType mType)
 {
-    return mImpl->ReceivePacket(buffer, size, mType);
+    Status ret = mImpl->ReceivePacket(buffer, size, mType);
+    Reschedule();
+    return ret;
 }
 
 Status CTip::SendDelayedAck(void* id, MediaType mType)
 {
-    return mImpl->SendDelayedAck(id, mType);
+    Status ret = mImpl->SendDelayedAck(id, mType);
+    Reschedule();
+    return ret;
 }
 
 void CTip::SetRetransmissionInterval(uint32_t intervalMS)
@@ -86,6 +98,38 @@ void CTip::SetRetransmissionLimit(uint32_t limit)
     mImpl->SetRetransmissionLimit(limit);
 }
 
+void CTip::SetRetransmissionBackoff(uint32_t multiplier, uint32_t maxIntervalMS)
+{
+    mImpl->SetRetransmissionBackoff(multiplier, maxIntervalMS);
+}
+
+void CTip::SetRetransmissionJitter(uint32_t percent)
+{
+    mImpl->SetRetransmissionJitter(percent);
+}
+
+void CTip::EnableAdaptiveRetransmission(uint32_t minIntervalMS, uint32_t maxIntervalMS)
+{
+    mImpl->EnableAdaptiveRetransmission(minIntervalMS, maxIntervalMS);
+}
+
+void CTip::DisableAdaptiveRetransmission()
+{
+    mImpl->DisableAdaptiveRetransmission();
+}
+
+uint32_t CTip::GetRoundTripTime(MediaType mType) const
+{
+    return mImpl->GetRoundTripTime(mType);
+}
+
+Status CTip::SendEcho(MediaType mType)
+{
+    Status ret = mImpl->SendEcho(mType);
+    Reschedule();
+    return ret;
+}
+
 uint64_t CTip::GetIdleTime() const
 {
     return mImpl->GetIdleTime();
@@ -94,6 +138,7 @@ uint64_t CTip::GetIdleTime() const
 void CTip::DoPeriodicActivity()
 {
     mImpl->DoPeriodicActivity();
+    Reschedule();
 }
 
 uint32_t CTip::GetRTCPSSRC(MediaType mType) const
@@ -105,3 +150,28 @@ void CTip::SetRTCPSSRC(MediaType mType, uint32_t ssrc)
 {
     mImpl->SetRTCPSSRC(mType, ssrc);
 }
+
+void CTip::SetPacketDumpLimit(uint32_t count, uint32_t intervalMS)
+{
+    mImpl->SetPacketDumpLimit(count, intervalMS);
+}
+
+Status CTip::GetStats(MediaType mType, CTipStats& stats) const
+{
+    return mImpl->GetStats(mType, stats);
+}
+
+Status CTip::GetNegotiationTime(MediaType mType, CTipHistogram& hist) const
+{
+    return mImpl->GetNegotiationTime(mType, hist);
+}
+
+void CTip::SetNegotiationTraceSize(uint32_t numEvents)
+{
+    mImpl->SetNegotiationTraceSize(numEvents);
+}
+
+void CTip::WriteNegotiationTrace(std::ostream& output, uint32_t pid, bool complete) const
+{
+    mImpl->WriteNegotiationTrace(output, pid, complete);
+}
@@ -17,10 +17,14 @@
 #ifndef TIP_H_
 #define TIP_H_
 
+#include <iostream>
+
 #include "tip_constants.h"
 #include "tip_system.h"
 #include "tip_packet_transmit.h"
 #include "tip_callback.h"
+#include "tip_scheduler.h"
+#include "tip_stats.h"
 
 namespace LibTip {
 
@@ -29,9 +33,11 @@ namespace LibTip {
 
     /**
      * Main user interface class.  CTip provides APIs to configure
-     * and drive all system Tip actions.
+     * and drive all system Tip actions.  Time related actions are
+     * driven either by polling GetIdleTime() and DoPeriodicActivity()
+     * or by attaching a CTipScheduler.
      */
-    class CTip {
+    class CTip : public CTipSchedulable {
     public:
         /**
          * Public constructor.  Only user accessible constructor.
@@ -169,6 +175,69 @@ namespace LibTip {
          */
         void SetRetransmissionLimit(uint32_t limit);
 
+        /**
+         * Enable exponential backoff of Tip packet retransmissions.
+         * Each retransmission of a packet waits multiplier times
+         * longer than the previous one, up to maxIntervalMS.  By
+         * default there is no backoff (a multiplier of 1).  Note
+         * that backoff lengthens the time before an unacknowledged
+         * packet times out.
+         *
+         * @param multiplier factor applied to the interval after each
+         * retransmission, 1 disables backoff
+         * @param maxIntervalMS largest interval between
+         * retransmissions, in milliseconds, 0 means no limit
+         */
+        void SetRetransmissionBackoff(uint32_t multiplier, uint32_t maxIntervalMS);
+
+        /**
+         * Randomize Tip packet retransmission intervals.  Each
+         * retransmission interval is randomly moved by up to the given
+         * percentage in either direction so that packets queued at the
+         * same time are spread out.  The default is 0 (no jitter).
+         *
+         * @param percent maximum jitter, in percent of the interval
+         */
+        void SetRetransmissionJitter(uint32_t percent);
+
+        /**
+         * Derive the retransmission interval from the measured round
+         * trip time.  Round trip times are measured from ACKs of Tip
+         * packets that were only transmitted once and from ECHO
+         * replies, and smoothed as described in RFC 6298.  Once a
+         * measurement is available the retransmission timeout it
+         * produces, bounded by minIntervalMS and maxIntervalMS, is
+         * used instead of the interval given to
+         * SetRetransmissionInterval().
+         *
+         * @param minIntervalMS smallest retransmission interval, in milliseconds
+         * @param maxIntervalMS largest retransmission interval, in milliseconds
+         */
+        void EnableAdaptiveRetransmission(uint32_t minIntervalMS, uint32_t maxIntervalMS);
+
+        /**
+         * Go back to the fixed retransmission interval.
+         */
+        void DisableAdaptiveRetransmission();
+
+        /**
+         * Get the smoothed round trip time.
+         *
+         * @param mType the type of media to get the round trip time for
+         * @return round trip time in milliseconds, 0 if it has not
+         * been measured yet
+         */
+        uint32_t GetRoundTripTime(MediaType mType) const;
+
+        /**
+         * Send a Tip ECHO packet.  The remote side replies to the ECHO
+         * which provides a round trip time measurement.
+         *
+         * @param mType the type of media to send the ECHO on
+         * @return TIP_OK if the ECHO was queued, otherwise TIP_ERROR
+         */
+        Status SendEcho(MediaType mType);
+
         /**
          * Get the idle time until the next Tip action.  Get the
          * amount of time until the next Tip action needs to occur
@@ -179,7 +248,7 @@ namespace LibTip {
          * there are no scheduled actions
          * @see DoPeriodicActivity()
          */
-        uint64_t GetIdleTime() const;
+        virtual uint64_t GetIdleTime() const;
 
         /**
          * Perform periodic activity.  The Tip will take periodic
@@ -190,7 +259,7 @@ namespace LibTip {
          *
          * @see GetIdleTime()
          */
-        void DoPeriodicActivity();
+        virtual void DoPeriodicActivity();
 
         /**
          * Get the RTCP SSRC used by this system on the given media
@@ -211,6 +280,71 @@ namespace LibTip {
          * @param ssrc the new SSRC value
          */
         void SetRTCPSSRC(MediaType mType, uint32_t ssrc);
+
+        /**
+         * Limit the rate of packet dumps.  With DEBUG_TIPNEG enabled
+         * every Tip packet sent or received is dumped in human
+         * readable form, which can swamp the log when many sessions
+         * are active.  At most count packet dumps are printed in
+         * each interval, the number dropped is reported with the
+         * next dump printed.  By default there is no limit.
+         *
+         * @param count packet dumps allowed per interval, 0 for no limit
+         * @param intervalMS length of the interval, in milliseconds
+         */
+        void SetPacketDumpLimit(uint32_t count, uint32_t intervalMS);
+
+        /**
+         * Get the statistics for one media type.  Lock free, may be
+         * called from any thread while the session is running.
+         *
+         * @param mType the media type to get statistics for
+         * @param stats filled in with a copy of the statistics
+         * @return TIP_OK on success, TIP_ERROR for an invalid type
+         * @see CTipStats
+         */
+        Status GetStats(MediaType mType, CTipStats& stats) const;
+
+        /**
+         * Get the histogram of the time in milliseconds from the
+         * start of Tip negotiation until the ACK of our MEDIAOPTS
+         * completed local negotiation.  Lock free like GetStats().
+         *
+         * @param mType the media type to get the histogram for
+         * @param hist filled in with a copy of the histogram
+         * @return TIP_OK on success, TIP_ERROR for an invalid type
+         */
+        Status GetNegotiationTime(MediaType mType, CTipHistogram& hist) const;
+
+        /**
+         * Set the size of the negotiation trace.  Every change of
+         * the local or remote Tip negotiation state is recorded with
+         * a timestamp, the trace holds the most recent numEvents
+         * changes.  Setting the size clears the trace, 0 disables
+         * tracing.  The default is 64 changes.
+         *
+         * @param numEvents number of state changes to keep
+         */
+        void SetNegotiationTraceSize(uint32_t numEvents);
+
+        /**
+         * Write the negotiation trace as Chrome trace event JSON,
+         * which chrome://tracing and Perfetto display as a timeline.
+         * Each media type has a local and a remote track showing the
+         * time spent in each negotiation state, the current state
+         * lasts until now.  Timestamps are wall clock microseconds
+         * so the traces of several sessions line up.
+         *
+         * @param output stream to write the trace to
+         * @param pid trace process id of this session, give each
+         * session its own id to view several sessions in one trace
+         * @param complete if true a complete JSON object is written,
+         * otherwise only the events separated by commas so the
+         * events of several sessions can be joined into one
+         * traceEvents array
+         */
+        void WriteNegotiationTrace(std::ostream& output, uint32_t pid = 0,
+                                   bool complete = true) const;
         
     private:
         CTipImpl* mImpl;
@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 
+#include <string.h>
+
+#include <algorithm>
+
 #include "tip_debug_print.h"
 #include "tip_time.h"
 #include "rtcp_tip_types.h"
@@ -44,20 +48,27 @@ CTipMedia::~CTipMedia()
 
 Status CTipMedia::ReceivePacket(uint8_t* buffer, uint32_t size)
 {
+    CTipTimeCache now;
     Status ret = TIP_ERROR;
     
     if (buffer == NULL) {
         return ret;
     }
 
-    CPacketBuffer packetBuf(buffer, size);
+    CRtcpCompoundView compound(buffer, size);
+    CRtcpPacketView view;
 
-    while (packetBuf.GetBufferSize()) {
-        CRtcpPacket* rtcp = CRtcpPacketFactory::CreatePacketFromBuffer(packetBuf);
+    while (compound.Next(view) == 0) {
+        CRtcpPacket* rtcp = CRtcpPacketFactory::CreatePacketFromView(view);
 
         if (rtcp == NULL) {
             // something we couldn't parse, keep going until the
-            // buffer is empty
+            // buffer is empty.  RTCP types we do not handle (e.g. SR)
+            // are not errors.
+            if (view.GetTipPacketType() != MAX_PACKET_TYPE ||
+                view.GetType() == CRtcpPacket::RTPFB) {
+                mStats.Increment(CTipStats::RX_PARSE_ERROR);
+            }
             continue;
         }
 
@@ -74,6 +85,7 @@ Status CTipMedia::ReceivePacket(uint8_t* buffer, uint32_t size)
                 continue;
             }
 
+            mStats.Increment(CTipStats::RX_FEEDBACK);
             ProcessFBPacket(fb);
             delete rtcp;
             continue;
@@ -90,6 +102,7 @@ Status CTipMedia::ReceivePacket(uint8_t* buffer, uint32_t size)
         
         AMDEBUG(RECV, ("%s recv packet type %s",
                        mLogPrefix.c_str(), packet->GetTipPacketTypeString()));
+        mStats.IncrementReceived(packet->GetTipPacketType());
         
         // process ACK packets first
         if (IsAckTipPacketType(packet->GetTipPacketType())) {
@@ -104,6 +117,7 @@ Status CTipMedia::ReceivePacket(uint8_t* buffer, uint32_t size)
                            mLogPrefix.c_str(), packet->GetTipPacketTypeString(),
                            packet->GetNtpTime()));
 
+            mStats.Increment(CTipStats::RX_DROP);
             delete packet;
             
         } else if (action == CTipPacketReceiver::AMPR_DUP) {
@@ -111,6 +125,7 @@ Status CTipMedia::ReceivePacket(uint8_t* buffer, uint32_t size)
                            mLogPrefix.c_str(), packet->GetTipPacketTypeString(),
                            packet->GetNtpTime()));
 
+            mStats.Increment(CTipStats::RX_DUPLICATE);
             AckPacket(packet);
             delete packet;
             
@@ -126,6 +141,12 @@ Status CTipMedia::ReceivePacket(uint8_t* buffer, uint32_t size)
         }
     }
 
+    // the rest of the buffer could not be walked
+    if (compound.HasError()) {
+        mStats.Increment(CTipStats::RX_PARSE_ERROR);
+    }
+
+    Reschedule();
     return ret;
 }
 
@@ -139,6 +160,31 @@ void CTipMedia::SetRetransmissionLimit(uint32_t limit)
     mPacketManager.SetRetransmissionLimit(limit);
 }
 
+void CTipMedia::SetRetransmissionBackoff(uint32_t multiplier, uint32_t maxIntervalMS)
+{
+    mPacketManager.SetRetransmissionBackoff(multiplier, maxIntervalMS);
+}
+
+void CTipMedia::SetRetransmissionJitter(uint32_t percent)
+{
+    mPacketManager.SetRetransmissionJitter(percent);
+}
+
+void CTipMedia::EnableAdaptiveRetransmission(uint32_t minIntervalMS, uint32_t maxIntervalMS)
+{
+    mPacketManager.EnableAdaptiveInterval(minIntervalMS, maxIntervalMS);
+}
+
+void CTipMedia::DisableAdaptiveRetransmission()
+{
+    mPacketManager.DisableAdaptiveInterval();
+}
+
+uint32_t CTipMedia::GetRoundTripTime() const
+{
+    return mPacketManager.GetRttEstimator().GetSRTT();
+}
+
 uint64_t CTipMedia::GetIdleTime() const
 {
     return mPacketManager.GetNextTransmitTime();
@@ -146,6 +192,8 @@ uint64_t CTipMedia::GetIdleTime() const
 
 void CTipMedia::DoPeriodicActivity()
 {
+    CTipTimeCache now;
+    
     if (mPacketManager.GetNextTransmitTime() == 0) {
         // time to send out some packets
         bool expired;
@@ -158,6 +206,7 @@ void CTipMedia::DoPeriodicActivity()
                 AMDEBUG(USER, ("%s timeout for packet type %s",
                                mLogPrefix.c_str(),
                                packet->GetTipPacketTypeString()));
+                mStats.Increment(CTipStats::TX_EXPIRED);
                 delete packet;
             } else {
                 // packet should be sent
@@ -166,6 +215,12 @@ void CTipMedia::DoPeriodicActivity()
                                packet->GetTipPacketTypeString(),
                                buffer->GetBufferSize()));
 
+                if (mPacketManager.GetTxCount(packet->GetTipPacketType()) > 1) {
+                    mStats.Increment(CTipStats::TX_RETRANSMIT);
+                } else {
+                    mStats.Increment(CTipStats::TX_FIRST);
+                }
+                
                 mPacketXmit.Transmit(buffer->GetBuffer(), buffer->GetBufferSize(),
                                      mMediaType);
             }
@@ -173,6 +228,8 @@ void CTipMedia::DoPeriodicActivity()
             packet = mPacketManager.GetPacket(expired, &buffer);
         }
     }
+
+    Reschedule();
 }
 
 void CTipMedia::AckPacket(const CRtcpTipPacket* packet)
@@ -187,9 +244,17 @@ void CTipMedia::AckPacket(const CRtcpTipPacket* packet)
     // setup header
     ack->SetSSRC(mSSRC);
     
-    // pack ACK into a buffer and send it out
+    // pack ACK into a buffer and send it out behind the shared
+    // wrapper
     CPacketBufferData buffer;
-    mPacketManager.Pack(*ack, buffer);
+    struct iovec iov[CTipPacketManager::MAX_SEGMENTS];
+    uint32_t iovcnt = mPacketManager.PackV(*ack, buffer, iov);
+    if (iovcnt == 0) {
+        AMDEBUG(INTERR, ("%s could not pack ack type %s",
+                         mLogPrefix.c_str(), ack->GetTipPacketTypeString()));
+        delete ack;
+        return;
+    }
 
     AMDEBUG(XMIT, ("%s xmit ack for packet type %s.  ack type %s size %d bytes",
                    mLogPrefix.c_str(),
@@ -197,8 +262,7 @@ void CTipMedia::AckPacket(const CRtcpTipPacket* packet)
                    ack->GetTipPacketTypeString(), buffer.GetBufferSize()));
     
 
-    mPacketXmit.Transmit(buffer.GetBuffer(), buffer.GetBufferSize(),
-                         mMediaType);
+    mPacketXmit.TransmitV(iov, iovcnt, mMediaType);
 
     // notify our receiver that this packet has been acked.
     // duplicates will now be acked as well.  do not delete ack,
@@ -216,13 +280,22 @@ void CTipMedia::StartPacketTx(CRtcpTipPacket* packet)
 
     packet->SetSSRC(mSSRC);
     packet->SetNtpTime(GetNtpTimestamp());
-    mPacketManager.Add(packet);
+    if (mPacketManager.Add(packet) != 0) {
+        AMDEBUG(INTERR, ("%s could not queue packet type %s",
+                         mLogPrefix.c_str(),
+                         GetTipPacketTypeString(packet->GetTipPacketType())));
+        delete packet;
+    }
+
+    Reschedule();
 }
 
 void CTipMedia::StopPacketTx(TipPacketType pType)
 {
     CRtcpTipPacket* packet = mPacketManager.Remove(pType);
     delete packet;
+
+    Reschedule();
 }
 
 void CTipMedia::ProcessPacket(CRtcpTipPacket* packet)
@@ -232,11 +305,14 @@ void CTipMedia::ProcessPacket(CRtcpTipPacket* packet)
 
 void CTipMedia::ProcessAckPacket(CRtcpTipPacket* packet)
 {
-    CRtcpTipPacket* acked = mPacketManager.Ack(*packet);
+    uint32_t latency;
+    CRtcpTipPacket* acked = mPacketManager.Ack(*packet, &latency);
     if (acked == NULL) {
         // received an ACK for something we don't know anything about.  just drop it.
         return;
     }
+
+    mStats.AddAckLatency(latency);
         
     TipPacketType ackedType = acked->GetTipPacketType();
     AMDEBUG(RECV, ("%s recv ack for xmit packet type %s",
@@ -249,22 +325,53 @@ void CTipMedia::ProcessFBPacket(CRtcpAppFeedbackPacket* packet)
 {
 }
 
-void CTipMedia::PrintPacketTx(const CRtcpPacket& packet, MediaType mType) const
+void CTipMedia::PrintPacketTx(const CRtcpPacket& packet, MediaType mType)
 {
+    // only format the dump if it is going to be printed
+    uint32_t suppressed = 0;
+    if (! AMDEBUG_ENABLED(XMIT) || ! mDumpLimit.Allow(GetMsecTimestamp(), suppressed)) {
+        return;
+    }
+
+    if (suppressed != 0) {
+        AMDEBUG(XMIT, ("%s %u packet dumps suppressed",
+                       mLogPrefix.c_str(), suppressed));
+    }
+    
     std::ostringstream stream;
     packet.ToStream(stream, mType);
     AMDEBUG(XMIT, ("%s packet dump:%s",
                    mLogPrefix.c_str(), stream.str().c_str()));
 }
 
-void CTipMedia::PrintPacketRx(const CRtcpPacket& packet, MediaType mType) const
+void CTipMedia::PrintPacketRx(const CRtcpPacket& packet, MediaType mType)
 {
+    uint32_t suppressed = 0;
+    if (! AMDEBUG_ENABLED(RECV) || ! mDumpLimit.Allow(GetMsecTimestamp(), suppressed)) {
+        return;
+    }
+
+    if (suppressed != 0) {
+        AMDEBUG(RECV, ("%s %u packet dumps suppressed",
+                       mLogPrefix.c_str(), suppressed));
+    }
+    
     std::ostringstream stream;
     packet.ToStream(stream, mType);
     AMDEBUG(RECV, ("%s packet dump:%s",
                    mLogPrefix.c_str(), stream.str().c_str()));
 }
 
+void CTipMedia::SetPacketDumpLimit(uint32_t count, uint32_t intervalMS)
+{
+    mDumpLimit.SetLimit(count, intervalMS);
+}
+
+void CTipMedia::GetStats(CTipStats& stats) const
+{
+    stats = mStats;
+}
+
 void CTipMedia::SetLogPrefix(const char* string)
 {
     if (string == NULL) {
@@ -282,7 +389,7 @@ CTipMediaSink::CTipMediaSink(MediaType type, uint32_t ssrc, uint32_t csrc,
     mHaveLastSeqNum = false;
     mLastSeqNum = 0;
 
-    mAcks.reset();
+    memset(mAckWindow, 0, sizeof(mAckWindow));
     
     mpSinkCallback = new CTipMediaSinkCallback();
 }
@@ -374,7 +481,7 @@ void CTipMediaSink::RegisterPacket(uint16_t seqno, bool eof)
         mHaveLastSeqNum = true;
         mLastSeqNum = seqno;
 
-        mAcks[seqno] = 1;
+        SetAckRange(seqno, 1, true);
         
     } else {
         // not the first time through.  we define the following ranges
@@ -385,20 +492,19 @@ void CTipMediaSink::RegisterPacket(uint16_t seqno, bool eof)
         uint16_t diff = (seqno - mLastSeqNum);
 
         if (diff <= 0x8000) {
-            // jump forward, set the received bit
-            mAcks[seqno] = 1;
-
-            // 0 anything skipped
-            for (uint16_t start = (mLastSeqNum + 1); start < seqno; start++) {
-                mAcks[start] = 0;
+            // jump forward, 0 anything skipped and set the received bit
+            if (diff > 1) {
+                SetAckRange((mLastSeqNum + 1), (diff - 1), false);
             }
+            SetAckRange(seqno, 1, true);
 
             // remember this as the latest received seqno
             mLastSeqNum = seqno;
             
-        } else {
-            // jump backward, just set the bit
-            mAcks[seqno] = 1;
+        } else if ((uint16_t) (mLastSeqNum - seqno) < ACK_WINDOW_BITS) {
+            // jump backward, just set the bit.  anything older than
+            // the window can never be reported so is dropped.
+            SetAckRange(seqno, 1, true);
         }
     }
 
@@ -407,27 +513,92 @@ void CTipMediaSink::RegisterPacket(uint16_t seqno, bool eof)
         return;
     }
 
-    // otherwise send out a feedback packet
-    CRtcpAppFeedbackPacket packet;
-    packet.SetSSRC(mSSRC);
-    packet.SetTarget(mSourceCSRC);
-    packet.SetPacketID(mLastSeqNum);
+    // otherwise send out a feedback packet, packing it only if the
+    // addressing changed since the last one
+    if (mFBBuffer.GetBufferSize() == 0 || mFBPacket.GetSSRC() != mSSRC ||
+        mFBPacket.GetTarget() != mSourceCSRC) {
 
-    // add the previous 112 packet acks/nacks
-    for (uint16_t i = 0; i < CRtcpAppFeedbackPacket::NUM_ACK_BITS; i++) {
-        uint16_t num = ((mLastSeqNum - CRtcpAppFeedbackPacket::NUM_ACK_BITS) + i);
-        
-        packet.SetPacketAckBySeqNum(num, (mAcks[num] ? CRtcpAppFeedbackPacket::APP_FB_ACK : CRtcpAppFeedbackPacket::APP_FB_NACK));
+        mFBPacket.SetSSRC(mSSRC);
+        mFBPacket.SetTarget(mSourceCSRC);
+
+        mFBBuffer.Reset();
+        if (mFBPacket.Pack(mFBBuffer) == 0) {
+            AMDEBUG(INTERR, ("%s could not pack feedback packet",
+                             mLogPrefix.c_str()));
+            mFBBuffer.Reset();
+            return;
+        }
+    }
+    
+    mFBPacket.SetPacketID(mLastSeqNum);
+
+    // add the previous 112 packet acks/nacks.  bit N of the field is
+    // sequence number (packet id - 112 + N), least significant bit
+    // first, which is the window read from that sequence number on.
+    uint8_t acks[CRtcpAppFeedbackPacket::NUM_ACK_BYTES];
+    uint16_t first = (mLastSeqNum - CRtcpAppFeedbackPacket::NUM_ACK_BITS);
+    
+    for (uint16_t i = 0; i < CRtcpAppFeedbackPacket::NUM_ACK_BYTES; i += 8) {
+        uint64_t bits = GetAckBits(first + (i * 8));
+        for (uint16_t j = 0; j < 8 && (i + j) < CRtcpAppFeedbackPacket::NUM_ACK_BYTES; j++) {
+            acks[i + j] = (uint8_t) (bits >> (j * 8));
+        }
+    }
+    mFBPacket.SetPacketAcks(acks);
+    if (mFBPacket.PackAcks(mFBBuffer.GetBuffer(), mFBBuffer.GetBufferSize()) != 0) {
+        // never send the acks left over from the last feedback
+        AMDEBUG(INTERR, ("%s could not pack feedback acks",
+                         mLogPrefix.c_str()));
+        mFBBuffer.Reset();
+        return;
     }
 
-    PrintPacketTx(packet, mMediaType);
+    PrintPacketTx(mFBPacket, mMediaType);
     
     // feedback packets are one-shots, so send directly
-    CPacketBufferData buffer;
-    mPacketManager.Pack(packet, buffer);
+    struct iovec iov[CTipPacketManager::MAX_SEGMENTS];
+    uint32_t iovcnt = mPacketManager.WrapV(mFBBuffer.GetBuffer(), mFBBuffer.GetBufferSize(), iov);
+    mPacketXmit.TransmitV(iov, iovcnt, mMediaType);
+}
+
+void CTipMediaSink::SetAckRange(uint16_t seqno, uint32_t count, bool ack)
+{
+    if (count >= ACK_WINDOW_BITS) {
+        // the whole window is covered
+        memset(mAckWindow, (ack ? 0xFF : 0), sizeof(mAckWindow));
+        return;
+    }
+
+    uint32_t pos = (seqno % ACK_WINDOW_BITS);
+    while (count > 0) {
+        uint32_t shift = (pos % 64);
+        uint32_t num = std::min((64 - shift), count);
+        uint64_t mask = ((num == 64) ? ~0ULL : (((1ULL << num) - 1) << shift));
+        
+        if (ack) {
+            mAckWindow[pos / 64] |= mask;
+        } else {
+            mAckWindow[pos / 64] &= ~mask;
+        }
+
+        pos = ((pos + num) % ACK_WINDOW_BITS);
+        count -= num;
+    }
+}
+
+uint64_t CTipMediaSink::GetAckBits(uint16_t seqno) const
+{
+    // 64 bits starting at seqno, wrapping around the window
+    uint32_t pos = (seqno % ACK_WINDOW_BITS);
+    uint32_t word = (pos / 64);
+    uint32_t shift = (pos % 64);
+
+    uint64_t bits = (mAckWindow[word] >> shift);
+    if (shift != 0) {
+        bits |= (mAckWindow[(word + 1) % ACK_WINDOW_WORDS] << (64 - shift));
+    }
 
-    mPacketXmit.Transmit(buffer.GetBuffer(), buffer.GetBufferSize(),
-                         mMediaType);
+    return bits;
 }
 
 CTipMediaSource::CTipMediaSource(MediaType type, uint32_t ssrc, uint32_t csrc,
@@ -438,8 +609,9 @@ CTipMediaSource::CTipMediaSource(MediaType type, uint32_t ssrc, uint32_t csrc,
     mLastSeqNum      = 0;
     mpSourceCallback = new CTipMediaSourceCallback();
 
-    // enable all callbacks
-    mCallbackEnable.set();
+    // no callbacks done yet
+    mCallbackBase = 0;
+    memset(mCallbackDone, 0, sizeof(mCallbackDone));
 }
 
 CTipMediaSource::~CTipMediaSource()
@@ -461,6 +633,10 @@ void CTipMediaSource::SetSequenceNumber(uint16_t seqno)
 {
     mHaveLastSeqNum = true;
     mLastSeqNum     = seqno;
+
+    // seqnos from here on are new packets, forget earlier callbacks
+    mCallbackBase = seqno;
+    memset(mCallbackDone, 0, sizeof(mCallbackDone));
 }
 
 void CTipMediaSource::ProcessPacket(CRtcpTipPacket* packet)
@@ -538,6 +714,37 @@ void CTipMediaSource::ProcessPacket(CRtcpTipPacket* packet)
     }
 }
 
+// feedback ack fields as words, with room for the packet id bit
+static const uint32_t FB_FIELD_WORDS = 2;
+
+static void LoadFBField(const uint8_t* bytes, uint64_t* field)
+{
+    memset(field, 0, (FB_FIELD_WORDS * sizeof(uint64_t)));
+    for (uint32_t i = 0; i < CRtcpAppFeedbackPacket::NUM_ACK_BYTES; i++) {
+        field[(i / 8)] |= ((uint64_t) bytes[i] << ((i % 8) * 8));
+    }
+}
+
+// 64 bits of the field starting at bit index, bits outside the field
+// read as 0.
+static uint64_t GetFBFieldBits(const uint64_t* field, int32_t index)
+{
+    uint64_t bits = 0;
+    
+    for (uint32_t i = 0; i < FB_FIELD_WORDS; i++) {
+        // position of bit 0 of this word in the result
+        int32_t offset = ((int32_t) (i * 64) - index);
+        
+        if (offset >= 0 && offset < 64) {
+            bits |= (field[i] << offset);
+        } else if (offset < 0 && offset > -64) {
+            bits |= (field[i] >> -offset);
+        }
+    }
+
+    return bits;
+}
+
 void CTipMediaSource::ProcessFBPacket(CRtcpAppFeedbackPacket* packet)
 {
     if (packet->GetTarget() != mCSRC.GetCSRC()) {
@@ -567,88 +774,160 @@ void CTipMediaSource::ProcessFBPacket(CRtcpAppFeedbackPacket* packet)
     // might be extended or not extended
     CRtcpAppExtendedFeedbackPacket* extfb = dynamic_cast<CRtcpAppExtendedFeedbackPacket*>(packet);
 
+    // load the ack bits and the invalid bits (the inverse of the
+    // valid bits) into words.  bits outside the packet read as 0 so
+    // the default is a VALID NACK, which is what we want in the case
+    // of lost feedback packets where we skip more than 112 packets.
+    // the packet id itself is always a VALID ACK.
+    uint64_t acks[FB_FIELD_WORDS];
+    uint64_t invalid[FB_FIELD_WORDS];
+    
+    LoadFBField(packet->GetPacketAcks(), acks);
+    acks[(CRtcpAppFeedbackPacket::NUM_ACK_BITS / 64)] |=
+        (1ULL << (CRtcpAppFeedbackPacket::NUM_ACK_BITS % 64));
+
+    if (extfb != NULL) {
+        LoadFBField(extfb->GetPacketAcksValid(), invalid);
+        for (uint32_t i = 0; i < FB_FIELD_WORDS; i++) {
+            invalid[i] = ~invalid[i];
+        }
+        invalid[(CRtcpAppFeedbackPacket::NUM_ACK_BITS / 64)] &=
+            ((1ULL << (CRtcpAppFeedbackPacket::NUM_ACK_BITS % 64)) - 1);
+    } else {
+        memset(invalid, 0, sizeof(invalid));
+    }
+    
     // save off the first invalid seqnum processed as that is where
     // we still start from next time.
     bool haveInvalidSeqNum = false;
     uint16_t firstInvalidSeqNum = (packet->GetPacketID() + 1);
     
-    // loop through the new bits in the FB packet invoking the
-    // callback for each one.
-    for (uint16_t i = 0; i < new_bits; i++) {
-        uint16_t curSeqNum = (mLastSeqNum + i);
-        
-        // in the case of lost feedback packets where we skip more
-        // than 112 packets and the seqno is not in the packet, the
-        // packet object will return NACK which is what we want.  ie
-        // we default to NACK unless we are sure it is an ACK.
-        CRtcpAppFeedbackPacket::AckValue ack =
-            packet->GetPacketAckBySeqNum(curSeqNum);
-
-        // this will default to VALID if the seqnum is out of range.
-        // so the overall default is a VALID NACK which is what we
-        // want.
-        CRtcpAppExtendedFeedbackPacket::AckValidValue valid =
-            CRtcpAppExtendedFeedbackPacket::APP_FB_VALID;
-        if (extfb != NULL) {
-            valid = extfb->GetPacketAckValidBySeqNum(curSeqNum);
+    // walk the new bits plus the packet id 64 at a time.  index is
+    // the bit position of mLastSeqNum within the packet, which may
+    // be negative when feedback was lost.
+    uint32_t total = (new_bits + 1);
+    int32_t index = (CRtcpAppFeedbackPacket::NUM_ACK_BITS - new_bits);
+
+    // nothing before mLastSeqNum will be processed again
+    AdvanceCallbackWindow(mLastSeqNum);
+    
+    for (uint32_t done = 0; done < total; done += 64) {
+        uint32_t count = std::min((total - done), (uint32_t) 64);
+        uint64_t range = ((count == 64) ? ~0ULL : ((1ULL << count) - 1));
+        uint16_t first = (mLastSeqNum + done);
+
+        // slide the window up to cover these bits.  when feedback
+        // was lost this drops seqnos that are older than any bit in
+        // this packet, which can not be processed again.
+        uint16_t end = (first + count);
+        if ((uint16_t) (end - mCallbackBase) > CALLBACK_WINDOW_BITS) {
+            AdvanceCallbackWindow(end - CALLBACK_WINDOW_BITS);
         }
 
-        // if this seqno is marked as invalid
-        if (valid == CRtcpAppExtendedFeedbackPacket::APP_FB_INVALID) {
-            // if this is the first invalid seqno then remember it
-            if (haveInvalidSeqNum == false) {
-                firstInvalidSeqNum = curSeqNum;
-                haveInvalidSeqNum = true;
-            }
+        uint64_t ackBits = (GetFBFieldBits(acks, (index + (int32_t) done)) & range);
+        uint64_t invalidBits = (GetFBFieldBits(invalid, (index + (int32_t) done)) & range);
+
+        // protocol error checking, we should not have a case where a
+        // VALID-ACK follows an INVALID seqno.
+        uint64_t errorBits = 0;
+        if (haveInvalidSeqNum) {
+            errorBits = (ackBits & ~invalidBits);
+        } else if (invalidBits != 0) {
+            // remember the first invalid seqno
+            uint32_t bit = __builtin_ctzll(invalidBits);
+            firstInvalidSeqNum = (first + bit);
+            haveInvalidSeqNum = true;
+
+            errorBits = (ackBits & ~invalidBits & (~0ULL << bit));
+        }
 
-            // don't do anything with invalid seqno
-            continue;
+        // the packet id is only an implicit ACK if there were no
+        // invalid seqno, otherwise it is quietly skipped
+        uint64_t skipBits = (invalidBits | errorBits);
+        if (haveInvalidSeqNum && (done + count) == total) {
+            uint64_t idBit = (1ULL << (count - 1));
+            errorBits &= ~idBit;
+            skipBits |= idBit;
+        }
+        
+        while (errorBits != 0) {
+            uint16_t seqno = (first + __builtin_ctzll(errorBits));
+            AMDEBUG(RECV, ("%s invalid FB packet, valid ACK (seqno %hu) follows invalid packet (seqno %hu)",
+                           mLogPrefix.c_str(), seqno, firstInvalidSeqNum));
+            PrintPacketRx(*packet, VIDEO);
+            errorBits &= (errorBits - 1);
         }
 
-        if (ack == CRtcpAppFeedbackPacket::APP_FB_NACK) {
-            // ok for a VALID NACK to follow an INVALID seqno
-            DoAckNackCallback(curSeqNum, false);
+        // ok for a VALID NACK to follow an INVALID seqno
+        uint64_t valid = (range & ~skipBits);
+        DoAckNackCallback(first, (ackBits & valid), (~ackBits & valid));
+    }
 
-        } else {
+    // remember the last processed sequence number
+    mLastSeqNum = firstInvalidSeqNum;
+}
 
-            // protocol error checking, we should not have a case
-            // where a VALID-ACK follows an INVALID seqno.
-            if (haveInvalidSeqNum) {
-                AMDEBUG(RECV, ("%s invalid FB packet, valid ACK (seqno %hu) follows invalid packet (seqno %hu)",
-                               mLogPrefix.c_str(), curSeqNum, firstInvalidSeqNum));
-                PrintPacketRx(*packet, VIDEO);
+void CTipMediaSource::DoAckNackCallback(uint16_t first, uint64_t ackMask,
+                                        uint64_t nackMask)
+{
+    // only seqnos we haven't already done a callback for
+    uint64_t enabled = ((ackMask | nackMask) & ~GetCallbackDone(first));
+    if (enabled != 0) {
+        // no more callbacks for these seqnos
+        SetCallbackDone(first, enabled);
+
+        mpSourceCallback->ProcessAckNackRange(first, (ackMask & enabled),
+                                              (nackMask & enabled));
+    }
+}
 
-            } else {
-                DoAckNackCallback(curSeqNum, true);
-            }
-        }
+uint64_t CTipMediaSource::GetCallbackDone(uint16_t seqno) const
+{
+    // 64 bits starting at seqno, wrapping around the window
+    uint32_t pos = (seqno % CALLBACK_WINDOW_BITS);
+    uint32_t word = (pos / 64);
+    uint32_t shift = (pos % 64);
+
+    uint64_t bits = (mCallbackDone[word] >> shift);
+    if (shift != 0) {
+        bits |= (mCallbackDone[(word + 1) % CALLBACK_WINDOW_WORDS] << (64 - shift));
     }
 
-    // if there were no invalid seqno, then the packet id is always an
-    // ACK
-    if (! haveInvalidSeqNum) {
-        DoAckNackCallback(packet->GetPacketID(), true);
+    return bits;
+}
+
+void CTipMediaSource::SetCallbackDone(uint16_t seqno, uint64_t mask)
+{
+    uint32_t pos = (seqno % CALLBACK_WINDOW_BITS);
+    uint32_t word = (pos / 64);
+    uint32_t shift = (pos % 64);
+
+    mCallbackDone[word] |= (mask << shift);
+    if (shift != 0) {
+        mCallbackDone[(word + 1) % CALLBACK_WINDOW_WORDS] |= (mask >> (64 - shift));
     }
-    
-    // remember the last processed sequence number
-    mLastSeqNum = firstInvalidSeqNum;
 }
 
-void CTipMediaSource::DoAckNackCallback(uint16_t seqNum, bool isAck)
+void CTipMediaSource::AdvanceCallbackWindow(uint16_t seqno)
 {
-    // if we haven't already done a callback for this seqno
-    if (mCallbackEnable[seqNum]) {
-        if (isAck) {
-            mpSourceCallback->ProcessAck(seqNum);
-        } else {
-            mpSourceCallback->ProcessNack(seqNum);
-        }
+    // clear everything that falls out of the window
+    uint16_t diff = (seqno - mCallbackBase);
+    mCallbackBase = seqno;
 
-        // no more callbacks for this seqno until it gets re-enabled
-        mCallbackEnable[seqNum] = 0;
+    if (diff >= CALLBACK_WINDOW_BITS) {
+        memset(mCallbackDone, 0, sizeof(mCallbackDone));
+        return;
     }
 
-    // re-enable the callback for the "flip side" seqno
-    uint16_t flipSeqNum = (seqNum + (uint16_t) 0x8000);
-    mCallbackEnable[flipSeqNum] = 1;
+    uint32_t pos = ((uint16_t) (seqno - diff) % CALLBACK_WINDOW_BITS);
+    while (diff > 0) {
+        uint32_t shift = (pos % 64);
+        uint32_t num = std::min((uint32_t) (64 - shift), (uint32_t) diff);
+        uint64_t mask = ((num == 64) ? ~0ULL : (((1ULL << num) - 1) << shift));
+        
+        mCallbackDone[pos / 64] &= ~mask;
+
+        pos = ((pos + num) % CALLBACK_WINDOW_BITS);
+        diff -= num;
+    }
 }
@@ -21,9 +21,13 @@
 
 #include "tip_csrc.h"
 #include "tip_constants.h"
+#include "tip_log_limit.h"
+#include "tip_stats.h"
 #include "tip_packet_transmit.h"
 #include "rtcp_tip_packet_manager.h"
+#include "rtcp_tip_feedback_packet.h"
 #include "tip_media_callback.h"
+#include "tip_scheduler.h"
 #include "private/tip_packet_receiver.h"
 
 namespace LibTip {
@@ -35,9 +39,11 @@ namespace LibTip {
     /**
      * Abstract base class for media Tip implementations.  Base
      * class for Tip media APIs, not directly usable.  Users should
-     * use CTipMediaSink or CTipMediaSource instead.
+     * use CTipMediaSink or CTipMediaSource instead.  Time related
+     * actions are driven either by polling GetIdleTime() and
+     * DoPeriodicActivity() or by attaching a CTipScheduler.
      */
-    class CTipMedia {
+    class CTipMedia : public CTipSchedulable {
     public:
         /**
          * Public constructor.
@@ -94,6 +100,59 @@ namespace LibTip {
          */
         void SetRetransmissionLimit(uint32_t limit);
 
+        /**
+         * Enable exponential backoff of Tip packet retransmissions.
+         * Each retransmission of a packet waits multiplier times
+         * longer than the previous one, up to maxIntervalMS.  By
+         * default there is no backoff (a multiplier of 1).  Note
+         * that backoff lengthens the time before an unacknowledged
+         * packet times out.
+         *
+         * @param multiplier factor applied to the interval after each
+         * retransmission, 1 disables backoff
+         * @param maxIntervalMS largest interval between
+         * retransmissions, in milliseconds, 0 means no limit
+         */
+        void SetRetransmissionBackoff(uint32_t multiplier, uint32_t maxIntervalMS);
+
+        /**
+         * Randomize Tip packet retransmission intervals.  Each
+         * retransmission interval is randomly moved by up to the given
+         * percentage in either direction so that packets queued at the
+         * same time are spread out.  The default is 0 (no jitter).
+         *
+         * @param percent maximum jitter, in percent of the interval
+         */
+        void SetRetransmissionJitter(uint32_t percent);
+
+        /**
+         * Derive the retransmission interval from the measured round
+         * trip time.  Round trip times are measured from ACKs of Tip
+         * packets that were only transmitted once and from ECHO
+         * replies, and smoothed as described in RFC 6298.  Once a
+         * measurement is available the retransmission timeout it
+         * produces, bounded by minIntervalMS and maxIntervalMS, is
+         * used instead of the interval given to
+         * SetRetransmissionInterval().
+         *
+         * @param minIntervalMS smallest retransmission interval, in milliseconds
+         * @param maxIntervalMS largest retransmission interval, in milliseconds
+         */
+        void EnableAdaptiveRetransmission(uint32_t minIntervalMS, uint32_t maxIntervalMS);
+
+        /**
+         * Go back to the fixed retransmission interval.
+         */
+        void DisableAdaptiveRetransmission();
+
+        /**
+         * Get the smoothed round trip time.
+         *
+         * @return round trip time in milliseconds, 0 if it has not
+         * been measured yet
+         */
+        uint32_t GetRoundTripTime() const;
+
         /**
          * Get the idle time until the next Tip action.  Get the
          * amount of time until the next Tip action needs to occur
@@ -104,7 +163,7 @@ namespace LibTip {
          * there are no scheduled actions
          * @see DoPeriodicActivity()
          */
-        uint64_t GetIdleTime() const;
+        virtual uint64_t GetIdleTime() const;
 
         /**
          * Perform periodic activity.  The Tip will take periodic
@@ -115,7 +174,7 @@ namespace LibTip {
          *
          * @see GetIdleTime()
          */
-        void DoPeriodicActivity();
+        virtual void DoPeriodicActivity();
 
         /**
          * Set a log prefix string.  As there may be multiple media
@@ -129,13 +188,35 @@ namespace LibTip {
          * @param string the prefix string to use (a copy is made)
          */
         void SetLogPrefix(const char* string);
+
+        /**
+         * Limit the rate of packet dumps.  With DEBUG_XMIT or
+         * DEBUG_RECV enabled packets are dumped in human readable
+         * form, at a high packet rate that can swamp the log.  At
+         * most count packet dumps are printed in each interval, the
+         * number dropped is reported with the next dump printed.  By
+         * default there is no limit.
+         *
+         * @param count packet dumps allowed per interval, 0 for no limit
+         * @param intervalMS length of the interval, in milliseconds
+         */
+        void SetPacketDumpLimit(uint32_t count, uint32_t intervalMS);
+
+        /**
+         * Get the statistics for this media.  Lock free, may be
+         * called from any thread while the media is running.
+         *
+         * @param stats filled in with a copy of the statistics
+         * @see CTipStats
+         */
+        void GetStats(CTipStats& stats) const;
         
     protected:
         void StartPacketTx(CRtcpTipPacket* packet);
         void StopPacketTx(TipPacketType pType);
 
-        void PrintPacketTx(const CRtcpPacket& packet, MediaType mType) const;
-        void PrintPacketRx(const CRtcpPacket& packet, MediaType mType) const;
+        void PrintPacketTx(const CRtcpPacket& packet, MediaType mType);
+        void PrintPacketRx(const CRtcpPacket& packet, MediaType mType);
         
         virtual void ProcessPacket(CRtcpTipPacket* packet);
         virtual void ProcessAckPacket(CRtcpTipPacket* packet);
@@ -150,6 +231,8 @@ namespace LibTip {
         CTipPacketManager   mPacketManager;
         CTipPacketReceiver  mPacketReceiver;
         std::string            mLogPrefix;
+        CTipLogLimiter         mDumpLimit;
+        CTipStats              mStats;
         
     private:
         // do not allow copy or assignment
@@ -235,12 +318,28 @@ namespace LibTip {
         uint32_t                  mSourceCSRC;
         CTipMediaSinkCallback*    mpSinkCallback;
 
+        // ACK window helpers, see mAckWindow below
+        void SetAckRange(uint16_t seqno, uint32_t count, bool ack);
+        uint64_t GetAckBits(uint16_t seqno) const;
+        
         bool                      mHaveLastSeqNum;
         uint16_t                  mLastSeqNum;
 
-        // enough bits and bytes to store the all possible sequence numbers
-        static const uint32_t     NUM_ACK_BITS  = 65536;
-        std::bitset<NUM_ACK_BITS> mAcks;
+        // received sequence numbers, one bit per sequence number kept
+        // in a ring of words indexed by (seqno % ACK_WINDOW_BITS).
+        // only the feedback horizon behind mLastSeqNum is needed, the
+        // window size must divide 65536 so the ring wraps with the
+        // sequence numbers.
+        static const uint32_t     ACK_WINDOW_WORDS = 2;
+        static const uint32_t     ACK_WINDOW_BITS  = (ACK_WINDOW_WORDS * 64);
+        uint64_t                  mAckWindow[ACK_WINDOW_WORDS];
+
+        // feedback packet sent at the end of each frame and its packed
+        // form.  only the packet id and acks change between frames so
+        // they are patched into the packed copy, it is only packed
+        // again when the SSRC or target changes.
+        CRtcpAppFeedbackPacket    mFBPacket;
+        CPacketBufferData         mFBBuffer;
         
     private:
         // do not allow copy or assignment
@@ -300,15 +399,29 @@ namespace LibTip {
         virtual void ProcessPacket(CRtcpTipPacket* packet);
         virtual void ProcessFBPacket(CRtcpAppFeedbackPacket* packet);
 
-        void DoAckNackCallback(uint16_t seqNum, bool isAck);
+        // invoke the range callback for the enabled seqnos of up to
+        // 64 seqnos starting at first
+        void DoAckNackCallback(uint16_t first, uint64_t ackMask, uint64_t nackMask);
 
+        // callback window helpers, see mCallbackDone below
+        uint64_t GetCallbackDone(uint16_t seqno) const;
+        void SetCallbackDone(uint16_t seqno, uint64_t mask);
+        void AdvanceCallbackWindow(uint16_t seqno);
         
         bool                      mHaveLastSeqNum;
         uint16_t                  mLastSeqNum;
         
-        // enough bits and bytes to store the all possible sequence numbers
-        static const uint32_t     NUM_ACK_BITS  = 65536;
-        std::bitset<NUM_ACK_BITS> mCallbackEnable;
+        // seqnos that already had a callback, one bit per sequence
+        // number in a ring of words indexed by (seqno %
+        // CALLBACK_WINDOW_BITS), covering the window starting at
+        // mCallbackBase.  feedback is only re-processed from the
+        // first invalid seqno, which is always within the bits of
+        // the last feedback packet, so the window only has to cover
+        // one packet.  bits outside the window are always 0.
+        static const uint32_t     CALLBACK_WINDOW_WORDS = 2;
+        static const uint32_t     CALLBACK_WINDOW_BITS  = (CALLBACK_WINDOW_WORDS * 64);
+        uint16_t                  mCallbackBase;
+        uint64_t                  mCallbackDone[CALLBACK_WINDOW_WORDS];
         
         CTipMediaSourceCallback*  mpSourceCallback;
 
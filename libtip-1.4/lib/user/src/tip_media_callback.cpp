@@ -36,3 +36,22 @@ void CTipMediaSourceCallback::H264Configure(uint32_t bitrate, uint16_t level_int
 void CTipMediaSourceCallback::Refresh(bool idr) {}
 void CTipMediaSourceCallback::ProcessNack(uint16_t seqno) {}
 void CTipMediaSourceCallback::ProcessAck(uint16_t seqno) {}
+
+void CTipMediaSourceCallback::ProcessAckNackRange(uint16_t first, uint64_t ackMask,
+                                                  uint64_t nackMask)
+{
+    // walk the set bits lowest first so callbacks are in seqno order
+    uint64_t bits = (ackMask | nackMask);
+    while (bits != 0) {
+        uint64_t bit = (bits & -bits);
+        uint16_t seqno = (first + __builtin_ctzll(bits));
+
+        if (ackMask & bit) {
+            ProcessAck(seqno);
+        } else {
+            ProcessNack(seqno);
+        }
+        
+        bits &= ~bit;
+    }
+}
@@ -144,6 +144,26 @@ namespace LibTip {
          * @param seqno the RTP sequence number of the received packet
          */
         virtual void ProcessAck(uint16_t seqno);
+
+        /**
+         * Process a range of feedback ACKs and NACKs.  This callback
+         * is invoked with at most 64 consecutive sequence numbers per
+         * call.  A feedback message can report up to 113 new sequence
+         * numbers (112 ACK bits plus the packet id) so one message may
+         * result in two calls.  Bit N of each mask refers to sequence
+         * number (first + N).  A sequence number is set in at most
+         * one of the masks, bits clear in both have nothing to
+         * report.  The default implementation invokes ProcessAck()
+         * or ProcessNack() for each set bit in sequence number
+         * order, users with high packet rates can override this
+         * instead to handle a whole range at once.
+         *
+         * @param first the RTP sequence number of bit 0
+         * @param ackMask sequence numbers that were received
+         * @param nackMask sequence numbers that were lost
+         */
+        virtual void ProcessAckNackRange(uint16_t first, uint64_t ackMask,
+                                         uint64_t nackMask);
     };
 
 };
@@ -0,0 +1,35 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "packet_buffer.h"
+#include "tip_packet_transmit.h"
+using namespace LibTip;
+
+Status CTipPacketTransmit::TransmitV(const struct iovec* iov, uint32_t iovcnt,
+                                     MediaType mType)
+{
+    // gather the segments into a single buffer for Transmit()
+    CPacketBufferData buffer;
+    for (uint32_t i = 0; i < iovcnt; i++) {
+        buffer.Add((const uint8_t*) iov[i].iov_base, iov[i].iov_len);
+    }
+
+    if (buffer.IsOverflow()) {
+        return TIP_ERROR;
+    }
+    
+    return Transmit(buffer.GetBuffer(), buffer.GetBufferSize(), mType);
+}
@@ -17,6 +17,8 @@
 #ifndef TIP_PACKET_TRANSMIT_H
 #define TIP_PACKET_TRANSMIT_H
 
+#include <sys/uio.h>
+
 #include "tip_constants.h"
 
 namespace LibTip {
@@ -43,6 +45,25 @@ namespace LibTip {
          */
         virtual Status Transmit(const uint8_t* pktBuffer, uint32_t pktSize,
                                 MediaType mType) = 0;
+
+        /**
+         * Transmit the given packet as a list of segments.  The Tip
+         * library uses this method when a packet is made up of
+         * separately stored pieces (e.g. a shared RTCP wrapper
+         * followed by the Tip packet).  The segments must be sent
+         * as a single packet, in order.  The default implementation
+         * copies the segments into one buffer and calls Transmit(),
+         * users with a scatter-gather send (e.g. sendmsg()) can
+         * override it to avoid the copy.  Segment data is owned by
+         * the library and must not be modified.
+         *
+         * @param iov array of packet segments
+         * @param iovcnt number of segments in iov
+         * @param mType whether the packet is related to AUDIO or VIDEO
+         * @return TIP_OK if transmission suceeds, otherwise TIP_ERROR
+         */
+        virtual Status TransmitV(const struct iovec* iov, uint32_t iovcnt,
+                                 MediaType mType);
     };
 
 };
@@ -18,13 +18,55 @@
 #include "tip_constants.h"
 #include "tip_csrc.h"
 #include "rtcp_packet.h"
-#include "rtcp_packet_factory.h"
-#include "rtcp_tip_flowctrl_packet.h"
-#include "rtcp_tip_refresh_packet.h"
+#include "rtcp_packet_view.h"
 #include "rtcp_tip_feedback_packet.h"
 
 using namespace LibTip;
 
+// how each TIP packet type is classified.  packets that carry a
+// target CSRC give the offset of the CSRC, the position is then taken
+// from the CSRC.  otherwise the fixed position is used.
+struct ClassifyEntry {
+    CTipRelay::Classification mClass;
+    uint32_t                  mTargetOffset;
+    uint16_t                  mPos;
+};
+
+static const ClassifyEntry gClassifyTable[MAX_PACKET_TYPE] = {
+    { CTipRelay::NOT_TIP,      0, 0 },      // RESERVED0
+    { CTipRelay::SYSTEM,       0, 0 },      // MUXCTRL
+    { CTipRelay::NOT_TIP,      0, 0 },      // UNUSED
+    { CTipRelay::SYSTEM,       0, 0 },      // NOTIFY
+    { CTipRelay::SYSTEM,       0, 0 },      // ECHO
+    { CTipRelay::MEDIA_SOURCE, CRtcpPacketView::FLOWCTRL_TARGET_OFFSET, 0 }, // TXFLOWCTRL
+    { CTipRelay::MEDIA_SINK,   CRtcpPacketView::FLOWCTRL_TARGET_OFFSET, 0 }, // RXFLOWCTRL
+    { CTipRelay::SYSTEM,       0, 0 },      // MEDIAOPTS
+    { CTipRelay::MEDIA_SOURCE, CRtcpPacketView::TIP_TARGET_OFFSET, 0 },      // REFRESH
+    { CTipRelay::NOT_TIP,      0, 0 },      // UNUSED
+    { CTipRelay::NOT_TIP,      0, 0 },      // UNUSED
+    { CTipRelay::NOT_TIP,      0, 0 },      // UNUSED
+    { CTipRelay::SYSTEM,       0, 0 },      // SPIMAP
+    { CTipRelay::NOT_TIP,      0, 0 },      // UNUSED
+    { CTipRelay::NOT_TIP,      0, 0 },      // UNUSED
+    { CTipRelay::SYSTEM,       0, 0 },      // REQTOSEND
+    { CTipRelay::NOT_TIP,      0, 0 },      // ACK_UNUSED
+    { CTipRelay::SYSTEM,       0, 0 },      // ACK_MUXCTRL
+    { CTipRelay::NOT_TIP,      0, 0 },      // ACK_UNUSED
+    { CTipRelay::SYSTEM,       0, 0 },      // ACK_NOTIFY
+    { CTipRelay::SYSTEM,       0, 0 },      // ACK_ECHO
+    { CTipRelay::MEDIA_SINK,   0, 0xFFFF }, // ACK_TXFLOWCTRL
+    { CTipRelay::MEDIA_SOURCE, 0, 0xFFFF }, // ACK_RXFLOWCTRL
+    { CTipRelay::SYSTEM,       0, 0 },      // ACK_MEDIAOPTS
+    { CTipRelay::MEDIA_SINK,   0, 0xFFFF }, // ACK_REFRESH
+    { CTipRelay::NOT_TIP,      0, 0 },      // ACK_UNUSED
+    { CTipRelay::NOT_TIP,      0, 0 },      // ACK_UNUSED
+    { CTipRelay::NOT_TIP,      0, 0 },      // ACK_UNUSED
+    { CTipRelay::SYSTEM,       0, 0 },      // ACK_SPIMAP
+    { CTipRelay::NOT_TIP,      0, 0 },      // ACK_UNUSED
+    { CTipRelay::NOT_TIP,      0, 0 },      // ACK_UNUSED
+    { CTipRelay::SYSTEM,       0, 0 }       // ACK_REQTOSEND
+};
+
 CTipRelay::CTipRelay() {}
 CTipRelay::~CTipRelay() {}
 
@@ -33,160 +75,90 @@ CTipRelay::Classify(uint8_t* buffer, uint32_t size, uint16_t& pos)
 {
     CTipRelay::Classification ret = NOT_TIP;
     
-    // create an RTCP tip packet from the given buffer
-    CPacketBuffer packet_buffer(buffer, size);
-    
     // tip packets may be contained in compound rtcp packets.  find
     // the part of the packet we care about and forward based on that.
-    CRtcpPacket* rtcp;
+    // packets are inspected in place, nothing is unpacked.
+    CRtcpCompoundView compound(buffer, size);
+    CRtcpPacketView view;
     
-    while (ret == NOT_TIP && packet_buffer.GetBufferSize() > 0) {
-        rtcp = CRtcpPacketFactory::CreatePacketFromBuffer(packet_buffer);
-
-        // if we can't create a packet then we don't need to process it
-        if (rtcp == NULL) {
-            // something we couldn't parse, keep going until the
-            // buffer is empty
-            continue;
-        }
-
-        if (rtcp->GetType() == CRtcpPacket::APP) {
-            ret = ClassifyAPP(rtcp, pos);
-        } else if (rtcp->GetType() == CRtcpPacket::RTPFB) {
-            ret = ClassifyFB(rtcp, pos);
+    while (ret == NOT_TIP && compound.Next(view) == 0) {
+        if (view.GetType() == CRtcpPacket::APP) {
+            ret = ClassifyAPP(view, pos);
+        } else if (view.GetType() == CRtcpPacket::RTPFB) {
+            ret = ClassifyFB(view, pos);
         }
-
-        delete rtcp;
     }
     
     return ret;
 }
 
+uint32_t CTipRelay::ClassifyBatch(uint8_t* const buffers[], const uint32_t sizes[],
+                                 uint32_t count, Classification classifications[],
+                                 uint16_t pos[])
+{
+    uint32_t numTip = 0;
+
+    // no state is shared between packets, each is classified alone
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t p = 0;
+        Classification c = Classify(buffers[i], sizes[i], p);
+
+        classifications[i] = c;
+        pos[i] = ((c != NOT_TIP) ? p : 0);
+        numTip += (c != NOT_TIP);
+    }
+
+    return numTip;
+}
+
 CTipRelay::Classification
-CTipRelay::ClassifyAPP(CRtcpPacket* rtcp, uint16_t& pos)
+CTipRelay::ClassifyAPP(const CRtcpPacketView& view, uint16_t& pos)
 {
-    CRtcpTipPacket* packet = dynamic_cast<CRtcpTipPacket*>(rtcp);
-    if (packet == NULL) {
+    // skip anything too short to be parsed as its TIP type
+    if (! view.IsTipPacketComplete()) {
         return NOT_TIP;
     }
     
-    // init return positions to 0
-    pos = 0;
-    
     // some kind of tip packet, classify based on type
-    switch (packet->GetTipPacketType()) {
-    case MUXCTRL:
-        return SYSTEM;
-
-    case NOTIFY:
-        return SYSTEM;
-
-    case TIPECHO:
-        return SYSTEM;
-
-    case TXFLOWCTRL:
-        GetPositionForPacket(packet, pos);
-        return MEDIA_SOURCE;
-
-    case RXFLOWCTRL:
-        GetPositionForPacket(packet, pos);
-        return MEDIA_SINK;
-
-    case MEDIAOPTS:
-        return SYSTEM;
-
-    case REFRESH:
-        GetPositionForPacket(packet, pos);
-        return MEDIA_SOURCE;
-
-    case SPIMAP:
-        return SYSTEM;
-
-    case REQTOSEND:
-        return SYSTEM;
-
-    case ACK_MUXCTRL:
-        return SYSTEM;
-
-    case ACK_NOTIFY:
-        return SYSTEM;
-
-    case ACK_TIPECHO:
-        return SYSTEM;
-        
-    case ACK_TXFLOWCTRL:
-        pos = 0xFFFF;
-        return MEDIA_SINK;
-
-    case ACK_RXFLOWCTRL:
-        pos = 0xFFFF;
-        return MEDIA_SOURCE;
-
-    case ACK_MEDIAOPTS:
-        return SYSTEM;
-
-    case ACK_REFRESH:
-        pos = 0xFFFF;
-        return MEDIA_SINK;
-
-    case ACK_SPIMAP:
-        return SYSTEM;
-
-    case ACK_REQTOSEND:
-        return SYSTEM;
-
-    default:
+    const ClassifyEntry& entry = gClassifyTable[view.GetTipPacketType()];
+    if (entry.mClass == NOT_TIP) {
         return NOT_TIP;
     }
+
+    if (entry.mTargetOffset != 0) {
+        GetPositionForPacket(view, pos);
+    } else {
+        pos = entry.mPos;
+    }
+    
+    return entry.mClass;
 }
 
 CTipRelay::Classification
-CTipRelay::ClassifyFB(CRtcpPacket* rtcp, uint16_t& pos)
+CTipRelay::ClassifyFB(const CRtcpPacketView& view, uint16_t& pos)
 {
-    CTipCSRC csrc(0);
-
-    CRtcpAppFeedbackPacket* fb = dynamic_cast<CRtcpAppFeedbackPacket*>(rtcp);
-    if (fb != NULL) {
-        csrc.SetCSRC(fb->GetTarget());
+    // only TIP feedback packets, same checks as unpacking a
+    // CRtcpAppFeedbackPacket
+    if (view.GetSubType() != CRtcpAppFeedbackPacket::APPFB_SUBTYPE ||
+        view.GetSize() < CRtcpPacketView::FB_MIN_SIZE) {
+        return NOT_TIP;
     }
     
+    CTipCSRC csrc(view.Get32(CRtcpPacketView::FB_TARGET_OFFSET));
+    
     pos = (1 << csrc.GetSourcePos());
     return MEDIA_SOURCE;
 }
 
 // CSRC is in different places in different packets, so pull the CSRC
 // and the affected position out based on packet type.
-void CTipRelay::GetPositionForPacket(CRtcpTipPacket* packet, uint16_t& pos)
+void CTipRelay::GetPositionForPacket(const CRtcpPacketView& view, uint16_t& pos)
 {
     CTipCSRC csrc(0);
     
-    switch (packet->GetTipPacketType()) {
-      case TXFLOWCTRL: {
-          CRtcpAppTXFlowCtrlPacket* tx = dynamic_cast<CRtcpAppTXFlowCtrlPacket*>(packet);
-          if (tx != NULL) {
-              csrc.SetCSRC(tx->GetTarget());
-          }
-          break;
-      }
-        
-      case RXFLOWCTRL: {
-          CRtcpAppRXFlowCtrlPacket* rx = dynamic_cast<CRtcpAppRXFlowCtrlPacket*>(packet);
-          if (rx != NULL) {
-              csrc.SetCSRC(rx->GetTarget());
-          }
-          break;
-      }
-        
-      case REFRESH: {
-          CRtcpAppRefreshPacket* ref = dynamic_cast<CRtcpAppRefreshPacket*>(packet);
-          if (ref != NULL) {
-              csrc.SetCSRC(ref->GetTarget());
-          }
-          break;
-      }
-
-    default:
-        break;
+    uint32_t offset = gClassifyTable[view.GetTipPacketType()].mTargetOffset;
+    if (offset != 0) {
+        csrc.SetCSRC(view.Get32(offset));
     }
 
     pos = (1 << csrc.GetSourcePos());
@@ -22,8 +22,7 @@
 namespace LibTip {
 
     /* predeclare used classes */
-    class CRtcpPacket;
-    class CRtcpTipPacket;
+    class CRtcpPacketView;
     
     /**
      * User interface class for relay implementations.  CTipRelay
@@ -54,7 +53,9 @@ namespace LibTip {
         /**
          * Classify a received packet.  This API will process the
          * given packet (without changing it in any way), and return
-         * the classification type.  For the MEDIA_* classification
+         * the classification type.  Only the fields needed for
+         * classification are read, directly from the given buffer, so
+         * no memory is allocated.  For the MEDIA_* classification
          * types, the parameter "position" will be set to a bitfield
          * of the position(s) of the addressed media instance.  In
          * some cases it is impossible to determine the specific media
@@ -75,21 +76,45 @@ namespace LibTip {
          */
         Classification Classify(uint8_t* buffer, uint32_t size, uint16_t& pos);
 
+        /**
+         * Classify a batch of received packets.  This is a
+         * convenience wrapper that calls Classify() on each packet in
+         * turn for users that receive many packets at once (e.g. with
+         * recvmmsg()), it is not faster per packet than calling
+         * Classify() directly.  For each packet the
+         * classification is written to the matching entry in the
+         * classification array and the position bitmask to the
+         * matching entry in the position array.  The position of a
+         * NOT_TIP packet is set to 0.
+         *
+         * @param buffers array of pointers to the packets received
+         * @param sizes array of lengths of the received packets
+         * @param count number of entries in each of the arrays
+         * @param classifications array the classification types are
+         * written to
+         * @param pos array the position bitmasks are written to
+         * @return number of packets classified as something other
+         * than NOT_TIP
+         */
+        uint32_t ClassifyBatch(uint8_t* const buffers[], const uint32_t sizes[],
+                               uint32_t count, Classification classifications[],
+                               uint16_t pos[]);
+
     protected:
         /**
          * Helper function to classify APP RTCP packets.
          */
-        CTipRelay::Classification ClassifyAPP(CRtcpPacket* rtcp, uint16_t& pos);
+        CTipRelay::Classification ClassifyAPP(const CRtcpPacketView& view, uint16_t& pos);
         
         /**
          * Helper function to classify FB RTCP packets.
          */
-        CTipRelay::Classification ClassifyFB(CRtcpPacket* rtcp, uint16_t& pos);
+        CTipRelay::Classification ClassifyFB(const CRtcpPacketView& view, uint16_t& pos);
         
         /**
          * Helper function to retrive position information from a given packet.
          */
-        void GetPositionForPacket(CRtcpTipPacket* packet, uint16_t& pos);
+        void GetPositionForPacket(const CRtcpPacketView& view, uint16_t& pos);
     };
 };
 
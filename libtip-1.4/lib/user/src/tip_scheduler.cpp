@@ -0,0 +1,288 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+#include <unistd.h>
+
+#include "tip_debug_print.h"
+#include "tip_time.h"
+#include "tip_scheduler.h"
+using namespace LibTip;
+
+static const uint32_t kInvalidSchedIndex = 0xFFFFFFFF;
+static const uint64_t kNeverMsec = (uint64_t) -1;
+
+CTipSchedulable::CTipSchedulable() :
+    mpScheduler(NULL), mSchedIndex(kInvalidSchedIndex), mSchedTime(kNeverMsec)
+{
+
+}
+
+CTipSchedulable::~CTipSchedulable()
+{
+    if (mpScheduler != NULL) {
+        mpScheduler->Detach(*this);
+    }
+}
+
+void CTipSchedulable::SetScheduler(CTipScheduler* scheduler)
+{
+    if (mpScheduler == scheduler) {
+        return;
+    }
+    
+    if (mpScheduler != NULL) {
+        mpScheduler->Detach(*this);
+    }
+
+    mpScheduler = scheduler;
+    Reschedule();
+}
+
+void CTipSchedulable::Reschedule()
+{
+    if (mpScheduler == NULL) {
+        return;
+    }
+
+    uint64_t idle = GetIdleTime();
+    if (idle == kNeverMsec) {
+        mpScheduler->Schedule(*this, kNeverMsec);
+    } else {
+        mpScheduler->Schedule(*this, (GetMsecTimestamp() + idle));
+    }
+}
+
+CTipEventScheduler::CTipEventScheduler(bool useFd) :
+    mFd(-1), mArmedTime(kNeverMsec), mRunning(false)
+{
+#ifdef __linux__
+    if (useFd) {
+        mFd = timerfd_create(CLOCK_MONOTONIC, (TFD_NONBLOCK | TFD_CLOEXEC));
+        if (mFd < 0) {
+            AMDEBUG(INTERR, ("could not create scheduler timer fd"));
+        }
+    }
+#endif
+}
+
+CTipEventScheduler::~CTipEventScheduler()
+{
+    if (mFd >= 0) {
+        close(mFd);
+    }
+}
+
+void CTipEventScheduler::Schedule(CTipSchedulable& object, uint64_t msec)
+{
+    if (msec == kNeverMsec) {
+        Remove(object);
+        return;
+    }
+
+    uint32_t& index = SchedIndex(object);
+    uint64_t& time  = SchedTime(object);
+    
+    if (index == kInvalidSchedIndex) {
+        time  = msec;
+        index = mHeap.size();
+        mHeap.push_back(&object);
+        SiftUp(index);
+    } else if (msec < time) {
+        time = msec;
+        SiftUp(index);
+    } else if (msec > time) {
+        time = msec;
+        SiftDown(index);
+    }
+
+    Arm();
+}
+
+void CTipEventScheduler::Remove(CTipSchedulable& object)
+{
+    uint32_t index = SchedIndex(object);
+    if (index == kInvalidSchedIndex) {
+        return;
+    }
+
+    RemoveAt(index);
+    Arm();
+}
+
+uint64_t CTipEventScheduler::GetIdleTime() const
+{
+    if (mHeap.empty()) {
+        return kNeverMsec;
+    }
+
+    uint64_t now  = GetMsecTimestamp();
+    uint64_t next = SchedTime(*mHeap[0]);
+    if (now >= next) {
+        return 0;
+    }
+
+    return (next - now);
+}
+
+uint32_t CTipEventScheduler::DoPeriodicActivity()
+{
+    CTipTimeCache now;
+    
+#ifdef __linux__
+    // clear the expiration count so the fd stops being readable
+    if (mFd >= 0) {
+        uint64_t expirations;
+        if (read(mFd, &expirations, sizeof(expirations)) < 0) {
+            // nothing had expired yet
+        }
+    }
+#endif
+
+    // take every due object off the heap first so objects that
+    // reschedule themselves for right now are not run twice
+    uint64_t msec = GetMsecTimestamp();
+    mDue.clear();
+    while (! mHeap.empty() && SchedTime(*mHeap[0]) <= msec) {
+        mDue.push_back(mHeap[0]);
+        RemoveAt(0);
+    }
+
+    // hold off re-arming the timer until everyone has run
+    mRunning = true;
+    for (uint32_t i = 0; i < mDue.size(); i++) {
+        mDue[i]->DoPeriodicActivity();
+    }
+    mRunning = false;
+
+    // the timer is one shot, make sure it gets armed again
+    mArmedTime = 0;
+    Arm();
+    
+    return mDue.size();
+}
+
+bool CTipEventScheduler::Before(uint32_t a, uint32_t b) const
+{
+    return (SchedTime(*mHeap[a]) < SchedTime(*mHeap[b]));
+}
+
+void CTipEventScheduler::Swap(uint32_t a, uint32_t b)
+{
+    CTipSchedulable* tmp = mHeap[a];
+    mHeap[a] = mHeap[b];
+    mHeap[b] = tmp;
+
+    SchedIndex(*mHeap[a]) = a;
+    SchedIndex(*mHeap[b]) = b;
+}
+
+void CTipEventScheduler::SiftUp(uint32_t pos)
+{
+    while (pos > 0) {
+        uint32_t parent = ((pos - 1) / 2);
+        if (! Before(pos, parent)) {
+            break;
+        }
+
+        Swap(pos, parent);
+        pos = parent;
+    }
+}
+
+void CTipEventScheduler::SiftDown(uint32_t pos)
+{
+    uint32_t size = mHeap.size();
+
+    while (true) {
+        uint32_t left  = ((2 * pos) + 1);
+        uint32_t right = (left + 1);
+        uint32_t least = pos;
+
+        if (left < size && Before(left, least)) {
+            least = left;
+        }
+        if (right < size && Before(right, least)) {
+            least = right;
+        }
+        if (least == pos) {
+            break;
+        }
+
+        Swap(pos, least);
+        pos = least;
+    }
+}
+
+void CTipEventScheduler::RemoveAt(uint32_t pos)
+{
+    CTipSchedulable* object = mHeap[pos];
+    uint32_t last = (mHeap.size() - 1);
+
+    if (pos != last) {
+        Swap(pos, last);
+    }
+    mHeap.pop_back();
+
+    SchedIndex(*object) = kInvalidSchedIndex;
+    SchedTime(*object)  = kNeverMsec;
+
+    if (pos < mHeap.size()) {
+        SiftDown(pos);
+        SiftUp(pos);
+    }
+}
+
+void CTipEventScheduler::Arm()
+{
+    if (mRunning || mFd < 0) {
+        return;
+    }
+
+    uint64_t next = (mHeap.empty() ? kNeverMsec : SchedTime(*mHeap[0]));
+    if (next == mArmedTime) {
+        return;
+    }
+    mArmedTime = next;
+    
+#ifdef __linux__
+    // the library clock may not be the monotonic clock so always arm
+    // relative to now.  a zero value disarms the timer, use 1ns for
+    // objects that are already due.
+    struct itimerspec its;
+    its.it_interval.tv_sec  = 0;
+    its.it_interval.tv_nsec = 0;
+    its.it_value.tv_sec     = 0;
+    its.it_value.tv_nsec    = 0;
+    
+    if (next != kNeverMsec) {
+        uint64_t now = GetMsecTimestamp();
+        uint64_t wait = (next > now ? (next - now) : 0);
+
+        its.it_value.tv_sec  = (wait / kMsecTimeScale);
+        its.it_value.tv_nsec = ((wait % kMsecTimeScale) * (kNsecTimeScale / kMsecTimeScale));
+        if (wait == 0) {
+            its.it_value.tv_nsec = 1;
+        }
+    }
+
+    if (timerfd_settime(mFd, 0, &its, NULL) != 0) {
+        AMDEBUG(INTERR, ("could not arm scheduler timer fd"));
+    }
+#endif
+}
@@ -0,0 +1,223 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIP_SCHEDULER_H
+#define TIP_SCHEDULER_H
+
+#include <vector>
+
+#include "tip_constants.h"
+
+namespace LibTip {
+
+    class CTipScheduler;
+    
+    /**
+     * Base class for objects that need DoPeriodicActivity() calls.
+     * CTip and CTipMedia derive from this class.  By default users
+     * poll GetIdleTime() and call DoPeriodicActivity() themselves.
+     * When a scheduler is attached with SetScheduler() the object
+     * instead reports each change in its next due time to the
+     * scheduler, which only needs to wake the objects that are due.
+     */
+    class CTipSchedulable {
+    public:
+        CTipSchedulable();
+
+        /**
+         * Destructor, removes the object from its scheduler.
+         */
+        virtual ~CTipSchedulable();
+
+        /**
+         * Get the idle time until the next action.
+         *
+         * @return idle time in milliseconds, (uint64_t) -1 means
+         * there are no scheduled actions
+         */
+        virtual uint64_t GetIdleTime() const = 0;
+
+        /**
+         * Perform periodic activity.
+         */
+        virtual void DoPeriodicActivity() = 0;
+        
+        /**
+         * Attach a scheduler.  The scheduler is told about the
+         * current due time right away and after every call that may
+         * change it.  The scheduler must outlive the object.
+         *
+         * @param scheduler the scheduler to use, NULL to go back to
+         * polling
+         */
+        void SetScheduler(CTipScheduler* scheduler);
+
+        /**
+         * Get the attached scheduler.
+         *
+         * @return the scheduler or NULL if none is attached
+         */
+        CTipScheduler* GetScheduler() const { return mpScheduler; }
+
+    protected:
+        // report our due time to the scheduler, if any
+        void Reschedule();
+
+    private:
+        friend class CTipScheduler;
+        
+        CTipScheduler* mpScheduler;
+
+        // bookkeeping owned by the scheduler
+        uint32_t       mSchedIndex;
+        uint64_t       mSchedTime;
+
+        // do not allow copy or assignment
+        CTipSchedulable(const CTipSchedulable&);
+        CTipSchedulable& operator=(const CTipSchedulable&);
+    };
+
+    /**
+     * Interface class for event loop integration.  Users may
+     * implement this interface to drive CTip and CTipMedia objects
+     * from their own reactor, or use CTipEventScheduler.
+     */
+    class CTipScheduler {
+    public:
+        CTipScheduler() {}
+        virtual ~CTipScheduler() {}
+
+        /**
+         * Schedule an object.  Invoked whenever the time at which the
+         * object next needs DoPeriodicActivity() changes.  Replaces
+         * any previous time for the same object.
+         *
+         * @param object the object to schedule
+         * @param msec when DoPeriodicActivity() should be called, in
+         * GetMsecTimestamp() time.  (uint64_t) -1 means never.
+         */
+        virtual void Schedule(CTipSchedulable& object, uint64_t msec) = 0;
+
+        /**
+         * Remove an object.  Invoked when the object is detached or
+         * destroyed.
+         *
+         * @param object the object to remove
+         */
+        virtual void Remove(CTipSchedulable& object) = 0;
+
+        /**
+         * Detach an object.  Invoked when the object is given a
+         * different scheduler or destroyed.  The default removes the
+         * object, implementations keeping other per object state
+         * should release it here.
+         *
+         * @param object the object being detached
+         */
+        virtual void Detach(CTipSchedulable& object) { Remove(object); }
+
+    protected:
+        // per object storage for use by implementations
+        static uint32_t& SchedIndex(CTipSchedulable& object) {
+            return object.mSchedIndex;
+        }
+        static uint64_t& SchedTime(CTipSchedulable& object) {
+            return object.mSchedTime;
+        }
+    };
+
+    /**
+     * Scheduler for many CTip and CTipMedia objects.  Objects are
+     * kept in order of their due time so waking up only costs
+     * anything for the objects that are due.  On Linux the scheduler
+     * provides a timer file descriptor that becomes readable when
+     * the earliest object is due, suitable for select(), poll() or
+     * epoll.  Elsewhere GetIdleTime() gives the time to wait.
+     */
+    class CTipEventScheduler : public CTipScheduler {
+    public:
+        /**
+         * Constructor.
+         *
+         * @param useFd false to skip the timer file descriptor, for
+         * owners that wait using GetIdleTime() and so would never
+         * poll it.  GetFd() then returns -1.
+         */
+        CTipEventScheduler(bool useFd = true);
+        virtual ~CTipEventScheduler();
+
+        virtual void Schedule(CTipSchedulable& object, uint64_t msec);
+        virtual void Remove(CTipSchedulable& object);
+
+        /**
+         * Get the timer file descriptor.  The descriptor becomes
+         * readable when DoPeriodicActivity() should be called.
+         *
+         * @return file descriptor or -1 if not supported
+         */
+        int GetFd() const { return mFd; }
+
+        /**
+         * Get the idle time until the earliest object is due.
+         *
+         * @return idle time in milliseconds, (uint64_t) -1 means
+         * nothing is scheduled
+         */
+        uint64_t GetIdleTime() const;
+
+        /**
+         * Call DoPeriodicActivity() on every object that is due.
+         * Objects are expected to reschedule themselves from within
+         * DoPeriodicActivity().  An object must not destroy another
+         * object from within its DoPeriodicActivity().
+         *
+         * @return the number of objects run
+         */
+        uint32_t DoPeriodicActivity();
+
+        /**
+         * Get the number of objects with a pending due time.
+         *
+         * @return number of scheduled objects
+         */
+        uint32_t GetNumScheduled() const { return mHeap.size(); }
+
+    protected:
+        bool Before(uint32_t a, uint32_t b) const;
+        void Swap(uint32_t a, uint32_t b);
+        void SiftUp(uint32_t pos);
+        void SiftDown(uint32_t pos);
+        void RemoveAt(uint32_t pos);
+        void Arm();
+
+        // min-heap of objects ordered by due time
+        std::vector<CTipSchedulable*> mHeap;
+
+        // objects being run by DoPeriodicActivity()
+        std::vector<CTipSchedulable*> mDue;
+
+        int      mFd;
+        uint64_t mArmedTime;
+        bool     mRunning;
+
+    private:
+        // do not allow copy or assignment
+        CTipEventScheduler(const CTipEventScheduler&);
+        CTipEventScheduler& operator=(const CTipEventScheduler&);
+    };
+};
+
+#endif
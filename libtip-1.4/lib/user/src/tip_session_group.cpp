@@ -0,0 +1,178 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "rtcp_packet_view.h"
+#include "tip_debug_print.h"
+#include "tip_session_group.h"
+using namespace LibTip;
+
+CTipSessionGroup::CTipSessionGroup(bool useFd) :
+    CTipEventScheduler(useFd)
+{
+
+}
+
+CTipSessionGroup::~CTipSessionGroup()
+{
+    // detach any sessions left behind so they do not reference us
+    while (! mSessions.empty()) {
+        mSessions.begin()->first->SetScheduler(NULL);
+    }
+}
+
+void CTipSessionGroup::Detach(CTipSchedulable& object)
+{
+    CTipEventScheduler::Remove(object);
+
+    SessionMap::iterator it = mSessions.find(&object);
+    if (it == mSessions.end()) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < it->second.size(); i++) {
+        mSSRCs.erase(it->second[i]);
+    }
+    mSessions.erase(it);
+}
+
+Status CTipSessionGroup::AddSession(CTip& tip)
+{
+    if (tip.GetScheduler() != NULL) {
+        AMDEBUG(USER, ("session %p already has a scheduler", &tip));
+        return TIP_ERROR;
+    }
+
+    mSessions[&tip];
+    tip.SetScheduler(this);
+    
+    return TIP_OK;
+}
+
+Status CTipSessionGroup::RemoveSession(CTip& tip)
+{
+    if (mSessions.find(&tip) == mSessions.end()) {
+        AMDEBUG(USER, ("session %p is not part of this group", &tip));
+        return TIP_ERROR;
+    }
+
+    // releases the SSRC bindings through Detach()
+    tip.SetScheduler(NULL);
+    return TIP_OK;
+}
+
+Status CTipSessionGroup::BindSSRC(CTip& tip, uint32_t ssrc)
+{
+    SessionMap::iterator sit = mSessions.find(&tip);
+    if (sit == mSessions.end()) {
+        AMDEBUG(USER, ("session %p is not part of this group", &tip));
+        return TIP_ERROR;
+    }
+
+    SSRCMap::iterator it = mSSRCs.find(ssrc);
+    if (it != mSSRCs.end()) {
+        if (it->second == &tip) {
+            return TIP_OK;
+        }
+
+        AMDEBUG(USER, ("SSRC 0x%08x is already bound to session %p",
+                       ssrc, it->second));
+        return TIP_ERROR;
+    }
+
+    mSSRCs[ssrc] = &tip;
+    sit->second.push_back(ssrc);
+    
+    return TIP_OK;
+}
+
+Status CTipSessionGroup::UnbindSSRC(uint32_t ssrc)
+{
+    SSRCMap::iterator it = mSSRCs.find(ssrc);
+    if (it == mSSRCs.end()) {
+        return TIP_ERROR;
+    }
+
+    SSRCList& list = mSessions[it->second];
+    list.erase(std::find(list.begin(), list.end(), ssrc));
+    mSSRCs.erase(it);
+
+    return TIP_OK;
+}
+
+CTip* CTipSessionGroup::FindSession(uint32_t ssrc) const
+{
+    SSRCMap::const_iterator it = mSSRCs.find(ssrc);
+    if (it == mSSRCs.end()) {
+        return NULL;
+    }
+
+    return it->second;
+}
+
+Status CTipSessionGroup::ReceivePacket(uint8_t* buffer, uint32_t size, MediaType mType)
+{
+    uint32_t ssrc;
+    if (GetPacketSSRC(buffer, size, ssrc) != 0) {
+        return TIP_ERROR;
+    }
+
+    CTip* tip = FindSession(ssrc);
+    if (tip == NULL) {
+        AMDEBUG(RECV, ("no session for SSRC 0x%08x", ssrc));
+        return TIP_ERROR;
+    }
+
+    return tip->ReceivePacket(buffer, size, mType);
+}
+
+Status CTipSessionGroup::ReceivePacket(CTip& tip, uint8_t* buffer, uint32_t size,
+                                       MediaType mType)
+{
+    // the SSRC could not be bound to a session outside the group so
+    // later packets would not be dispatched
+    if (mSessions.find(&tip) == mSessions.end()) {
+        AMDEBUG(USER, ("session %p is not part of this group", &tip));
+        return TIP_ERROR;
+    }
+    
+    Status ret = tip.ReceivePacket(buffer, size, mType);
+    if (ret != TIP_OK) {
+        return ret;
+    }
+
+    uint32_t ssrc;
+    if (GetPacketSSRC(buffer, size, ssrc) == 0 && FindSession(ssrc) == NULL) {
+        return BindSSRC(tip, ssrc);
+    }
+
+    return TIP_OK;
+}
+
+int CTipSessionGroup::GetPacketSSRC(uint8_t* buffer, uint32_t size, uint32_t& ssrc)
+{
+    CRtcpPacketView view(buffer, size);
+
+    // every RTCP packet type TIP uses carries the sender SSRC
+    // immediately after the common header
+    if (! view.IsValid() || view.GetSize() < 8) {
+        return -1;
+    }
+
+    ssrc = view.GetSSRC();
+    return 0;
+}
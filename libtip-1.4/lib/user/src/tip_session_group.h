@@ -0,0 +1,160 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIP_SESSION_GROUP_H
+#define TIP_SESSION_GROUP_H
+
+#include <map>
+#include <vector>
+
+#include "tip_constants.h"
+#include "tip.h"
+#include "tip_scheduler.h"
+
+namespace LibTip {
+
+    /**
+     * Group of CTip sessions sharing one scheduler, for hosts such as
+     * MCUs that run many sessions at once.  Sessions added to the
+     * group are driven through the group's GetFd(), GetIdleTime()
+     * and DoPeriodicActivity(), which only touch the sessions that
+     * have work due.  Received packets may be handed to the group
+     * which dispatches them to the right session using the RTCP SSRC
+     * of the remote peer.
+     *
+     * The group does not own the sessions.  A session destroyed
+     * while part of the group is removed from it automatically.
+     */
+    class CTipSessionGroup : public CTipEventScheduler {
+    public:
+        /**
+         * Constructor.
+         *
+         * @param useFd false to skip the timer file descriptor
+         * @see CTipEventScheduler::CTipEventScheduler
+         */
+        CTipSessionGroup(bool useFd = true);
+        virtual ~CTipSessionGroup();
+
+        virtual void Detach(CTipSchedulable& object);
+
+        /**
+         * Add a session to the group.  The group becomes the
+         * session's scheduler.
+         *
+         * @param tip the session to add
+         * @return TIP_OK if added, TIP_ERROR if the session already
+         * has a scheduler
+         */
+        Status AddSession(CTip& tip);
+
+        /**
+         * Remove a session from the group.  Any SSRCs bound to the
+         * session are released.
+         *
+         * @param tip the session to remove
+         * @return TIP_OK if removed, TIP_ERROR if the session is not
+         * part of this group
+         */
+        Status RemoveSession(CTip& tip);
+
+        /**
+         * Bind a remote RTCP SSRC to a session.  Packets received
+         * from this SSRC will be dispatched to the session.  A
+         * session may have several SSRCs bound, typically one per
+         * media type.
+         *
+         * @param tip the session to bind to
+         * @param ssrc the RTCP SSRC used by the remote peer
+         * @return TIP_OK if bound, TIP_ERROR if the session is not
+         * part of this group or the SSRC is bound to another session
+         */
+        Status BindSSRC(CTip& tip, uint32_t ssrc);
+
+        /**
+         * Release a remote RTCP SSRC binding.
+         *
+         * @param ssrc the RTCP SSRC to release
+         * @return TIP_OK if released, TIP_ERROR if it was not bound
+         */
+        Status UnbindSSRC(uint32_t ssrc);
+
+        /**
+         * Find the session a remote RTCP SSRC is bound to.
+         *
+         * @param ssrc the RTCP SSRC to look up
+         * @return the session or NULL if the SSRC is not bound
+         */
+        CTip* FindSession(uint32_t ssrc) const;
+
+        /**
+         * Process a received packet.  The packet is dispatched to
+         * the session bound to the SSRC of its first RTCP packet.
+         *
+         * @param buffer pointer to the packet received
+         * @param size length of the received packet
+         * @param mType the type of media associated with the packet
+         * @return TIP_OK if the packet was processed, otherwise
+         * TIP_ERROR
+         * @see CTip::ReceivePacket
+         */
+        Status ReceivePacket(uint8_t* buffer, uint32_t size, MediaType mType);
+
+        /**
+         * Process a received packet for a known session.  Used
+         * before the remote SSRC is known, for example when packets
+         * are demultiplexed by transport address.  If the packet is
+         * processed its SSRC is bound to the session so later
+         * packets can be dispatched with ReceivePacket() above.
+         * The session must have been added to this group, otherwise
+         * the packet is not processed.
+         *
+         * @param tip the session the packet was received for
+         * @param buffer pointer to the packet received
+         * @param size length of the received packet
+         * @param mType the type of media associated with the packet
+         * @return TIP_OK if the packet was processed, otherwise
+         * TIP_ERROR
+         */
+        Status ReceivePacket(CTip& tip, uint8_t* buffer, uint32_t size,
+                             MediaType mType);
+
+        /**
+         * Get the number of sessions in the group.
+         *
+         * @return number of sessions
+         */
+        uint32_t GetNumSessions() const { return mSessions.size(); }
+
+    protected:
+        // get the SSRC of the first RTCP packet in a buffer
+        static int GetPacketSSRC(uint8_t* buffer, uint32_t size, uint32_t& ssrc);
+
+        typedef std::vector<uint32_t> SSRCList;
+        typedef std::map<CTipSchedulable*, SSRCList> SessionMap;
+        typedef std::map<uint32_t, CTip*> SSRCMap;
+
+        SessionMap mSessions;
+        SSRCMap    mSSRCs;
+        
+    private:
+        // do not allow copy or assignment
+        CTipSessionGroup(const CTipSessionGroup&);
+        CTipSessionGroup& operator=(const CTipSessionGroup&);
+    };
+};
+
+#endif
@@ -0,0 +1,313 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <new>
+
+#include "tip_debug_print.h"
+#include "tip_time.h"
+#include "tip_sharded_host.h"
+using namespace LibTip;
+
+// task adding a session to the shard's group
+class CAddSessionTask : public CTipShardTask {
+public:
+    CAddSessionTask(CTip& tip, CTipShardAddCallback* callback) :
+        mTip(tip), mpCallback(callback) {}
+
+    virtual void Run(CTipSessionGroup& group) {
+        Status result = group.AddSession(mTip);
+        if (result != TIP_OK) {
+            AMDEBUG(USER, ("could not add session %p to its shard", &mTip));
+        }
+
+        if (mpCallback != NULL) {
+            mpCallback->SessionAdded(mTip, result);
+        }
+    }
+
+private:
+    CTip&                 mTip;
+    CTipShardAddCallback* mpCallback;
+};
+
+CTipShardedHost::CTipShardedHost(uint32_t numShards) :
+    mRunning(false)
+{
+    if (numShards == 0) {
+        numShards = 1;
+    }
+    
+    for (uint32_t i = 0; i < numShards; i++) {
+        Shard* shard = new Shard();
+        shard->mpHost    = this;
+        shard->mpQueue   = NULL;
+        shard->mSleeping = 0;
+        shard->mStop     = 0;
+
+        // Start() refuses to run a shard that has no way to be woken
+        if (pipe(shard->mWakeFd) != 0) {
+            AMDEBUG(INTERR, ("could not create wakeup pipe for shard %u", i));
+            shard->mWakeFd[0] = -1;
+            shard->mWakeFd[1] = -1;
+        } else {
+            fcntl(shard->mWakeFd[0], F_SETFL, O_NONBLOCK);
+            fcntl(shard->mWakeFd[1], F_SETFL, O_NONBLOCK);
+        }
+
+        mShards.push_back(shard);
+    }
+}
+
+CTipShardedHost::~CTipShardedHost()
+{
+    Stop();
+
+    for (uint32_t i = 0; i < mShards.size(); i++) {
+        Shard* shard = mShards[i];
+
+        Item* item = shard->mpQueue;
+        while (item != NULL) {
+            Item* next = item->mpNext;
+            delete item->mpTask;
+            FreeItem(item);
+            item = next;
+        }
+
+        if (shard->mWakeFd[0] >= 0) {
+            close(shard->mWakeFd[0]);
+            close(shard->mWakeFd[1]);
+        }
+        
+        delete shard;
+    }
+}
+
+Status CTipShardedHost::Start()
+{
+    if (mRunning) {
+        return TIP_ERROR;
+    }
+
+    // a shard without a wakeup pipe could sleep forever
+    for (uint32_t i = 0; i < mShards.size(); i++) {
+        if (mShards[i]->mWakeFd[0] < 0) {
+            AMDEBUG(INTERR, ("shard %u has no wakeup pipe", i));
+            return TIP_ERROR;
+        }
+    }
+    
+    for (uint32_t i = 0; i < mShards.size(); i++) {
+        mShards[i]->mStop = 0;
+        
+        if (pthread_create(&mShards[i]->mThread, NULL, &ThreadMain, mShards[i]) != 0) {
+            AMDEBUG(INTERR, ("could not create thread for shard %u", i));
+
+            // take down the shards already started
+            for (uint32_t j = 0; j < i; j++) {
+                __atomic_store_n(&mShards[j]->mStop, 1, __ATOMIC_SEQ_CST);
+                if (write(mShards[j]->mWakeFd[1], "x", 1) < 0) {
+                    // pipe is full, the shard is awake anyway
+                }
+                pthread_join(mShards[j]->mThread, NULL);
+            }
+            return TIP_ERROR;
+        }
+    }
+
+    mRunning = true;
+    return TIP_OK;
+}
+
+void CTipShardedHost::Stop()
+{
+    if (! mRunning) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < mShards.size(); i++) {
+        __atomic_store_n(&mShards[i]->mStop, 1, __ATOMIC_SEQ_CST);
+        if (write(mShards[i]->mWakeFd[1], "x", 1) < 0) {
+            // pipe is full, the shard is awake anyway
+        }
+    }
+
+    for (uint32_t i = 0; i < mShards.size(); i++) {
+        pthread_join(mShards[i]->mThread, NULL);
+    }
+
+    mRunning = false;
+}
+
+Status CTipShardedHost::Post(uint32_t shard, CTipShardTask* task)
+{
+    if (shard >= mShards.size() || task == NULL) {
+        AMDEBUG(USER, ("invalid shard %u", shard));
+        return TIP_ERROR;
+    }
+
+    Item* item = new (operator new(sizeof(Item))) Item();
+    item->mpTask = task;
+    item->mType  = VIDEO;
+    item->mSize  = 0;
+
+    Push(*mShards[shard], item);
+    return TIP_OK;
+}
+
+Status CTipShardedHost::AddSession(uint32_t shard, CTip& tip,
+                                   CTipShardAddCallback* callback)
+{
+    if (shard >= mShards.size()) {
+        AMDEBUG(USER, ("invalid shard %u", shard));
+        return TIP_ERROR;
+    }
+
+    return Post(shard, new CAddSessionTask(tip, callback));
+}
+
+Status CTipShardedHost::ReceivePacket(uint32_t shard, const uint8_t* buffer,
+                                      uint32_t size, MediaType mType)
+{
+    if (shard >= mShards.size() || buffer == NULL) {
+        AMDEBUG(USER, ("invalid shard %u", shard));
+        return TIP_ERROR;
+    }
+
+    // the packet is stored right after the item
+    Item* item = new (operator new(sizeof(Item) + size)) Item();
+    item->mpTask = NULL;
+    item->mType  = mType;
+    item->mSize  = size;
+    memcpy(item->GetData(), buffer, size);
+
+    Push(*mShards[shard], item);
+    return TIP_OK;
+}
+
+void* CTipShardedHost::ThreadMain(void* arg)
+{
+    Shard* shard = static_cast<Shard*>(arg);
+    shard->mpHost->Run(*shard);
+    return NULL;
+}
+
+void CTipShardedHost::Run(Shard& shard)
+{
+    while (true) {
+        Drain(shard);
+        shard.mGroup.DoPeriodicActivity();
+
+        if (__atomic_load_n(&shard.mStop, __ATOMIC_SEQ_CST)) {
+            // finish anything queued before we were stopped
+            if (Drain(shard) == 0) {
+                break;
+            }
+            continue;
+        }
+
+        // tell producers we are about to sleep, then look once more
+        // so an item pushed in between is not missed
+        __atomic_store_n(&shard.mSleeping, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&shard.mpQueue, __ATOMIC_SEQ_CST) != NULL ||
+            __atomic_load_n(&shard.mStop, __ATOMIC_SEQ_CST)) {
+            __atomic_store_n(&shard.mSleeping, 0, __ATOMIC_SEQ_CST);
+            continue;
+        }
+
+        uint64_t idle = shard.mGroup.GetIdleTime();
+        int timeout = -1;
+        if (idle != (uint64_t) -1) {
+            timeout = (idle > INT_MAX ? INT_MAX : (int) idle);
+        }
+
+        struct pollfd pfd;
+        pfd.fd      = shard.mWakeFd[0];
+        pfd.events  = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, timeout) < 0) {
+            // interrupted, just go around again
+        }
+
+        __atomic_store_n(&shard.mSleeping, 0, __ATOMIC_SEQ_CST);
+
+        char buffer[64];
+        while (read(shard.mWakeFd[0], buffer, sizeof(buffer)) > 0) {
+            // empty the pipe
+        }
+    }
+}
+
+void CTipShardedHost::Push(Shard& shard, Item* item)
+{
+    Item* head = __atomic_load_n(&shard.mpQueue, __ATOMIC_RELAXED);
+    do {
+        item->mpNext = head;
+    } while (! __atomic_compare_exchange_n(&shard.mpQueue, &head, item, true,
+                                           __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+    // only pay for the wakeup if the shard is waiting
+    if (__atomic_exchange_n(&shard.mSleeping, 0, __ATOMIC_SEQ_CST) != 0) {
+        if (write(shard.mWakeFd[1], "x", 1) < 0) {
+            // pipe is full, the shard will wake up anyway
+        }
+    }
+}
+
+uint32_t CTipShardedHost::Drain(Shard& shard)
+{
+    // take everything queued so far, producers push newest first so
+    // reverse the list to run items in the order they were queued
+    Item* list = __atomic_exchange_n(&shard.mpQueue, (Item*) NULL, __ATOMIC_ACQUIRE);
+    Item* ordered = NULL;
+    while (list != NULL) {
+        Item* next = list->mpNext;
+        list->mpNext = ordered;
+        ordered = list;
+        list = next;
+    }
+
+    CTipTimeCache now;
+    uint32_t count = 0;
+
+    while (ordered != NULL) {
+        Item* item = ordered;
+        ordered = item->mpNext;
+
+        if (item->mpTask != NULL) {
+            item->mpTask->Run(shard.mGroup);
+            delete item->mpTask;
+        } else {
+            shard.mGroup.ReceivePacket(item->GetData(), item->mSize, item->mType);
+        }
+
+        FreeItem(item);
+        count++;
+    }
+
+    return count;
+}
+
+void CTipShardedHost::FreeItem(Item* item)
+{
+    item->~Item();
+    operator delete(item);
+}
@@ -0,0 +1,230 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIP_SHARDED_HOST_H
+#define TIP_SHARDED_HOST_H
+
+#include <pthread.h>
+#include <vector>
+
+#include "tip_constants.h"
+#include "tip.h"
+#include "tip_session_group.h"
+
+namespace LibTip {
+
+    /**
+     * Work handed to a shard.  Tasks are run on the shard's thread
+     * and deleted afterwards.
+     */
+    class CTipShardTask {
+    public:
+        virtual ~CTipShardTask() {}
+
+        /**
+         * Run the task.
+         *
+         * @param group the session group of the shard running the
+         * task
+         */
+        virtual void Run(CTipSessionGroup& group) = 0;
+    };
+
+    /**
+     * Notification of the outcome of CTipShardedHost::AddSession(),
+     * invoked on the shard's thread once the session has been added
+     * to the shard's group or refused by it.
+     */
+    class CTipShardAddCallback {
+    public:
+        virtual ~CTipShardAddCallback() {}
+
+        /**
+         * Called when the add has been processed.
+         *
+         * @param tip the session being added
+         * @param result TIP_OK if the session was added, TIP_ERROR if
+         * the group refused it (for instance because the session
+         * already has a scheduler)
+         * @see CTipSessionGroup::AddSession
+         */
+        virtual void SessionAdded(CTip& tip, Status result) = 0;
+    };
+
+    /**
+     * Host running CTip sessions on several threads.
+     *
+     * CTip and CTipMedia are not thread safe, but nothing is shared
+     * between instances other than read only globals (the debug
+     * settings, the clock set with SetClock() and the stateless
+     * negotiation state objects), so instances may run on different
+     * threads as long as each instance is only used by one thread.
+     * The host enforces this by pinning each session to a shard.
+     * Every shard owns a worker thread and a CTipSessionGroup which
+     * does the shard's timer handling.
+     *
+     * Once a session is added to a shard it must only be used from
+     * that shard's thread, either from a CTipShardTask posted to the
+     * shard or from within the session's own callbacks.  Callbacks and
+     * CTipPacketTransmit::Transmit() are invoked on the shard thread.
+     * Received packets may be handed to a shard from any thread, they
+     * are queued and dispatched by SSRC on the shard thread.
+     *
+     * Queues between threads are lock free.  Debug output from all
+     * shards is serialized per log statement.
+     */
+    class CTipShardedHost {
+    public:
+        /**
+         * Constructor.
+         *
+         * @param numShards number of shards, typically one per core
+         */
+        CTipShardedHost(uint32_t numShards);
+
+        /**
+         * Destructor, stops the shards.  Tasks and packets still
+         * queued are dropped.
+         */
+        ~CTipShardedHost();
+
+        /**
+         * Start the shard threads.
+         *
+         * @return TIP_OK if started, TIP_ERROR if already running, a
+         * shard's wakeup pipe could not be created when the host was
+         * constructed or a thread could not be created
+         */
+        Status Start();
+
+        /**
+         * Stop the shard threads.  Returns once every shard has
+         * finished the tasks and packets queued before the call.
+         */
+        void Stop();
+
+        /**
+         * Get the number of shards.
+         *
+         * @return number of shards
+         */
+        uint32_t GetNumShards() const { return mShards.size(); }
+
+        /**
+         * Get the shard for a session key, for hosts that spread
+         * sessions evenly by some key of their own.
+         *
+         * @param key the session key
+         * @return the shard index
+         */
+        uint32_t GetShard(uint32_t key) const { return (key % mShards.size()); }
+
+        /**
+         * Run a task on a shard.  Tasks posted to the same shard are
+         * run in the order they were posted.  May be called from any
+         * thread.
+         *
+         * @param shard the shard index
+         * @param task the task to run, deleted after it has run
+         * @return TIP_OK if queued, TIP_ERROR if the shard is invalid
+         */
+        Status Post(uint32_t shard, CTipShardTask* task);
+
+        /**
+         * Add a session to a shard.  After this call the session must
+         * only be used from the shard's thread.  May be called from
+         * any thread.
+         *
+         * The session is added on the shard thread, so the returned
+         * Status only says whether the add was queued.  Pass a
+         * callback to learn whether the shard's group accepted the
+         * session.
+         *
+         * @param shard the shard index
+         * @param tip the session to add
+         * @param callback optional callback told the outcome on the
+         * shard thread, not owned by the host and must remain valid
+         * until invoked
+         * @return TIP_OK if queued, TIP_ERROR if the shard is invalid
+         */
+        Status AddSession(uint32_t shard, CTip& tip,
+                          CTipShardAddCallback* callback = NULL);
+
+        /**
+         * Hand a received packet to a shard.  The packet is copied
+         * and dispatched to the session bound to its SSRC on the
+         * shard thread.  May be called from any thread.
+         *
+         * @param shard the shard index
+         * @param buffer pointer to the packet received
+         * @param size length of the received packet
+         * @param mType the type of media associated with the packet
+         * @return TIP_OK if queued, TIP_ERROR if the shard is invalid
+         * @see CTipSessionGroup::ReceivePacket
+         */
+        Status ReceivePacket(uint32_t shard, const uint8_t* buffer, uint32_t size,
+                             MediaType mType);
+
+    protected:
+        // queued work, either a task or a packet stored after the item
+        struct Item {
+            Item*          mpNext;
+            CTipShardTask* mpTask;
+            MediaType      mType;
+            uint32_t       mSize;
+
+            uint8_t* GetData() { return reinterpret_cast<uint8_t*>(this + 1); }
+        };
+
+        struct Shard {
+            // shards sleep for GetIdleTime(), so the group's timer
+            // fd would never be polled
+            Shard() : mGroup(false) {}
+
+            CTipShardedHost* mpHost;
+            CTipSessionGroup mGroup;
+            pthread_t        mThread;
+
+            // items pushed by any thread, newest first.  these
+            // fields are only accessed with atomic builtins.
+            Item*            mpQueue;
+
+            // set while the shard waits for work
+            int              mSleeping;
+            int              mStop;
+
+            // wakeup pipe, written when work arrives for a sleeping
+            // shard
+            int              mWakeFd[2];
+        };
+
+        static void* ThreadMain(void* arg);
+        void Run(Shard& shard);
+        void Push(Shard& shard, Item* item);
+        uint32_t Drain(Shard& shard);
+        static void FreeItem(Item* item);
+
+        std::vector<Shard*> mShards;
+        bool                mRunning;
+
+    private:
+        // do not allow copy or assignment
+        CTipShardedHost(const CTipShardedHost&);
+        CTipShardedHost& operator=(const CTipShardedHost&);
+    };
+};
+
+#endif
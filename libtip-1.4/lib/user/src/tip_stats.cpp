@@ -0,0 +1,93 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tip_stats.h"
+using namespace LibTip;
+
+// the session is the only writer so an update is a plain load and
+// store, atomic only so readers never see a torn value
+static inline void IncrementRelaxed(uint64_t& field)
+{
+    __atomic_store_n(&field, (field + 1), __ATOMIC_RELAXED);
+}
+
+static inline void CopyRelaxed(uint64_t* dst, const uint64_t* src, uint32_t num)
+{
+    for (uint32_t i = 0; i < num; i++) {
+        __atomic_store_n(&dst[i], __atomic_load_n(&src[i], __ATOMIC_RELAXED),
+                         __ATOMIC_RELAXED);
+    }
+}
+
+CTipStats::CTipStats()
+{
+    for (uint32_t i = 0; i < MAX_COUNTER; i++) {
+        mCounters[i] = 0;
+    }
+    
+    for (uint32_t i = 0; i < MAX_PACKET_TYPE; i++) {
+        mReceived[i] = 0;
+    }
+}
+
+CTipStats::CTipStats(const CTipStats& other)
+{
+    *this = other;
+}
+
+CTipStats& CTipStats::operator=(const CTipStats& other)
+{
+    if (this == &other) {
+        return *this;
+    }
+    
+    CopyRelaxed(mCounters, other.mCounters, MAX_COUNTER);
+    CopyRelaxed(mReceived, other.mReceived, MAX_PACKET_TYPE);
+    mAckLatency = other.mAckLatency;
+
+    return *this;
+}
+
+uint64_t CTipStats::GetCounter(Counter counter) const
+{
+    if (counter >= MAX_COUNTER) {
+        return 0;
+    }
+
+    return __atomic_load_n(&mCounters[counter], __ATOMIC_RELAXED);
+}
+
+uint64_t CTipStats::GetNumReceived(TipPacketType pType) const
+{
+    if (pType >= MAX_PACKET_TYPE) {
+        return 0;
+    }
+
+    return __atomic_load_n(&mReceived[pType], __ATOMIC_RELAXED);
+}
+
+void CTipStats::Increment(Counter counter)
+{
+    if (counter < MAX_COUNTER) {
+        IncrementRelaxed(mCounters[counter]);
+    }
+}
+
+void CTipStats::IncrementReceived(TipPacketType pType)
+{
+    if (pType < MAX_PACKET_TYPE) {
+        IncrementRelaxed(mReceived[pType]);
+    }
+}
@@ -0,0 +1,102 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TIP_STATS_H
+#define TIP_STATS_H
+
+#include "tip_histogram.h"
+#include "rtcp_tip_types.h"
+
+namespace LibTip {
+
+    /**
+     * Counters and the ACK latency histogram for one Tip session,
+     * either one media type of a CTip or a CTipMedia.  The time taken
+     * by negotiation is kept separately by CTip, see
+     * CTip::GetNegotiationTime().
+     *
+     * The session updates its statistics from the thread driving it
+     * and copies them out with CTip::GetStats() or
+     * CTipMedia::GetStats().  Every value is written and read with
+     * relaxed atomic operations so the copy may be taken from any
+     * thread at any time without locking and without blocking the
+     * session.  A copy taken while the session is running may be one
+     * update behind on some values but never contains a torn value.
+     */
+    class CTipStats {
+    public:
+        /**
+         * Counters kept in addition to the per type receive counts.
+         */
+        enum Counter {
+            RX_DUPLICATE,   /**< duplicates of packets already received */
+            RX_DROP,        /**< old packets dropped without an ACK */
+            RX_PARSE_ERROR, /**< Tip and feedback packets that could not be parsed */
+            RX_FEEDBACK,    /**< RTCP feedback packets received (CTipMedia only) */
+            TX_FIRST,       /**< packets transmitted for the first time */
+            TX_RETRANSMIT,  /**< retransmissions of unacknowledged packets */
+            TX_EXPIRED,     /**< packets that were never acknowledged */
+            MAX_COUNTER
+        };
+
+        CTipStats();
+
+        /**
+         * Copies use relaxed atomic loads so the source may be
+         * updated while it is copied.
+         */
+        CTipStats(const CTipStats& other);
+        CTipStats& operator=(const CTipStats& other);
+
+        /**
+         * Get a counter.
+         *
+         * @param counter the counter to get
+         * @return number of events counted, 0 for invalid counters
+         */
+        uint64_t GetCounter(Counter counter) const;
+
+        /**
+         * Get the number of packets of one type that were received
+         * and parsed, including ACKs, duplicates and dropped packets.
+         *
+         * @param pType the packet type
+         * @return number of packets received
+         */
+        uint64_t GetNumReceived(TipPacketType pType) const;
+
+        /**
+         * Histogram of the time in milliseconds from the first
+         * transmission of a packet until its ACK arrived, including
+         * any retransmissions.
+         */
+        const CTipHistogram& GetAckLatency() const { return mAckLatency; }
+
+        /**
+         * Update functions, only to be called by the session that
+         * owns the statistics.
+         */
+        void Increment(Counter counter);
+        void IncrementReceived(TipPacketType pType);
+        void AddAckLatency(uint32_t latencyMS) { mAckLatency.Add(latencyMS); }
+
+    protected:
+        uint64_t      mCounters[MAX_COUNTER];
+        uint64_t      mReceived[MAX_PACKET_TYPE];
+        CTipHistogram mAckLatency;
+    };
+};
+
+#endif
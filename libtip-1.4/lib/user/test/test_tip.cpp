@@ -15,6 +15,7 @@
  */
 
 #include <iostream>
+#include <sstream>
 using namespace std;
 
 #include "tip_debug_print.h"
@@ -3753,6 +3754,164 @@ public:
         CPPUNIT_ASSERT( ack->GetRcvNtpTime() >= packet.GetNtpTime() );
     }
     
+    void testEchoRoundTrip() {
+        CPacketBufferData buffer;
+
+        CPPUNIT_ASSERT_EQUAL( am->GetRoundTripTime(VIDEO), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( am->SendEcho(MT_MAX), TIP_ERROR );
+        CPPUNIT_ASSERT_EQUAL( am->SendEcho(VIDEO), TIP_OK );
+        am->DoPeriodicActivity();
+
+        // the test transmitter files our ECHO with the ECHO replies
+        CPPUNIT_ASSERT( xmit->rxACKECHO != NULL );
+        CRtcpTipPacket* reply = CRtcpPacketFactory::CreateAckPacket(*xmit->rxACKECHO);
+        CPPUNIT_ASSERT( reply != NULL );
+        reply->Pack(buffer);
+        delete reply;
+
+        usleep(20000);
+        CPPUNIT_ASSERT_EQUAL( am->ReceivePacket(buffer.GetBuffer(), buffer.GetBufferSize(), VIDEO),
+                              TIP_OK );
+
+        // the reply acks our ECHO and gives a round trip time
+        CPPUNIT_ASSERT( am->GetRoundTripTime(VIDEO) >= 15 );
+        CPPUNIT_ASSERT_EQUAL( am->GetRoundTripTime(AUDIO), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( am->GetIdleTime(), (uint64_t) -1 );
+    }
+    
+    void testEchoPooled() {
+        // after the first few packets, receiving and acking should
+        // only use pooled packet memory
+        CRtcpPacketPool::Stats stats;
+        
+        for (uint32_t i = 0; i < 20; i++) {
+            if (i == 4) {
+                CRtcpPacketPool::ResetStats();
+            }
+            
+            CRtcpAppEchoPacket packet;
+            CPacketBufferData buffer;
+
+            packet.SetNtpTime(GetNtpTimestamp() + i);
+            packet.Pack(buffer);
+
+            CPPUNIT_ASSERT_EQUAL( am->ReceivePacket(buffer.GetBuffer(), buffer.GetBufferSize(), VIDEO),
+                                  TIP_OK );
+        }
+
+        CRtcpPacketPool::GetStats(stats);
+        CPPUNIT_ASSERT( stats.mAllocs != 0 );
+        CPPUNIT_ASSERT_EQUAL( stats.mHeapAllocs, (uint64_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( stats.mAllocs, stats.mFrees );
+    }
+    
+    void testStats() {
+        CTipStats stats;
+        CTipHistogram negTime;
+        CPacketBufferData buffer;
+
+        CPPUNIT_ASSERT_EQUAL( am->GetStats(MT_MAX, stats), TIP_ERROR );
+        CPPUNIT_ASSERT_EQUAL( am->GetNegotiationTime(MT_MAX, negTime), TIP_ERROR );
+
+        // both sides of a negotiation, our MUXCTRL and MEDIAOPTS are
+        // sent once and acked
+        doTipNeg(VIDEO);
+
+        // an ECHO, its duplicate and an older one
+        CRtcpAppEchoPacket echo;
+        echo.SetNtpTime(GetNtpTimestamp());
+        echo.Pack(buffer);
+        am->ReceivePacket(buffer.GetBuffer(), buffer.GetBufferSize(), VIDEO);
+        am->ReceivePacket(buffer.GetBuffer(), buffer.GetBufferSize(), VIDEO);
+
+        buffer.Reset();
+        echo.SetNtpTime(echo.GetNtpTime() - 1);
+        echo.Pack(buffer);
+        am->ReceivePacket(buffer.GetBuffer(), buffer.GetBufferSize(), VIDEO);
+
+        // a truncated TIP packet
+        uint8_t* data = buffer.GetBuffer();
+        data[2] = 0;
+        data[3] = 4;
+        am->ReceivePacket(data, 20, VIDEO);
+
+        // a compound packet cut short in its second packet
+        CRtcpRRPacket rr;
+        buffer.Reset();
+        rr.Pack(buffer);
+        echo.Pack(buffer);
+        am->ReceivePacket(buffer.GetBuffer(), (buffer.GetBufferSize() - 4), VIDEO);
+
+        // an ECHO of ours that is never acked
+        am->SetRetransmissionInterval(1);
+        am->SetRetransmissionLimit(2);
+        CPPUNIT_ASSERT_EQUAL( am->SendEcho(VIDEO), TIP_OK );
+        while (am->GetIdleTime() != (uint64_t) -1) {
+            usleep((am->GetIdleTime() * 1000));
+            am->DoPeriodicActivity();
+        }
+        
+        CPPUNIT_ASSERT_EQUAL( am->GetStats(VIDEO, stats), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( stats.GetNumReceived(MUXCTRL), (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetNumReceived(MEDIAOPTS), (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetNumReceived(ACK_MUXCTRL), (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetNumReceived(ACK_MEDIAOPTS), (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetNumReceived(TIPECHO), (uint64_t) 3 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::RX_DUPLICATE), (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::RX_DROP), (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::RX_PARSE_ERROR), (uint64_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::TX_FIRST), (uint64_t) 3 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::TX_RETRANSMIT), (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::TX_EXPIRED), (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetAckLatency().GetCount(), (uint64_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( am->GetNegotiationTime(VIDEO, negTime), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( negTime.GetCount(), (uint64_t) 1 );
+
+        // nothing happened on audio
+        CPPUNIT_ASSERT_EQUAL( am->GetStats(AUDIO, stats), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( stats.GetNumReceived(MUXCTRL), (uint64_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::TX_FIRST), (uint64_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( am->GetNegotiationTime(AUDIO, negTime), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( negTime.GetCount(), (uint64_t) 0 );
+    }
+    
+    void testNegotiationTrace() {
+        std::ostringstream out;
+
+        doTipNeg(VIDEO);
+        am->WriteNegotiationTrace(out, 3);
+        std::string json = out.str();
+
+        // local and remote state machines on their own tracks
+        CPPUNIT_ASSERT_EQUAL( json.find("{\"traceEvents\":["), (size_t) 0 );
+        CPPUNIT_ASSERT( json.find("\"args\":{\"name\":\"VIDEO local\"}") != std::string::npos );
+        CPPUNIT_ASSERT( json.find("\"args\":{\"name\":\"VIDEO remote\"}") != std::string::npos );
+        CPPUNIT_ASSERT( json.find("AUDIO") == std::string::npos );
+
+        // local side went MCTX, MOTX then DONE in that order
+        size_t mctx = json.find("{\"name\":\"MCTX\"");
+        size_t motx = json.find("{\"name\":\"MOTX\"");
+        size_t done = json.find("{\"name\":\"DONE\"");
+        CPPUNIT_ASSERT( mctx != std::string::npos );
+        CPPUNIT_ASSERT( motx != std::string::npos && motx > mctx );
+        CPPUNIT_ASSERT( done != std::string::npos && done > motx );
+        CPPUNIT_ASSERT( json.find("\"pid\":3,\"tid\":1}") != std::string::npos );
+        CPPUNIT_ASSERT( json.find("\"pid\":3,\"tid\":2}") != std::string::npos );
+
+        // only the events
+        out.str("");
+        am->WriteNegotiationTrace(out, 3, false);
+        CPPUNIT_ASSERT( out.str().find("traceEvents") == std::string::npos );
+        CPPUNIT_ASSERT( out.str().find("MCTX") != std::string::npos );
+        
+        // disabled
+        am->SetNegotiationTraceSize(0);
+        am->StopTipNegotiate(VIDEO);
+        out.str("");
+        am->WriteNegotiationTrace(out, 3, false);
+        CPPUNIT_ASSERT_EQUAL( out.str(), std::string("") );
+    }
+    
     CPPUNIT_TEST_SUITE( CTipTest );
     CPPUNIT_TEST( testCallback );
     CPPUNIT_TEST( testTipNegInvalid );
@@ -3889,6 +4048,10 @@ public:
     CPPUNIT_TEST( testOldPacketIgnored );
     CPPUNIT_TEST( testDupPacketAcked );
     CPPUNIT_TEST( testEcho );
+    CPPUNIT_TEST( testEchoPooled );
+    CPPUNIT_TEST( testEchoRoundTrip );
+    CPPUNIT_TEST( testStats );
+    CPPUNIT_TEST( testNegotiationTrace );
     CPPUNIT_TEST_SUITE_END();
 };
 
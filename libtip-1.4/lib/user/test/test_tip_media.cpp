@@ -14,7 +14,12 @@
  * limitations under the License.
  */
 
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <iostream>
+#include <vector>
 using namespace std;
 
 #include "tip_debug_print.h"
@@ -38,7 +43,8 @@ using namespace LibTip;
 class CTipMediaTestXmit : public CTipPacketTransmit {
 public:
     CTipMediaTestXmit() : rxREFRESH(NULL), rxACK_RXFLOWCTRL(NULL),
-                          rxACK_TXFLOWCTRL(NULL), rxACK_REFRESH(NULL), rxFB(NULL) {}
+                          rxACK_TXFLOWCTRL(NULL), rxACK_REFRESH(NULL), rxFB(NULL),
+                          txSegments(0) {}
 
     ~CTipMediaTestXmit() {
         delete rxREFRESH;
@@ -48,6 +54,11 @@ public:
         delete rxFB;
     }
     
+    virtual Status TransmitV(const struct iovec* iov, uint32_t iovcnt, MediaType mType) {
+        txSegments = iovcnt;
+        return CTipPacketTransmit::TransmitV(iov, iovcnt, mType);
+    }
+    
     virtual Status Transmit(const uint8_t* pktBuffer, uint32_t pktSize, MediaType mType) {
         CPacketBuffer buffer((uint8_t*) pktBuffer, pktSize);
         while (buffer.GetBufferSize()) {
@@ -119,6 +130,7 @@ public:
     CRtcpTipPacket* rxACK_TXFLOWCTRL;
     CRtcpTipPacket* rxACK_REFRESH;
     CRtcpAppFeedbackPacket* rxFB;
+    uint32_t txSegments;
 };
 
 // test callback interface classes, just remembers when functions are called
@@ -187,6 +199,120 @@ public:
     std::bitset<0x10000> mBitset;
 };
 
+// clock that only moves when told to
+class CTipMediaTestClock : public CTipClock {
+public:
+    CTipMediaTestClock() : mNow(1000) {}
+    virtual uint64_t GetMsec() { return mNow; }
+
+    uint64_t mNow;
+};
+
+// debug output function that counts packet dumps
+static uint32_t gNumDumps = 0;
+static char gLastSuppressed[128];
+
+static void CountDumps(const char* fmt, ...)
+{
+    char buffer[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buffer, sizeof(buffer), fmt, ap);
+    va_end(ap);
+
+    if (strstr(buffer, "packet dump:") != NULL) {
+        gNumDumps++;
+    } else if (strstr(buffer, "dumps suppressed") != NULL) {
+        snprintf(gLastSuppressed, sizeof(gLastSuppressed), "%s", buffer);
+    }
+}
+
+// records every ack/nack callback in order
+class CTipMediaSourceEventCallback : public CTipMediaSourceCallback {
+public:
+    CTipMediaSourceEventCallback() : mRanges(0) {}
+
+    virtual void ProcessAckNackRange(uint16_t first, uint64_t ackMask,
+                                     uint64_t nackMask) {
+        mRanges++;
+        CPPUNIT_ASSERT_EQUAL( (ackMask & nackMask), (uint64_t) 0 );
+        CTipMediaSourceCallback::ProcessAckNackRange(first, ackMask, nackMask);
+    }
+    virtual void ProcessNack(uint16_t seqno) {
+        mEvents.push_back(std::make_pair(seqno, false));
+    }
+    virtual void ProcessAck(uint16_t seqno) {
+        mEvents.push_back(std::make_pair(seqno, true));
+    }
+
+    uint32_t mRanges;
+    std::vector< std::pair<uint16_t, bool> > mEvents;
+};
+
+// one seqno at a time feedback processing, as CTipMediaSource used
+// to do it, used as a reference model
+class CTipMediaSourceModel {
+public:
+    CTipMediaSourceModel() : mHaveLastSeqNum(false), mLastSeqNum(0) {
+        mCallbackEnable.set();
+    }
+
+    void ProcessFBPacket(CRtcpAppExtendedFeedbackPacket& packet) {
+        if (mHaveLastSeqNum == false) {
+            mHaveLastSeqNum = true;
+            mLastSeqNum     = (packet.GetPacketID() - CRtcpAppFeedbackPacket::NUM_ACK_BITS);
+        }
+    
+        uint16_t new_bits = (packet.GetPacketID() - mLastSeqNum);
+        if (new_bits > 0x8000) {
+            return;
+        }
+
+        bool haveInvalidSeqNum = false;
+        uint16_t firstInvalidSeqNum = (packet.GetPacketID() + 1);
+    
+        for (uint16_t i = 0; i < new_bits; i++) {
+            uint16_t curSeqNum = (mLastSeqNum + i);
+            CRtcpAppFeedbackPacket::AckValue ack =
+                packet.GetPacketAckBySeqNum(curSeqNum);
+            CRtcpAppExtendedFeedbackPacket::AckValidValue valid =
+                packet.GetPacketAckValidBySeqNum(curSeqNum);
+
+            if (valid == CRtcpAppExtendedFeedbackPacket::APP_FB_INVALID) {
+                if (haveInvalidSeqNum == false) {
+                    firstInvalidSeqNum = curSeqNum;
+                    haveInvalidSeqNum = true;
+                }
+                continue;
+            }
+
+            if (ack == CRtcpAppFeedbackPacket::APP_FB_NACK) {
+                DoAckNackCallback(curSeqNum, false);
+            } else if (! haveInvalidSeqNum) {
+                DoAckNackCallback(curSeqNum, true);
+            }
+        }
+
+        if (! haveInvalidSeqNum) {
+            DoAckNackCallback(packet.GetPacketID(), true);
+        }
+        mLastSeqNum = firstInvalidSeqNum;
+    }
+
+    void DoAckNackCallback(uint16_t seqNum, bool isAck) {
+        if (mCallbackEnable[seqNum]) {
+            mEvents.push_back(std::make_pair(seqNum, isAck));
+            mCallbackEnable[seqNum] = 0;
+        }
+        mCallbackEnable[(uint16_t) (seqNum + 0x8000)] = 1;
+    }
+    
+    bool mHaveLastSeqNum;
+    uint16_t mLastSeqNum;
+    std::bitset<0x10000> mCallbackEnable;
+    std::vector< std::pair<uint16_t, bool> > mEvents;
+};
+
 class CTipMediaSinkTest : public CppUnit::TestFixture {
 public:
     CTipMediaTestXmit* xmit;
@@ -450,6 +576,7 @@ public:
     void testRegisterPacket1() {
         am->RegisterPacket(0, 1);
         CPPUNIT_ASSERT( xmit->rxFB != NULL );
+        CPPUNIT_ASSERT_EQUAL( xmit->txSegments, (uint32_t) 2 );
         CPPUNIT_ASSERT_EQUAL( xmit->rxFB->GetSSRC(), (uint32_t) 0x12345678 );
         CPPUNIT_ASSERT_EQUAL( xmit->rxFB->GetTarget(), (uint32_t) 0xABCDE011 );
         CPPUNIT_ASSERT_EQUAL( xmit->rxFB->GetPacketID(), (uint16_t) 0 );
@@ -551,6 +678,251 @@ public:
         doRegisterOOOBase(0xFFF0);
     }
 
+    void checkFeedback(uint16_t pid, const uint8_t* bytes) {
+        CPPUNIT_ASSERT( xmit->rxFB != NULL );
+        CPPUNIT_ASSERT_EQUAL( xmit->rxFB->GetPacketID(), pid );
+        if (memcmp(xmit->rxFB->GetPacketAcks(), bytes, CRtcpAppFeedbackPacket::NUM_ACK_BYTES) != 0) {
+            ostringstream oss;
+            
+            oss << "\nExpected:  " << HexDump(bytes, CRtcpAppFeedbackPacket::NUM_ACK_BYTES)
+                << "\nPacked:    " << HexDump(xmit->rxFB->GetPacketAcks(), CRtcpAppFeedbackPacket::NUM_ACK_BYTES);
+            CPPUNIT_FAIL(oss.str());
+        }
+    }
+    
+    void testRegisterJump() {
+        for (uint16_t i = 0; i <= CRtcpAppFeedbackPacket::NUM_ACK_BITS; i++) {
+            am->RegisterPacket(i, 0);
+        }
+
+        // a jump past the whole window NACKs everything
+        am->RegisterPacket(10000, 1);
+        checkFeedback(10000, zero_bytes);
+
+        // late packet still inside the window gets ACKed
+        uint8_t bytes[CRtcpAppFeedbackPacket::NUM_ACK_BYTES] = { 0 };
+        bytes[12] = (1 << 5);
+        bytes[13] = (1 << 7);
+        am->RegisterPacket(9990, 0);
+        am->RegisterPacket(10001, 1);
+        checkFeedback(10001, bytes);
+
+        // packets older than the window are ignored
+        am->RegisterPacket(5000, 1);
+        checkFeedback(10001, bytes);
+    }
+
+    void testRegisterDuplicate() {
+        for (uint16_t i = 0; i <= CRtcpAppFeedbackPacket::NUM_ACK_BITS; i++) {
+            am->RegisterPacket(i, 0);
+        }
+        am->RegisterPacket(CRtcpAppFeedbackPacket::NUM_ACK_BITS, 1);
+        checkFeedback(CRtcpAppFeedbackPacket::NUM_ACK_BITS, one_bytes);
+
+        // repeating the latest sequence number changes nothing
+        am->RegisterPacket(CRtcpAppFeedbackPacket::NUM_ACK_BITS, 1);
+        checkFeedback(CRtcpAppFeedbackPacket::NUM_ACK_BITS, one_bytes);
+    }
+
+    void testRegisterRetarget() {
+        uint8_t bytes[CRtcpAppFeedbackPacket::NUM_ACK_BYTES] = { 0 };
+
+        am->RegisterPacket(0, 1);
+        checkFeedback(0, bytes);
+        
+        am->RegisterPacket(1, 1);
+        bytes[13] = 0x80;
+        checkFeedback(1, bytes);
+        CPPUNIT_ASSERT_EQUAL( xmit->rxFB->GetTarget(), (uint32_t) 0xABCDE011 );
+
+        // feedback follows a new target
+        am->SetSourceCSRC(0x12121011);
+        am->RegisterPacket(2, 1);
+        bytes[13] = 0xC0;
+        checkFeedback(2, bytes);
+        CPPUNIT_ASSERT_EQUAL( xmit->rxFB->GetSSRC(), (uint32_t) 0x12345678 );
+        CPPUNIT_ASSERT_EQUAL( xmit->rxFB->GetTarget(), (uint32_t) 0x12121011 );
+    }
+
+    void testPacketDumpLimit() {
+        // nothing to limit if the dumps are compiled out
+        if (! AMDEBUG_COMPILED(XMIT)) {
+            return;
+        }
+        
+        CTipMediaTestClock clock;
+        DebugPrintfFunc oldFunc = gDebugPrintfFunc;
+        SetClock(&clock);
+        gDebugPrintfFunc = CountDumps;
+        gNumDumps = 0;
+        gLastSuppressed[0] = '\0';
+        
+        am->SetPacketDumpLimit(2, 1000);
+        for (uint16_t i = 0; i < 5; i++) {
+            am->RegisterPacket(i, 1);
+        }
+        uint32_t limited = gNumDumps;
+        
+        // next interval, the dropped dumps are reported
+        clock.mNow += 1000;
+        am->RegisterPacket(5, 1);
+        uint32_t next = gNumDumps;
+        std::string suppressed = gLastSuppressed;
+
+        // no dumps at all with the area off
+        uint32_t oldAreas = gDebugAreas;
+        gDebugAreas &= ~DEBUG_XMIT;
+        clock.mNow += 1000;
+        am->RegisterPacket(6, 1);
+        uint32_t off = gNumDumps;
+        gDebugAreas = oldAreas;
+
+        // no limit
+        am->SetPacketDumpLimit(0, 0);
+        for (uint16_t i = 7; i < 17; i++) {
+            am->RegisterPacket(i, 1);
+        }
+        uint32_t unlimited = gNumDumps;
+        
+        gDebugPrintfFunc = oldFunc;
+        SetClock(NULL);
+
+        CPPUNIT_ASSERT_EQUAL( limited, (uint32_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( next, (uint32_t) 3 );
+        CPPUNIT_ASSERT( suppressed.find(" 3 packet dumps suppressed") != std::string::npos );
+        CPPUNIT_ASSERT_EQUAL( off, (uint32_t) 3 );
+        CPPUNIT_ASSERT_EQUAL( unlimited, (uint32_t) 13 );
+    }
+
+    void testRegisterRandom() {
+        // compare against a straightforward model with one bit for
+        // every possible sequence number
+        std::vector<bool> model(65536, false);
+        uint16_t last = 0x1234;
+        unsigned int seed = 1;
+
+        model[last] = true;
+        am->RegisterPacket(last, 0);
+        
+        for (uint32_t n = 0; n < 20000; n++) {
+            uint32_t r = rand_r(&seed);
+            uint16_t seqno;
+            
+            switch (r % 16) {
+            case 0:
+                seqno = (last + (r % 5000));   // big jump forward
+                break;
+            case 1:
+            case 2:
+                seqno = (last - (r % 200));    // late packet
+                break;
+            case 3:
+                seqno = (last + 0x8000 + (r % 0x8000)); // far behind
+                break;
+            default:
+                seqno = (last + 1 + (r % 3));  // normal, some loss
+                break;
+            }
+
+            uint16_t diff = (seqno - last);
+            if (diff == 0) {
+                // duplicate of the latest, nothing skipped
+            } else if (diff <= 0x8000) {
+                for (uint16_t i = (last + 1); i != seqno; i++) {
+                    model[i] = false;
+                }
+                last = seqno;
+            }
+            model[seqno] = true;
+
+            bool eof = ((r % 7) == 0);
+            am->RegisterPacket(seqno, eof);
+            
+            if (eof) {
+                uint8_t bytes[CRtcpAppFeedbackPacket::NUM_ACK_BYTES] = { 0 };
+                for (uint16_t i = 0; i < CRtcpAppFeedbackPacket::NUM_ACK_BITS; i++) {
+                    if (model[(uint16_t) (last - CRtcpAppFeedbackPacket::NUM_ACK_BITS + i)]) {
+                        bytes[(i/8)] |= (1 << (i%8));
+                    }
+                }
+                checkFeedback(last, bytes);
+            }
+        }
+    }
+    
+    void testStats() {
+        CTipMediaTestClock clock;
+        CTipStats stats;
+        SetClock(&clock);
+
+        // first transmission, a retransmission and an ACK 280ms
+        // after the first one
+        CPPUNIT_ASSERT_EQUAL( am->RequestRefresh(false), TIP_OK );
+        am->DoPeriodicActivity();
+        clock.mNow += am->GetIdleTime();
+        am->DoPeriodicActivity();
+        clock.mNow += 30;
+        CRtcpTipAckPacket ack(*xmit->rxREFRESH);
+        feedPacket(ack);
+
+        // a new packet and a duplicate of it
+        CRtcpAppRXFlowCtrlPacket packet;
+        packet.SetNtpTime(1);
+        packet.SetSSRC(0x87654321);
+        packet.SetTarget(0xA5A5A011);
+        packet.SetOpcode(CRtcpAppRXFlowCtrlPacket::OPCODE_START);
+        feedPacket(packet);
+        feedPacket(packet);
+
+        // a truncated packet and an RR, only the first is an error
+        CPacketBufferData buffer;
+        packet.SetNtpTime(2);
+        packet.Pack(buffer);
+        uint8_t* data = buffer.GetBuffer();
+        data[2] = 0;
+        data[3] = 4;
+        am->ReceivePacket(data, 20);
+
+        CRtcpRRPacket rr;
+        feedPacket(rr);
+
+        // a compound packet cut short in its second packet
+        buffer.Reset();
+        rr.Pack(buffer);
+        packet.Pack(buffer);
+        am->ReceivePacket(buffer.GetBuffer(), (buffer.GetBufferSize() - 4));
+
+        // feedback is counted even though a sink ignores it
+        CRtcpAppFeedbackPacket fb;
+        feedPacket(fb);
+        
+        // a refresh that is never acked
+        am->SetRetransmissionLimit(1);
+        CPPUNIT_ASSERT_EQUAL( am->RequestRefresh(false), TIP_OK );
+        am->DoPeriodicActivity();
+        clock.mNow += am->GetIdleTime();
+        am->DoPeriodicActivity();
+        
+        SetClock(NULL);
+        am->GetStats(stats);
+
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::TX_FIRST), (uint64_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::TX_RETRANSMIT), (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::TX_EXPIRED), (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::RX_DUPLICATE), (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::RX_DROP), (uint64_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::RX_PARSE_ERROR), (uint64_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::RX_FEEDBACK), (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetCounter(CTipStats::MAX_COUNTER), (uint64_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetNumReceived(ACK_REFRESH), (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetNumReceived(RXFLOWCTRL), (uint64_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetNumReceived(REFRESH), (uint64_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetNumReceived(MAX_PACKET_TYPE), (uint64_t) 0 );
+
+        CPPUNIT_ASSERT_EQUAL( stats.GetAckLatency().GetCount(), (uint64_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( stats.GetAckLatency().GetMax(), (uint32_t) 280 );
+    }
+    
     void testLogPrefix() {
         CRtcpAppRXFlowCtrlPacket packet;
         packet.SetSSRC(0x87654321);
@@ -598,6 +970,12 @@ public:
     CPPUNIT_TEST( testRegisterOOO1 );
     CPPUNIT_TEST( testRegisterOOO2 );
     CPPUNIT_TEST( testRegisterOOO3 );
+    CPPUNIT_TEST( testRegisterJump );
+    CPPUNIT_TEST( testRegisterDuplicate );
+    CPPUNIT_TEST( testRegisterRandom );
+    CPPUNIT_TEST( testRegisterRetarget );
+    CPPUNIT_TEST( testPacketDumpLimit );
+    CPPUNIT_TEST( testStats );
     CPPUNIT_TEST( testLogPrefix );
     CPPUNIT_TEST_SUITE_END();
 };
@@ -1343,6 +1721,120 @@ public:
         CPPUNIT_ASSERT_EQUAL( callback->mNacks, (uint32_t) 0 );
     }
 
+    void testFBRange() {
+        CTipMediaSourceEventCallback* events = new CTipMediaSourceEventCallback();
+        am->SetCallback(events);
+        am->SetSequenceNumber(1000);
+
+        // 40 new packets, every third one lost
+        CRtcpAppFeedbackPacket packet;
+        packet.SetTarget(0xA5A5A011);
+        packet.SetPacketID(1040);
+        for (uint16_t seqno = 1000; seqno < 1040; seqno++) {
+            packet.SetPacketAckBySeqNum(seqno, ((seqno % 3) ? CRtcpAppFeedbackPacket::APP_FB_ACK :
+                                                CRtcpAppFeedbackPacket::APP_FB_NACK));
+        }
+        feedPacket(packet);
+
+        // one range callback for the whole packet
+        CPPUNIT_ASSERT_EQUAL( events->mRanges, (uint32_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( events->mEvents.size(), (size_t) 41 );
+        for (uint16_t i = 0; i < events->mEvents.size(); i++) {
+            uint16_t seqno = (1000 + i);
+            CPPUNIT_ASSERT_EQUAL( events->mEvents[i].first, seqno );
+            CPPUNIT_ASSERT_EQUAL( events->mEvents[i].second, ((seqno % 3) != 0 || seqno == 1040) );
+        }
+
+        // a full packet of new bits takes two
+        events->mRanges = 0;
+        packet.SetPacketID(1040 + CRtcpAppFeedbackPacket::NUM_ACK_BITS);
+        feedPacket(packet);
+        CPPUNIT_ASSERT_EQUAL( events->mRanges, (uint32_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( events->mEvents.size(), (size_t) (41 + CRtcpAppFeedbackPacket::NUM_ACK_BITS) );
+    }
+
+    void testFBRandom() {
+        // compare against the one seqno at a time model
+        CTipMediaSourceEventCallback* events = new CTipMediaSourceEventCallback();
+        am->SetCallback(events);
+
+        CTipMediaSourceModel model;
+        CRtcpAppExtendedFeedbackPacket packet;
+        packet.SetTarget(0xA5A5A011);
+        
+        uint16_t id = 0xFF00;
+        unsigned int seed = 1;
+
+        for (uint32_t n = 0; n < 5000; n++) {
+            uint32_t r = rand_r(&seed);
+            
+            switch (r % 8) {
+            case 0:
+                id += (r % 400);       // lost feedback
+                break;
+            case 1:
+                id -= (r % 50);        // out of order feedback
+                break;
+            default:
+                id += (r % 40);
+                break;
+            }
+            packet.SetPacketID(id);
+
+            uint8_t acks[CRtcpAppFeedbackPacket::NUM_ACK_BYTES];
+            uint8_t valid[CRtcpAppFeedbackPacket::NUM_ACK_BYTES];
+            for (uint32_t i = 0; i < sizeof(acks); i++) {
+                acks[i] = (uint8_t) rand_r(&seed);
+                valid[i] = 0xFF;
+            }
+
+            // sometimes the most recent packets are not yet valid,
+            // sometimes with (invalid) valid ACKs following them
+            if ((r % 5) == 0) {
+                uint32_t start = (rand_r(&seed) % CRtcpAppFeedbackPacket::NUM_ACK_BITS);
+                bool holes = ((r % 3) == 0);
+                for (uint32_t i = start; i < CRtcpAppFeedbackPacket::NUM_ACK_BITS; i++) {
+                    if (! holes || (rand_r(&seed) % 2)) {
+                        valid[(i/8)] &= ~(1 << (i%8));
+                    }
+                }
+            }
+            packet.SetPacketAcks(acks);
+            packet.SetPacketAcksValid(valid);
+
+            events->mEvents.clear();
+            model.mEvents.clear();
+            
+            feedPacket(packet);
+            model.ProcessFBPacket(packet);
+
+            CPPUNIT_ASSERT( events->mEvents == model.mEvents );
+        }
+    }
+    
+    void testFBSequenceReset() {
+        CTipMediaSourceEventCallback* events = new CTipMediaSourceEventCallback();
+        am->SetCallback(events);
+        am->SetSequenceNumber(0);
+
+        CRtcpAppFeedbackPacket packet;
+        packet.SetTarget(0xA5A5A011);
+        packet.SetPacketID(10);
+        packet.SetPacketAcks(one_bytes);
+        feedPacket(packet);
+        CPPUNIT_ASSERT_EQUAL( events->mEvents.size(), (size_t) 11 );
+
+        // repeated feedback is ignored
+        feedPacket(packet);
+        CPPUNIT_ASSERT_EQUAL( events->mEvents.size(), (size_t) 11 );
+
+        // after a sequence number reset the same seqnos are new
+        // packets and get callbacks again
+        am->SetSequenceNumber(0);
+        feedPacket(packet);
+        CPPUNIT_ASSERT_EQUAL( events->mEvents.size(), (size_t) 22 );
+    }
+
     void testFBInvalid() {
         CRtcpAppFeedbackPacket packet;
 
@@ -1409,6 +1901,9 @@ public:
     CPPUNIT_TEST( testExtFB11 );
     CPPUNIT_TEST( testExtFB12 );
     CPPUNIT_TEST( testExtFB13 );
+    CPPUNIT_TEST( testFBRange );
+    CPPUNIT_TEST( testFBRandom );
+    CPPUNIT_TEST( testFBSequenceReset );
     CPPUNIT_TEST( testFBInvalid );
     CPPUNIT_TEST( testLogPrefix );
     CPPUNIT_TEST_SUITE_END();
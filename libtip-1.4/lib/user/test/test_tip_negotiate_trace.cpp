@@ -0,0 +1,158 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <sstream>
+#include <string>
+
+#include "private/tip_negotiate_trace.h"
+using namespace LibTip;
+
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class CTipNegotiateTraceTest : public CppUnit::TestFixture {
+private:
+    CTipNegotiateTrace* trace;
+
+    std::string write(uint64_t now, bool complete = true) {
+        std::ostringstream o;
+        trace->Write(o, 7, now, complete);
+        return o.str();
+    }
+
+    bool contains(const std::string& s, const char* sub) {
+        return (s.find(sub) != std::string::npos);
+    }
+    
+public:
+    void setUp() {
+        trace = new CTipNegotiateTrace();
+        CPPUNIT_ASSERT( trace != NULL );
+    }
+
+    void tearDown() {
+        delete trace;
+    }
+
+    void testCreate() {
+        CPPUNIT_ASSERT_EQUAL( trace->GetSize(), CTipNegotiateTrace::DEFAULT_SIZE );
+        CPPUNIT_ASSERT_EQUAL( trace->GetNumEvents(), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( write(0), std::string("{\"traceEvents\":[\n\n]}\n") );
+        CPPUNIT_ASSERT_EQUAL( write(0, false), std::string("") );
+    }
+
+    void testSpans() {
+        trace->Add(VIDEO, true, "MCTX", 1000);
+        trace->Add(VIDEO, false, "NORX", 1000);
+        trace->Add(VIDEO, true, "MOTX", 1500);
+        trace->Add(VIDEO, false, "MCRX", 1700);
+        trace->Add(VIDEO, true, "DONE", 2000);
+        CPPUNIT_ASSERT_EQUAL( trace->GetNumEvents(), (uint32_t) 5 );
+
+        std::string json = write(2600);
+
+        // each state lasts until the next change on the same side,
+        // the last one until now
+        CPPUNIT_ASSERT( contains(json, "{\"name\":\"MCTX\",\"cat\":\"tipneg\",\"ph\":\"X\","
+                                 "\"ts\":1000,\"dur\":500,\"pid\":7,\"tid\":1}") );
+        CPPUNIT_ASSERT( contains(json, "{\"name\":\"MOTX\",\"cat\":\"tipneg\",\"ph\":\"X\","
+                                 "\"ts\":1500,\"dur\":500,\"pid\":7,\"tid\":1}") );
+        CPPUNIT_ASSERT( contains(json, "{\"name\":\"DONE\",\"cat\":\"tipneg\",\"ph\":\"X\","
+                                 "\"ts\":2000,\"dur\":600,\"pid\":7,\"tid\":1}") );
+        CPPUNIT_ASSERT( contains(json, "{\"name\":\"NORX\",\"cat\":\"tipneg\",\"ph\":\"X\","
+                                 "\"ts\":1000,\"dur\":700,\"pid\":7,\"tid\":2}") );
+        CPPUNIT_ASSERT( contains(json, "{\"name\":\"MCRX\",\"cat\":\"tipneg\",\"ph\":\"X\","
+                                 "\"ts\":1700,\"dur\":900,\"pid\":7,\"tid\":2}") );
+
+        // only tracks with events are named
+        CPPUNIT_ASSERT( contains(json, "\"tid\":1,\"args\":{\"name\":\"VIDEO local\"}") );
+        CPPUNIT_ASSERT( contains(json, "\"tid\":2,\"args\":{\"name\":\"VIDEO remote\"}") );
+        CPPUNIT_ASSERT( ! contains(json, "AUDIO") );
+
+        CPPUNIT_ASSERT_EQUAL( json.find("{\"traceEvents\":[\n"), (size_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( json.substr(json.size() - 4), std::string("\n]}\n") );
+    }
+
+    void testFragment() {
+        trace->Add(AUDIO, false, "NORX", 10);
+        trace->Add(AUDIO, false, "MCRX", 20);
+        
+        std::string json = write(30, false);
+        CPPUNIT_ASSERT_EQUAL( json[0], '{' );
+        CPPUNIT_ASSERT_EQUAL( json[json.size() - 1], '}' );
+        CPPUNIT_ASSERT( ! contains(json, "traceEvents") );
+        CPPUNIT_ASSERT( contains(json, "\"tid\":4,\"args\":{\"name\":\"AUDIO remote\"}") );
+        CPPUNIT_ASSERT( contains(json, "\"ts\":10,\"dur\":10,\"pid\":7,\"tid\":4}") );
+        CPPUNIT_ASSERT( contains(json, "\"ts\":20,\"dur\":10,\"pid\":7,\"tid\":4}") );
+    }
+
+    void testClockBackwards() {
+        // now before the last change gives an empty span
+        trace->Add(VIDEO, true, "MCTX", 1000);
+        CPPUNIT_ASSERT( contains(write(500), "\"ts\":1000,\"dur\":0,") );
+    }
+    
+    void testWrap() {
+        trace->SetSize(2);
+        trace->Add(VIDEO, true, "MCTX", 100);
+        trace->Add(VIDEO, true, "MOTX", 200);
+        trace->Add(VIDEO, true, "DONE", 300);
+        CPPUNIT_ASSERT_EQUAL( trace->GetNumEvents(), (uint32_t) 2 );
+
+        // oldest is gone
+        std::string json = write(400);
+        CPPUNIT_ASSERT( ! contains(json, "MCTX") );
+        CPPUNIT_ASSERT( contains(json, "\"name\":\"MOTX\",\"cat\":\"tipneg\",\"ph\":\"X\","
+                                 "\"ts\":200,\"dur\":100,") );
+        CPPUNIT_ASSERT( contains(json, "\"name\":\"DONE\",\"cat\":\"tipneg\",\"ph\":\"X\","
+                                 "\"ts\":300,\"dur\":100,") );
+    }
+
+    void testDisable() {
+        trace->Add(VIDEO, true, "MCTX", 100);
+        trace->SetSize(0);
+        CPPUNIT_ASSERT_EQUAL( trace->GetNumEvents(), (uint32_t) 0 );
+        
+        trace->Add(VIDEO, true, "MOTX", 200);
+        CPPUNIT_ASSERT_EQUAL( trace->GetNumEvents(), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( write(300, false), std::string("") );
+    }
+
+    void testInvalid() {
+        trace->Add(MT_MAX, true, "MCTX", 100);
+        CPPUNIT_ASSERT_EQUAL( trace->GetNumEvents(), (uint32_t) 0 );
+    }
+
+    void testClear() {
+        trace->Add(VIDEO, true, "MCTX", 100);
+        trace->Clear();
+        CPPUNIT_ASSERT_EQUAL( trace->GetNumEvents(), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( trace->GetSize(), CTipNegotiateTrace::DEFAULT_SIZE );
+    }
+    
+    CPPUNIT_TEST_SUITE( CTipNegotiateTraceTest );
+    CPPUNIT_TEST( testCreate );
+    CPPUNIT_TEST( testSpans );
+    CPPUNIT_TEST( testFragment );
+    CPPUNIT_TEST( testClockBackwards );
+    CPPUNIT_TEST( testWrap );
+    CPPUNIT_TEST( testDisable );
+    CPPUNIT_TEST( testInvalid );
+    CPPUNIT_TEST( testClear );
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CTipNegotiateTraceTest );
@@ -16,6 +16,8 @@
 
 #include "tip_csrc.h"
 #include "rtcp_packet.h"
+#include "rtcp_rr_packet.h"
+#include "rtcp_sdes_packet.h"
 #include "rtcp_tip_muxctrl_packet.h"
 #include "rtcp_tip_mediaopts_packet.h"
 #include "rtcp_tip_ack_packet.h"
@@ -278,6 +280,113 @@ public:
                               CTipRelay::SYSTEM );
     }
 
+    void testClassifyMuxCtrlVersion() {
+        CRtcpAppMuxCtrlV7Packet packet;
+        CPacketBufferData buffer;
+
+        packet.Pack(buffer);
+        CPPUNIT_ASSERT_EQUAL( amr->Classify(buffer.GetBuffer(), buffer.GetBufferSize(), pos),
+                              CTipRelay::SYSTEM );
+
+        // versions before 6 cannot be parsed
+        CRtcpAppMuxCtrlPacket old;
+        old.SetVersion(5);
+        buffer.Reset();
+        old.Pack(buffer);
+        CPPUNIT_ASSERT_EQUAL( amr->Classify(buffer.GetBuffer(), buffer.GetBufferSize(), pos),
+                              CTipRelay::NOT_TIP );
+    }
+    
+    void testClassifyTruncated() {
+        // a TXFLOWCTRL without room for the target cannot be parsed,
+        // it should be skipped in favor of the following RXFLOWCTRL
+        CRtcpTipPacket tx(TXFLOWCTRL);
+        CRtcpAppRXFlowCtrlPacket rx;
+        CPacketBufferData buffer;
+        CTipCSRC csrc;
+
+        csrc.SetSourcePos(2);
+        rx.SetTarget(csrc.GetCSRC());
+        tx.Pack(buffer);
+        rx.Pack(buffer);
+
+        CPPUNIT_ASSERT_EQUAL( amr->Classify(buffer.GetBuffer(), buffer.GetBufferSize(), pos),
+                              CTipRelay::MEDIA_SINK );
+        CPPUNIT_ASSERT_EQUAL( pos, (uint16_t) (1 << 2) );
+
+        // same for a truncated feedback packet
+        CRtcpPacketSSRC fb;
+        fb.SetType(CRtcpPacket::RTPFB);
+        fb.SetSubType(CRtcpAppFeedbackPacket::APPFB_SUBTYPE);
+        buffer.Reset();
+        fb.Pack(buffer);
+        CPPUNIT_ASSERT_EQUAL( amr->Classify(buffer.GetBuffer(), buffer.GetBufferSize(), pos),
+                              CTipRelay::NOT_TIP );
+    }
+
+    void testClassifyCompound() {
+        CRtcpRRPacket rr;
+        CRtcpSDESPacket sdes;
+        CRtcpAppRefreshPacket packet;
+        CPacketBufferData buffer;
+        CTipCSRC csrc;
+
+        sdes.AddChunk(rr.GetSSRC());
+        csrc.SetSourcePos(3);
+        packet.SetTarget(csrc.GetCSRC());
+
+        rr.Pack(buffer);
+        sdes.Pack(buffer);
+        packet.Pack(buffer);
+
+        CPPUNIT_ASSERT_EQUAL( amr->Classify(buffer.GetBuffer(), buffer.GetBufferSize(), pos),
+                              CTipRelay::MEDIA_SOURCE );
+        CPPUNIT_ASSERT_EQUAL( pos, (uint16_t) (1 << 3) );
+    }
+    
+    void testClassifyBatch() {
+        CRtcpAppMuxCtrlPacket mux;
+        CRtcpAppRXFlowCtrlPacket rx;
+        CRtcpTipAckPacket ack(ACK_RXFLOWCTRL);
+        CRtcpRRPacket rr;
+        CPacketBufferData buffer[4];
+        CTipCSRC csrc;
+
+        csrc.SetSourcePos(2);
+        rx.SetTarget(csrc.GetCSRC());
+
+        mux.Pack(buffer[0]);
+        rr.Pack(buffer[1]);
+        rx.Pack(buffer[2]);
+        ack.Pack(buffer[3]);
+
+        uint8_t* buffers[4];
+        uint32_t sizes[4];
+        for (uint32_t i = 0; i < 4; i++) {
+            buffers[i] = buffer[i].GetBuffer();
+            sizes[i]   = buffer[i].GetBufferSize();
+        }
+
+        CTipRelay::Classification classes[4];
+        uint16_t positions[4] = { 0xAAAA, 0xAAAA, 0xAAAA, 0xAAAA };
+        
+        CPPUNIT_ASSERT_EQUAL( amr->ClassifyBatch(buffers, sizes, 4, classes, positions),
+                              (uint32_t) 3 );
+
+        CPPUNIT_ASSERT_EQUAL( classes[0], CTipRelay::SYSTEM );
+        CPPUNIT_ASSERT_EQUAL( positions[0], (uint16_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( classes[1], CTipRelay::NOT_TIP );
+        CPPUNIT_ASSERT_EQUAL( positions[1], (uint16_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( classes[2], CTipRelay::MEDIA_SINK );
+        CPPUNIT_ASSERT_EQUAL( positions[2], (uint16_t) (1 << 2) );
+        CPPUNIT_ASSERT_EQUAL( classes[3], CTipRelay::MEDIA_SOURCE );
+        CPPUNIT_ASSERT_EQUAL( positions[3], (uint16_t) 0xFFFF );
+
+        // empty batch
+        CPPUNIT_ASSERT_EQUAL( amr->ClassifyBatch(buffers, sizes, 0, classes, positions),
+                              (uint32_t) 0 );
+    }
+    
     CPPUNIT_TEST_SUITE( CTipRelayTest );
     CPPUNIT_TEST( testClassifyInvalid );
     CPPUNIT_TEST( testClassifyInvalid2 );
@@ -294,6 +403,10 @@ public:
     CPPUNIT_TEST( testClassifyEcho );
     CPPUNIT_TEST( testClassifySpiMap );
     CPPUNIT_TEST( testClassifyNotify );
+    CPPUNIT_TEST( testClassifyMuxCtrlVersion );
+    CPPUNIT_TEST( testClassifyTruncated );
+    CPPUNIT_TEST( testClassifyCompound );
+    CPPUNIT_TEST( testClassifyBatch );
     CPPUNIT_TEST_SUITE_END();
 };
 
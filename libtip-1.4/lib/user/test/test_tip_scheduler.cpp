@@ -0,0 +1,284 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <poll.h>
+
+#include "tip_time.h"
+#include "tip.h"
+#include "tip_scheduler.h"
+using namespace LibTip;
+
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+// clock that only moves when told to
+class CTestClock : public CTipClock {
+public:
+    CTestClock() : mNow(1000) {}
+    virtual uint64_t GetMsec() { return mNow; }
+
+    uint64_t mNow;
+};
+
+// object with a settable idle time that counts its runs
+class CTestSchedulable : public CTipSchedulable {
+public:
+    CTestSchedulable() : mIdle((uint64_t) -1), mNextIdle((uint64_t) -1), mRuns(0) {}
+
+    virtual uint64_t GetIdleTime() const { return mIdle; }
+
+    virtual void DoPeriodicActivity() {
+        mRuns++;
+        SetIdle(mNextIdle);
+    }
+
+    void SetIdle(uint64_t idle) {
+        mIdle = idle;
+        Reschedule();
+    }
+
+    uint64_t mIdle;
+    uint64_t mNextIdle;
+    uint32_t mRuns;
+};
+
+// transmitter that just counts
+class CTestXmit : public CTipPacketTransmit {
+public:
+    CTestXmit() : mCount(0) {}
+
+    virtual Status Transmit(const uint8_t* pktBuffer, uint32_t pktSize, MediaType mType) {
+        mCount++;
+        return TIP_OK;
+    }
+
+    uint32_t mCount;
+};
+
+class CTipSchedulerTest : public CppUnit::TestFixture {
+private:
+    CTipEventScheduler* sched;
+    CTestClock clock;
+
+public:
+    void setUp() {
+        clock.mNow = 1000;
+        SetClock(&clock);
+
+        sched = new CTipEventScheduler();
+        CPPUNIT_ASSERT( sched != NULL );
+    }
+
+    void tearDown() {
+        delete sched;
+        SetClock(NULL);
+    }
+
+    void testEmpty() {
+        CPPUNIT_ASSERT_EQUAL( sched->GetIdleTime(), (uint64_t) -1 );
+        CPPUNIT_ASSERT_EQUAL( sched->GetNumScheduled(), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( sched->DoPeriodicActivity(), (uint32_t) 0 );
+    }
+
+    void testOrder() {
+        CTestSchedulable a, b, c;
+
+        a.SetIdle(30);
+        b.SetIdle(10);
+        c.SetIdle(20);
+        a.SetScheduler(sched);
+        b.SetScheduler(sched);
+        c.SetScheduler(sched);
+
+        CPPUNIT_ASSERT_EQUAL( sched->GetNumScheduled(), (uint32_t) 3 );
+        CPPUNIT_ASSERT_EQUAL( sched->GetIdleTime(), (uint64_t) 10 );
+
+        // nothing due yet
+        CPPUNIT_ASSERT_EQUAL( sched->DoPeriodicActivity(), (uint32_t) 0 );
+
+        // only b is due
+        clock.mNow += 15;
+        CPPUNIT_ASSERT_EQUAL( sched->DoPeriodicActivity(), (uint32_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( b.mRuns, (uint32_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( sched->GetIdleTime(), (uint64_t) 5 );
+
+        // then the other two
+        clock.mNow += 20;
+        CPPUNIT_ASSERT_EQUAL( sched->DoPeriodicActivity(), (uint32_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( a.mRuns, (uint32_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( c.mRuns, (uint32_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( sched->GetNumScheduled(), (uint32_t) 0 );
+    }
+
+    void testReschedule() {
+        CTestSchedulable a, b;
+
+        a.SetScheduler(sched);
+        b.SetScheduler(sched);
+        a.SetIdle(100);
+        b.SetIdle(50);
+        CPPUNIT_ASSERT_EQUAL( sched->GetIdleTime(), (uint64_t) 50 );
+
+        // move a earlier then later again
+        a.SetIdle(10);
+        CPPUNIT_ASSERT_EQUAL( sched->GetIdleTime(), (uint64_t) 10 );
+        a.SetIdle(200);
+        CPPUNIT_ASSERT_EQUAL( sched->GetIdleTime(), (uint64_t) 50 );
+
+        // nothing to do removes it
+        b.SetIdle((uint64_t) -1);
+        CPPUNIT_ASSERT_EQUAL( sched->GetNumScheduled(), (uint32_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( sched->GetIdleTime(), (uint64_t) 200 );
+    }
+
+    void testRemove() {
+        CTestSchedulable a;
+        
+        a.SetIdle(10);
+        a.SetScheduler(sched);
+        CPPUNIT_ASSERT_EQUAL( sched->GetNumScheduled(), (uint32_t) 1 );
+        
+        a.SetScheduler(NULL);
+        CPPUNIT_ASSERT_EQUAL( sched->GetNumScheduled(), (uint32_t) 0 );
+        CPPUNIT_ASSERT( a.GetScheduler() == NULL );
+
+        // destroying a scheduled object removes it
+        CTestSchedulable* b = new CTestSchedulable();
+        b->SetIdle(10);
+        b->SetScheduler(sched);
+        CPPUNIT_ASSERT_EQUAL( sched->GetNumScheduled(), (uint32_t) 1 );
+        delete b;
+        CPPUNIT_ASSERT_EQUAL( sched->GetNumScheduled(), (uint32_t) 0 );
+    }
+
+    void testRescheduleNow() {
+        CTestSchedulable a;
+
+        // an object that is always due only runs once per call
+        a.mNextIdle = 0;
+        a.SetIdle(0);
+        a.SetScheduler(sched);
+
+        CPPUNIT_ASSERT_EQUAL( sched->DoPeriodicActivity(), (uint32_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( a.mRuns, (uint32_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( sched->GetNumScheduled(), (uint32_t) 1 );
+
+        CPPUNIT_ASSERT_EQUAL( sched->DoPeriodicActivity(), (uint32_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( a.mRuns, (uint32_t) 2 );
+    }
+
+    void testMany() {
+        const uint32_t count = 1000;
+        CTestSchedulable objects[count];
+
+        for (uint32_t i = 0; i < count; i++) {
+            objects[i].SetIdle(((i * 7919) % count) + 1);
+            objects[i].SetScheduler(sched);
+        }
+
+        // every millisecond exactly one object is due
+        for (uint32_t i = 1; i <= count; i++) {
+            clock.mNow++;
+            CPPUNIT_ASSERT_EQUAL( sched->DoPeriodicActivity(), (uint32_t) 1 );
+        }
+
+        CPPUNIT_ASSERT_EQUAL( sched->GetNumScheduled(), (uint32_t) 0 );
+    }
+    
+    void testFd() {
+#ifdef __linux__
+        CTestSchedulable a;
+        struct pollfd pfd;
+
+        SetClock(NULL);
+        CPPUNIT_ASSERT( sched->GetFd() >= 0 );
+
+        pfd.fd     = sched->GetFd();
+        pfd.events = POLLIN;
+
+        // nothing scheduled, nothing to read
+        CPPUNIT_ASSERT_EQUAL( poll(&pfd, 1, 0), 0 );
+
+        uint64_t start = GetMsecTimestamp();
+        a.SetIdle(20);
+        a.SetScheduler(sched);
+
+        CPPUNIT_ASSERT_EQUAL( poll(&pfd, 1, 1000), 1 );
+        CPPUNIT_ASSERT( GetMsecTimestamp() >= (start + 19) );
+        CPPUNIT_ASSERT_EQUAL( sched->DoPeriodicActivity(), (uint32_t) 1 );
+
+        // fd is cleared after the run
+        CPPUNIT_ASSERT_EQUAL( poll(&pfd, 1, 0), 0 );
+#endif
+    }
+
+    void testNoFd() {
+        CTipEventScheduler noFd(false);
+        CTestSchedulable a;
+
+        CPPUNIT_ASSERT_EQUAL( noFd.GetFd(), -1 );
+
+        // still schedules using the idle time
+        a.SetIdle(20);
+        a.SetScheduler(&noFd);
+        CPPUNIT_ASSERT_EQUAL( noFd.GetIdleTime(), (uint64_t) 20 );
+
+        clock.mNow += 20;
+        CPPUNIT_ASSERT_EQUAL( noFd.DoPeriodicActivity(), (uint32_t) 1 );
+    }
+
+    void testTip() {
+        CTestXmit xmit;
+        CTip tip(xmit);
+
+        tip.SetScheduler(sched);
+        CPPUNIT_ASSERT_EQUAL( sched->GetNumScheduled(), (uint32_t) 0 );
+
+        // negotiation queues MUXCTRL which is due right away
+        CPPUNIT_ASSERT_EQUAL( tip.StartTipNegotiate(VIDEO), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( sched->GetNumScheduled(), (uint32_t) 1 );
+        CPPUNIT_ASSERT_EQUAL( sched->GetIdleTime(), (uint64_t) 0 );
+
+        CPPUNIT_ASSERT_EQUAL( sched->DoPeriodicActivity(), (uint32_t) 1 );
+        CPPUNIT_ASSERT( xmit.mCount != 0 );
+
+        // rescheduled for the retransmission
+        CPPUNIT_ASSERT_EQUAL( sched->GetIdleTime(), (uint64_t) DEFAULT_RETRANS_INTERVAL );
+        
+        uint32_t count = xmit.mCount;
+        clock.mNow += DEFAULT_RETRANS_INTERVAL;
+        CPPUNIT_ASSERT_EQUAL( sched->DoPeriodicActivity(), (uint32_t) 1 );
+        CPPUNIT_ASSERT( xmit.mCount > count );
+
+        CPPUNIT_ASSERT_EQUAL( tip.StopTipNegotiate(VIDEO), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( sched->GetNumScheduled(), (uint32_t) 0 );
+    }
+    
+    CPPUNIT_TEST_SUITE( CTipSchedulerTest );
+    CPPUNIT_TEST( testEmpty );
+    CPPUNIT_TEST( testOrder );
+    CPPUNIT_TEST( testReschedule );
+    CPPUNIT_TEST( testRemove );
+    CPPUNIT_TEST( testRescheduleNow );
+    CPPUNIT_TEST( testMany );
+    CPPUNIT_TEST( testFd );
+    CPPUNIT_TEST( testNoFd );
+    CPPUNIT_TEST( testTip );
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CTipSchedulerTest );
@@ -0,0 +1,385 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <list>
+#include <vector>
+
+#include "tip_debug_print.h"
+#include "tip_time.h"
+#include "rtcp_rr_packet.h"
+#include "rtcp_tip_muxctrl_packet.h"
+#include "tip.h"
+#include "tip_session_group.h"
+using namespace LibTip;
+
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+// clock that only moves when told to
+class CTestClock : public CTipClock {
+public:
+    CTestClock() : mNow(1000) {}
+    virtual uint64_t GetMsec() { return mNow; }
+
+    uint64_t mNow;
+};
+
+// a packet on its way from one session to the other
+struct CTestPacket {
+    CTipSessionGroup*    mpGroup;
+    CTip*                mpTip;
+    MediaType            mType;
+    std::vector<uint8_t> mData;
+};
+
+typedef std::list<CTestPacket> CTestNetwork;
+
+// RTCP SSRCs used by the two sides of each pair, TIP requires the low
+// byte to be zero
+#define SSRC_A(i) (((2 * (i)) + 1) << 8)
+#define SSRC_B(i) (((2 * (i)) + 2) << 8)
+
+// transmitter that queues packets for the peer group.  if a peer
+// session is given packets are delivered directly to it, otherwise
+// the peer group dispatches them by SSRC.
+class CTestLink : public CTipPacketTransmit {
+public:
+    CTestLink(CTestNetwork& network, CTipSessionGroup& peerGroup, CTip* peer) :
+        mNetwork(network), mPeerGroup(peerGroup), mpPeer(peer) {}
+
+    virtual Status Transmit(const uint8_t* pktBuffer, uint32_t pktSize, MediaType mType) {
+        mNetwork.push_back(CTestPacket());
+        mNetwork.back().mpGroup = &mPeerGroup;
+        mNetwork.back().mpTip   = mpPeer;
+        mNetwork.back().mType   = mType;
+        mNetwork.back().mData.assign(pktBuffer, (pktBuffer + pktSize));
+        return TIP_OK;
+    }
+
+    CTestNetwork&     mNetwork;
+    CTipSessionGroup& mPeerGroup;
+    CTip*             mpPeer;
+};
+
+// completed negotiations on one side
+struct CTestCounts {
+    CTestCounts() : mnLastAckRx(0), mnLastAckTx(0) {}
+
+    uint32_t mnLastAckRx;
+    uint32_t mnLastAckTx;
+};
+
+// callback counting completed negotiations, owned by its CTip
+class CTestCallback : public CTipCallback {
+public:
+    CTestCallback(CTestCounts& counts) : mCounts(counts) {}
+
+    virtual void TipNegotiationLastAckReceived(MediaType mType) {
+        mCounts.mnLastAckRx++;
+    }
+
+    virtual bool TipNegotiationLastAckTransmit(MediaType mType, bool doReinvite, void* id) {
+        mCounts.mnLastAckTx++;
+        return true;
+    }
+
+    CTestCounts& mCounts;
+};
+
+class CTipSessionGroupTest : public CppUnit::TestFixture {
+private:
+    CTestClock clock;
+    CTestNetwork network;
+    CTipSessionGroup* groupA;
+    CTipSessionGroup* groupB;
+
+public:
+    void setUp() {
+        // turn off debug prints 
+        if (getenv("TEST_TIP_DEBUG") == NULL) {
+            gDebugFlags = 0;
+        }
+
+        clock.mNow = 1000;
+        SetClock(&clock);
+
+        groupA = new CTipSessionGroup();
+        CPPUNIT_ASSERT( groupA != NULL );
+
+        groupB = new CTipSessionGroup();
+        CPPUNIT_ASSERT( groupB != NULL );
+    }
+
+    void tearDown() {
+        delete groupA;
+        delete groupB;
+        network.clear();
+        SetClock(NULL);
+    }
+
+    // deliver everything on the network, returns the number of
+    // packets processed by a session
+    uint32_t Deliver() {
+        uint32_t count = 0;
+
+        while (! network.empty()) {
+            CTestPacket pkt = network.front();
+            network.pop_front();
+
+            Status ret;
+            if (pkt.mpTip != NULL) {
+                ret = pkt.mpGroup->ReceivePacket(*pkt.mpTip, &pkt.mData[0],
+                                                 pkt.mData.size(), pkt.mType);
+            } else {
+                ret = pkt.mpGroup->ReceivePacket(&pkt.mData[0], pkt.mData.size(),
+                                                 pkt.mType);
+            }
+
+            if (ret == TIP_OK) {
+                count++;
+            }
+        }
+
+        return count;
+    }
+
+    void testAddRemove() {
+        CTestLink link(network, *groupB, NULL);
+        CTip tip(link);
+
+        CPPUNIT_ASSERT_EQUAL( groupA->AddSession(tip), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( groupA->GetNumSessions(), (uint32_t) 1 );
+        CPPUNIT_ASSERT( tip.GetScheduler() == groupA );
+
+        // only one group at a time
+        CPPUNIT_ASSERT_EQUAL( groupA->AddSession(tip), TIP_ERROR );
+        CPPUNIT_ASSERT_EQUAL( groupB->AddSession(tip), TIP_ERROR );
+        CPPUNIT_ASSERT_EQUAL( groupB->RemoveSession(tip), TIP_ERROR );
+
+        CPPUNIT_ASSERT_EQUAL( groupA->RemoveSession(tip), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( groupA->GetNumSessions(), (uint32_t) 0 );
+        CPPUNIT_ASSERT( tip.GetScheduler() == NULL );
+        CPPUNIT_ASSERT_EQUAL( groupA->RemoveSession(tip), TIP_ERROR );
+
+        CPPUNIT_ASSERT_EQUAL( groupB->AddSession(tip), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( groupB->RemoveSession(tip), TIP_OK );
+    }
+
+    void testBind() {
+        CTestLink link(network, *groupB, NULL);
+        CTip tip1(link);
+        CTip tip2(link);
+
+        // must be part of the group first
+        CPPUNIT_ASSERT_EQUAL( groupA->BindSSRC(tip1, 1), TIP_ERROR );
+
+        CPPUNIT_ASSERT_EQUAL( groupA->AddSession(tip1), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( groupA->AddSession(tip2), TIP_OK );
+
+        CPPUNIT_ASSERT_EQUAL( groupA->BindSSRC(tip1, 1), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( groupA->BindSSRC(tip1, 2), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( groupA->BindSSRC(tip1, 1), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( groupA->BindSSRC(tip2, 1), TIP_ERROR );
+        CPPUNIT_ASSERT_EQUAL( groupA->BindSSRC(tip2, 3), TIP_OK );
+
+        CPPUNIT_ASSERT( groupA->FindSession(1) == &tip1 );
+        CPPUNIT_ASSERT( groupA->FindSession(2) == &tip1 );
+        CPPUNIT_ASSERT( groupA->FindSession(3) == &tip2 );
+        CPPUNIT_ASSERT( groupA->FindSession(4) == NULL );
+
+        CPPUNIT_ASSERT_EQUAL( groupA->UnbindSSRC(2), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( groupA->UnbindSSRC(2), TIP_ERROR );
+        CPPUNIT_ASSERT( groupA->FindSession(2) == NULL );
+
+        // removing a session releases its bindings
+        CPPUNIT_ASSERT_EQUAL( groupA->RemoveSession(tip1), TIP_OK );
+        CPPUNIT_ASSERT( groupA->FindSession(1) == NULL );
+        CPPUNIT_ASSERT( groupA->FindSession(3) == &tip2 );
+        CPPUNIT_ASSERT_EQUAL( groupA->RemoveSession(tip2), TIP_OK );
+    }
+
+    void testDestroy() {
+        CTestLink link(network, *groupB, NULL);
+        CTip* tip = new CTip(link);
+
+        CPPUNIT_ASSERT_EQUAL( groupA->AddSession(*tip), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( groupA->BindSSRC(*tip, 1), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( tip->StartTipNegotiate(VIDEO), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( groupA->GetNumScheduled(), (uint32_t) 1 );
+
+        // destroying a session removes it from the group
+        delete tip;
+        CPPUNIT_ASSERT_EQUAL( groupA->GetNumSessions(), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( groupA->GetNumScheduled(), (uint32_t) 0 );
+        CPPUNIT_ASSERT( groupA->FindSession(1) == NULL );
+
+        // and destroying the group detaches the sessions
+        CTip tip2(link);
+        CPPUNIT_ASSERT_EQUAL( groupB->AddSession(tip2), TIP_OK );
+        delete groupB;
+        groupB = NULL;
+        CPPUNIT_ASSERT( tip2.GetScheduler() == NULL );
+    }
+
+    void testDispatch() {
+        CTestLink link(network, *groupB, NULL);
+        CTip tip(link);
+        uint8_t junk[4] = { 0, 0, 0, 0 };
+
+        CPPUNIT_ASSERT_EQUAL( groupA->AddSession(tip), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( groupA->ReceivePacket(junk, sizeof(junk), VIDEO), TIP_ERROR );
+        CPPUNIT_ASSERT_EQUAL( groupA->ReceivePacket(NULL, 0, VIDEO), TIP_ERROR );
+
+        // packet from an unknown SSRC
+        CRtcpRRPacket rr;
+        CPacketBufferData buffer;
+        rr.SetSSRC(0x1234);
+        rr.Pack(buffer);
+
+        CPPUNIT_ASSERT_EQUAL( groupA->ReceivePacket(buffer.GetBuffer(), buffer.GetBufferSize(),
+                                                    VIDEO), TIP_ERROR );
+
+        // non-TIP packets are not processed and so not learned
+        CPPUNIT_ASSERT_EQUAL( groupA->ReceivePacket(tip, buffer.GetBuffer(),
+                                                    buffer.GetBufferSize(), VIDEO), TIP_ERROR );
+        CPPUNIT_ASSERT( groupA->FindSession(0x1234) == NULL );
+
+        CPPUNIT_ASSERT_EQUAL( groupA->RemoveSession(tip), TIP_OK );
+    }
+
+    void testReceiveNotInGroup() {
+        CTestLink link(network, *groupB, NULL);
+        CTip tip(link);
+
+        CRtcpAppMuxCtrlPacket muxctrl;
+        CPacketBufferData buffer;
+        muxctrl.SetSSRC(0x1234);
+        muxctrl.Pack(buffer);
+
+        // not processed and not learned
+        CPPUNIT_ASSERT_EQUAL( groupA->ReceivePacket(tip, buffer.GetBuffer(),
+                                                    buffer.GetBufferSize(), VIDEO), TIP_ERROR );
+        CPPUNIT_ASSERT( groupA->FindSession(0x1234) == NULL );
+
+        CTipStats stats;
+        CPPUNIT_ASSERT_EQUAL( tip.GetStats(VIDEO, stats), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( stats.GetNumReceived(MUXCTRL), (uint64_t) 0 );
+
+        // once added the same packet is processed and learned
+        CPPUNIT_ASSERT_EQUAL( groupA->AddSession(tip), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( groupA->ReceivePacket(tip, buffer.GetBuffer(),
+                                                    buffer.GetBufferSize(), VIDEO), TIP_OK );
+        CPPUNIT_ASSERT( groupA->FindSession(0x1234) == &tip );
+        CPPUNIT_ASSERT_EQUAL( groupA->RemoveSession(tip), TIP_OK );
+    }
+    
+    // negotiate many session pairs between two groups.  sessions in
+    // group A know their peer's SSRC up front, sessions in group B
+    // learn it from the first packet.
+    void Negotiate(uint32_t numSessions) {
+        std::vector<CTestLink*> links;
+        std::vector<CTip*> tipsA;
+        std::vector<CTip*> tipsB;
+        CTestCounts countsA;
+        CTestCounts countsB;
+
+        for (uint32_t i = 0; i < numSessions; i++) {
+            CTestLink* linkB = new CTestLink(network, *groupA, NULL);
+            CTip* tipB = new CTip(*linkB);
+            
+            CTestLink* linkA = new CTestLink(network, *groupB, tipB);
+            CTip* tipA = new CTip(*linkA);
+
+            tipA->SetRTCPSSRC(VIDEO, SSRC_A(i));
+            tipB->SetRTCPSSRC(VIDEO, SSRC_B(i));
+            tipA->SetCallback(new CTestCallback(countsA));
+            tipB->SetCallback(new CTestCallback(countsB));
+
+            CPPUNIT_ASSERT_EQUAL( groupA->AddSession(*tipA), TIP_OK );
+            CPPUNIT_ASSERT_EQUAL( groupB->AddSession(*tipB), TIP_OK );
+            CPPUNIT_ASSERT_EQUAL( groupA->BindSSRC(*tipA, SSRC_B(i)), TIP_OK );
+
+            links.push_back(linkA);
+            links.push_back(linkB);
+            tipsA.push_back(tipA);
+            tipsB.push_back(tipB);
+        }
+
+        for (uint32_t i = 0; i < numSessions; i++) {
+            CPPUNIT_ASSERT_EQUAL( tipsA[i]->StartTipNegotiate(VIDEO), TIP_OK );
+            CPPUNIT_ASSERT_EQUAL( tipsB[i]->StartTipNegotiate(VIDEO), TIP_OK );
+        }
+
+        // nothing has been sent yet, everyone is due
+        CPPUNIT_ASSERT_EQUAL( groupA->GetNumScheduled(), numSessions );
+        CPPUNIT_ASSERT_EQUAL( groupA->GetIdleTime(), (uint64_t) 0 );
+        
+        for (uint32_t loop = 0; loop < 100; loop++) {
+            groupA->DoPeriodicActivity();
+            groupB->DoPeriodicActivity();
+            if (Deliver() == 0) {
+                break;
+            }
+        }
+
+        CPPUNIT_ASSERT_EQUAL( countsA.mnLastAckRx, numSessions );
+        CPPUNIT_ASSERT_EQUAL( countsA.mnLastAckTx, numSessions );
+        CPPUNIT_ASSERT_EQUAL( countsB.mnLastAckRx, numSessions );
+        CPPUNIT_ASSERT_EQUAL( countsB.mnLastAckTx, numSessions );
+
+        // group B learned every peer
+        for (uint32_t i = 0; i < numSessions; i++) {
+            CPPUNIT_ASSERT( groupB->FindSession(SSRC_A(i)) == tipsB[i] );
+        }
+
+        // nothing left to retransmit so nobody runs
+        clock.mNow += DEFAULT_RETRANS_INTERVAL;
+        CPPUNIT_ASSERT_EQUAL( groupA->DoPeriodicActivity(), (uint32_t) 0 );
+        CPPUNIT_ASSERT_EQUAL( groupB->DoPeriodicActivity(), (uint32_t) 0 );
+        
+        for (uint32_t i = 0; i < numSessions; i++) {
+            CPPUNIT_ASSERT_EQUAL( groupA->RemoveSession(*tipsA[i]), TIP_OK );
+            CPPUNIT_ASSERT_EQUAL( groupB->RemoveSession(*tipsB[i]), TIP_OK );
+            delete tipsA[i];
+            delete tipsB[i];
+        }
+        for (uint32_t i = 0; i < links.size(); i++) {
+            delete links[i];
+        }
+    }
+
+    void testNegotiate() {
+        Negotiate(1);
+    }
+
+    void testNegotiateMany() {
+        Negotiate(500);
+    }
+
+    CPPUNIT_TEST_SUITE( CTipSessionGroupTest );
+    CPPUNIT_TEST( testAddRemove );
+    CPPUNIT_TEST( testBind );
+    CPPUNIT_TEST( testDestroy );
+    CPPUNIT_TEST( testDispatch );
+    CPPUNIT_TEST( testReceiveNotInGroup );
+    CPPUNIT_TEST( testNegotiate );
+    CPPUNIT_TEST( testNegotiateMany );
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CTipSessionGroupTest );
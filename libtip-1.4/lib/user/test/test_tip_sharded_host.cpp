@@ -0,0 +1,320 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
+
+#include "tip_debug_print.h"
+#include "tip_time.h"
+#include "tip.h"
+#include "tip_sharded_host.h"
+using namespace LibTip;
+
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+// wait up to a few seconds for a counter to reach a value
+static bool WaitFor(uint32_t& counter, uint32_t value)
+{
+    for (uint32_t i = 0; i < 5000; i++) {
+        if (__atomic_load_n(&counter, __ATOMIC_ACQUIRE) >= value) {
+            return true;
+        }
+        usleep(1000);
+    }
+
+    return false;
+}
+
+// task recording the order and thread it ran on
+class CTestTask : public CTipShardTask {
+public:
+    CTestTask(std::vector<uint32_t>& order, uint32_t id, pthread_t& thread,
+              uint32_t& done) :
+        mOrder(order), mId(id), mThread(thread), mDone(done) {}
+
+    virtual void Run(CTipSessionGroup& group) {
+        mOrder.push_back(mId);
+        mThread = pthread_self();
+        __atomic_fetch_add(&mDone, 1, __ATOMIC_RELEASE);
+    }
+
+private:
+    std::vector<uint32_t>& mOrder;
+    uint32_t               mId;
+    pthread_t&             mThread;
+    uint32_t&     mDone;
+};
+
+// transmitter handing packets to the peer's shard
+class CTestShardLink : public CTipPacketTransmit {
+public:
+    CTestShardLink(CTipShardedHost& host, uint32_t peerShard) :
+        mHost(host), mPeerShard(peerShard) {}
+
+    virtual Status Transmit(const uint8_t* pktBuffer, uint32_t pktSize, MediaType mType) {
+        return mHost.ReceivePacket(mPeerShard, pktBuffer, pktSize, mType);
+    }
+
+private:
+    CTipShardedHost& mHost;
+    uint32_t         mPeerShard;
+};
+
+// callback counting completed negotiations from any shard
+class CTestShardCallback : public CTipCallback {
+public:
+    CTestShardCallback(uint32_t& done) : mDone(done) {}
+
+    virtual void TipNegotiationLastAckReceived(MediaType mType) {
+        __atomic_fetch_add(&mDone, 1, __ATOMIC_RELEASE);
+    }
+
+private:
+    uint32_t& mDone;
+};
+
+// callback recording the outcome of adding sessions
+class CTestAddCallback : public CTipShardAddCallback {
+public:
+    CTestAddCallback(std::vector<Status>& results, uint32_t& done) :
+        mResults(results), mDone(done) {}
+
+    virtual void SessionAdded(CTip& tip, Status result) {
+        mResults.push_back(result);
+        __atomic_fetch_add(&mDone, 1, __ATOMIC_RELEASE);
+    }
+
+private:
+    std::vector<Status>& mResults;
+    uint32_t&            mDone;
+};
+
+// task binding a session to its peer's SSRC and starting negotiation
+class CTestStartTask : public CTipShardTask {
+public:
+    CTestStartTask(CTip& tip, uint32_t peerSSRC) : mTip(tip), mPeerSSRC(peerSSRC) {}
+
+    virtual void Run(CTipSessionGroup& group) {
+        group.BindSSRC(mTip, mPeerSSRC);
+        mTip.StartTipNegotiate(VIDEO);
+    }
+
+private:
+    CTip&    mTip;
+    uint32_t mPeerSSRC;
+};
+
+class CTipShardedHostTest : public CppUnit::TestFixture {
+private:
+    CTipShardedHost* host;
+
+public:
+    void setUp() {
+        // turn off debug prints 
+        if (getenv("TEST_TIP_DEBUG") == NULL) {
+            gDebugFlags = 0;
+        }
+
+        host = new CTipShardedHost(4);
+        CPPUNIT_ASSERT( host != NULL );
+    }
+
+    void tearDown() {
+        delete host;
+    }
+
+    void testStartStop() {
+        CPPUNIT_ASSERT_EQUAL( host->GetNumShards(), (uint32_t) 4 );
+        CPPUNIT_ASSERT_EQUAL( host->GetShard(6), (uint32_t) 2 );
+        
+        CPPUNIT_ASSERT_EQUAL( host->Start(), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( host->Start(), TIP_ERROR );
+        host->Stop();
+        host->Stop();
+        
+        CPPUNIT_ASSERT_EQUAL( host->Start(), TIP_OK );
+    }
+
+    void testNoWakePipe() {
+        struct rlimit saved;
+        CPPUNIT_ASSERT_EQUAL( getrlimit(RLIMIT_NOFILE, &saved), 0 );
+
+        // no descriptors left for the wakeup pipes
+        struct rlimit limit = saved;
+        limit.rlim_cur = 3;
+        CPPUNIT_ASSERT_EQUAL( setrlimit(RLIMIT_NOFILE, &limit), 0 );
+        CTipShardedHost* broken = new CTipShardedHost(2);
+        CPPUNIT_ASSERT_EQUAL( setrlimit(RLIMIT_NOFILE, &saved), 0 );
+
+        // refuses to start rather than sleeping forever, and so
+        // does not hang on destruction
+        CPPUNIT_ASSERT_EQUAL( broken->Start(), TIP_ERROR );
+        delete broken;
+    }
+
+    void testInvalid() {
+        std::vector<uint32_t> order;
+        pthread_t thread;
+        uint32_t done = 0;
+        CTestTask task(order, 0, thread, done);
+        uint8_t buffer[8] = { 0 };
+        
+        CPPUNIT_ASSERT_EQUAL( host->Post(4, &task), TIP_ERROR );
+        CPPUNIT_ASSERT_EQUAL( host->Post(0, NULL), TIP_ERROR );
+        CPPUNIT_ASSERT_EQUAL( host->ReceivePacket(4, buffer, sizeof(buffer), VIDEO), TIP_ERROR );
+        CPPUNIT_ASSERT_EQUAL( host->ReceivePacket(0, NULL, 0, VIDEO), TIP_ERROR );
+    }
+
+    void testPostOrder() {
+        const uint32_t count = 1000;
+        std::vector<uint32_t> order;
+        pthread_t thread = pthread_self();
+        uint32_t done = 0;
+
+        CPPUNIT_ASSERT_EQUAL( host->Start(), TIP_OK );
+
+        for (uint32_t i = 0; i < count; i++) {
+            CPPUNIT_ASSERT_EQUAL( host->Post(1, new CTestTask(order, i, thread, done)), TIP_OK );
+        }
+
+        CPPUNIT_ASSERT( WaitFor(done, count) );
+        CPPUNIT_ASSERT( ! pthread_equal(thread, pthread_self()) );
+        
+        CPPUNIT_ASSERT_EQUAL( order.size(), (size_t) count );
+        for (uint32_t i = 0; i < count; i++) {
+            CPPUNIT_ASSERT_EQUAL( order[i], i );
+        }
+    }
+
+    void testShardThreads() {
+        std::vector<uint32_t> order0;
+        std::vector<uint32_t> order1;
+        pthread_t thread0 = pthread_self();
+        pthread_t thread1 = pthread_self();
+        uint32_t done = 0;
+
+        // tasks may be posted before the shards are started
+        CPPUNIT_ASSERT_EQUAL( host->Post(0, new CTestTask(order0, 0, thread0, done)), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( host->Post(1, new CTestTask(order1, 1, thread1, done)), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( host->Start(), TIP_OK );
+        
+        CPPUNIT_ASSERT( WaitFor(done, 2) );
+        CPPUNIT_ASSERT( ! pthread_equal(thread0, pthread_self()) );
+        CPPUNIT_ASSERT( ! pthread_equal(thread1, pthread_self()) );
+        CPPUNIT_ASSERT( ! pthread_equal(thread0, thread1) );
+    }
+
+    void testStopRunsQueued() {
+        const uint32_t count = 100;
+        std::vector<uint32_t> order;
+        pthread_t thread;
+        uint32_t done = 0;
+
+        CPPUNIT_ASSERT_EQUAL( host->Start(), TIP_OK );
+        for (uint32_t i = 0; i < count; i++) {
+            host->Post(2, new CTestTask(order, i, thread, done));
+        }
+        host->Stop();
+
+        CPPUNIT_ASSERT_EQUAL( __atomic_load_n(&done, __ATOMIC_ACQUIRE), count );
+    }
+
+    void testAddSessionResult() {
+        std::vector<Status> results;
+        uint32_t done = 0;
+        CTestAddCallback callback(results, done);
+        CTestShardLink link(*host, 0);
+        CTip tip(link);
+
+        CPPUNIT_ASSERT_EQUAL( host->Start(), TIP_OK );
+
+        // the second add is refused as the session already has a
+        // scheduler, but both are queued
+        CPPUNIT_ASSERT_EQUAL( host->AddSession(0, tip, &callback), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( host->AddSession(0, tip, &callback), TIP_OK );
+        CPPUNIT_ASSERT( WaitFor(done, 2) );
+        host->Stop();
+
+        CPPUNIT_ASSERT_EQUAL( results.size(), (size_t) 2 );
+        CPPUNIT_ASSERT_EQUAL( results[0], TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( results[1], TIP_ERROR );
+    }
+
+    void testNegotiate() {
+        const uint32_t numPairs = 50;
+        std::vector<CTestShardLink*> links;
+        std::vector<CTip*> tips;
+        uint32_t done = 0;
+
+        CPPUNIT_ASSERT_EQUAL( host->Start(), TIP_OK );
+
+        // each pair spans two shards so every packet crosses threads
+        for (uint32_t i = 0; i < numPairs; i++) {
+            uint32_t shardA = host->GetShard(i);
+            uint32_t shardB = host->GetShard(i + 1);
+            uint32_t ssrcA  = (((2 * i) + 1) << 8);
+            uint32_t ssrcB  = (((2 * i) + 2) << 8);
+
+            CTestShardLink* linkA = new CTestShardLink(*host, shardB);
+            CTestShardLink* linkB = new CTestShardLink(*host, shardA);
+            CTip* tipA = new CTip(*linkA);
+            CTip* tipB = new CTip(*linkB);
+
+            tipA->SetRTCPSSRC(VIDEO, ssrcA);
+            tipB->SetRTCPSSRC(VIDEO, ssrcB);
+            tipA->SetCallback(new CTestShardCallback(done));
+            tipB->SetCallback(new CTestShardCallback(done));
+
+            CPPUNIT_ASSERT_EQUAL( host->AddSession(shardA, *tipA), TIP_OK );
+            CPPUNIT_ASSERT_EQUAL( host->AddSession(shardB, *tipB), TIP_OK );
+            CPPUNIT_ASSERT_EQUAL( host->Post(shardA, new CTestStartTask(*tipA, ssrcB)), TIP_OK );
+            CPPUNIT_ASSERT_EQUAL( host->Post(shardB, new CTestStartTask(*tipB, ssrcA)), TIP_OK );
+            
+            links.push_back(linkA);
+            links.push_back(linkB);
+            tips.push_back(tipA);
+            tips.push_back(tipB);
+        }
+
+        CPPUNIT_ASSERT( WaitFor(done, (2 * numPairs)) );
+        host->Stop();
+        
+        for (uint32_t i = 0; i < tips.size(); i++) {
+            delete tips[i];
+        }
+        for (uint32_t i = 0; i < links.size(); i++) {
+            delete links[i];
+        }
+    }
+
+    CPPUNIT_TEST_SUITE( CTipShardedHostTest );
+    CPPUNIT_TEST( testStartStop );
+    CPPUNIT_TEST( testNoWakePipe );
+    CPPUNIT_TEST( testInvalid );
+    CPPUNIT_TEST( testPostOrder );
+    CPPUNIT_TEST( testShardThreads );
+    CPPUNIT_TEST( testStopRunsQueued );
+    CPPUNIT_TEST( testAddSessionResult );
+    CPPUNIT_TEST( testNegotiate );
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CTipShardedHostTest );
@@ -51,13 +51,13 @@ public:
     void testRegister2() {
         CPPUNIT_ASSERT_EQUAL( mt->Register(CTipTimer::AMT_TIP_NEGOTIATE, 1, 0), (uint32_t) 0 );
         CPPUNIT_ASSERT_EQUAL( mt->Register(CTipTimer::AMT_TIP_NEGOTIATE, 2, 0), (uint32_t) 1 );
-        CPPUNIT_ASSERT_EQUAL( mt->GetNextExpiredTime(), (uint64_t) 1 );
+        CPPUNIT_ASSERT( mt->GetNextExpiredTime() <= (uint64_t) 1 );
     }
 
     void testRegister3() {
         CPPUNIT_ASSERT_EQUAL( mt->Register(CTipTimer::AMT_TIP_NEGOTIATE, 2, 0), (uint32_t) 0 );
         CPPUNIT_ASSERT_EQUAL( mt->Register(CTipTimer::AMT_TIP_NEGOTIATE, 1, 0), (uint32_t) 1 );
-        CPPUNIT_ASSERT_EQUAL( mt->GetNextExpiredTime(), (uint64_t) 1 );
+        CPPUNIT_ASSERT( mt->GetNextExpiredTime() <= (uint64_t) 1 );
     }
 
     void testCancel() {
@@ -105,7 +105,8 @@ public:
         uint32_t data;
         
         CPPUNIT_ASSERT_EQUAL( mt->Register(CTipTimer::AMT_TIP_NEGOTIATE, 1000, 0), (uint32_t) 0 );
-        CPPUNIT_ASSERT_EQUAL( mt->GetNextExpiredTime(), (uint64_t) 1000 );
+        CPPUNIT_ASSERT( mt->GetNextExpiredTime() <= (uint64_t) 1000 );
+        CPPUNIT_ASSERT( mt->GetNextExpiredTime() > (uint64_t) 750 );
         
         CPPUNIT_ASSERT_EQUAL( mt->Register(CTipTimer::AMT_TIP_NEGOTIATE, 0, 1), (uint32_t) 1 );
         CPPUNIT_ASSERT_EQUAL( mt->GetNextExpiredTime(), (uint64_t) 0 );
@@ -128,6 +129,69 @@ public:
         CPPUNIT_ASSERT_EQUAL( mt->GetNextExpiredTime(), (uint64_t) -1 );
     }
 
+    void testNextExpiredElapsed() {
+        // time until expiration counts down from registration
+        CPPUNIT_ASSERT_EQUAL( mt->Register(CTipTimer::AMT_TIP_NEGOTIATE, 1000, 0), (uint32_t) 0 );
+        usleep(300000);
+        
+        CPPUNIT_ASSERT( mt->GetNextExpiredTime() <= (uint64_t) 700 );
+        CPPUNIT_ASSERT( mt->GetNextExpiredTime() > (uint64_t) 450 );
+    }
+
+    void testCancelStale() {
+        CTipTimer::TimerType type;
+        uint32_t data;
+
+        uint32_t id = mt->Register(CTipTimer::AMT_TIP_NEGOTIATE, 0, 0);
+        CPPUNIT_ASSERT_EQUAL( mt->GetExpired(type, data), TIP_OK );
+
+        // new timer reuses the storage but not the id
+        uint32_t id2 = mt->Register(CTipTimer::AMT_TIP_NEGOTIATE, 100, 1);
+        CPPUNIT_ASSERT( id2 != id );
+        CPPUNIT_ASSERT_EQUAL( mt->Cancel(id), TIP_ERROR );
+        CPPUNIT_ASSERT_EQUAL( mt->GetNumTimers(), (uint32_t) 1 );
+        
+        CPPUNIT_ASSERT_EQUAL( mt->Cancel(id2), TIP_OK );
+        CPPUNIT_ASSERT_EQUAL( mt->Cancel(id2), TIP_ERROR );
+        CPPUNIT_ASSERT_EQUAL( mt->Cancel(CTipTimer::INVALID_ID), TIP_ERROR );
+    }
+
+    void testExpiredOrder() {
+        CTipTimer::TimerType type;
+        uint32_t data;
+        
+        // register out of order with some already in the past
+        const uint32_t kNumTimers = 200;
+        uint32_t ids[kNumTimers];
+        uint32_t expect[kNumTimers];
+        uint32_t numExpect = 0;
+        for (uint32_t i = 0; i < kNumTimers; i++) {
+            uint32_t val = ((i * 7919) % kNumTimers);
+            ids[i] = mt->Register(CTipTimer::AMT_DELAYED_ACK,
+                                  (val < 100 ? 0 : 100000 + val), val);
+            if (val < 100 && (i % 10) != 0) {
+                expect[numExpect++] = val;
+            }
+        }
+
+        // cancel some from the middle of the heap
+        for (uint32_t i = 0; i < kNumTimers; i += 10) {
+            CPPUNIT_ASSERT_EQUAL( mt->Cancel(ids[i]), TIP_OK );
+        }
+        CPPUNIT_ASSERT_EQUAL( mt->GetNumTimers(), (kNumTimers - (kNumTimers / 10)) );
+
+        // all expired ones come out in registration order
+        uint32_t count = 0;
+        while (mt->GetExpired(type, data) == TIP_OK) {
+            CPPUNIT_ASSERT( count < numExpect );
+            CPPUNIT_ASSERT_EQUAL( data, expect[count] );
+            count++;
+        }
+        CPPUNIT_ASSERT_EQUAL( count, numExpect );
+        CPPUNIT_ASSERT_EQUAL( count, (uint32_t) 90 );
+        CPPUNIT_ASSERT( mt->GetNextExpiredTime() > (uint64_t) 100000 );
+    }
+    
     CPPUNIT_TEST_SUITE( CTipTimerTest );
     CPPUNIT_TEST( testInit );
     CPPUNIT_TEST( testRegister );
@@ -139,6 +203,9 @@ public:
     CPPUNIT_TEST( testCancelInvalid );
     CPPUNIT_TEST( testExpired );
     CPPUNIT_TEST( testExpired2 );
+    CPPUNIT_TEST( testNextExpiredElapsed );
+    CPPUNIT_TEST( testCancelStale );
+    CPPUNIT_TEST( testExpiredOrder );
     CPPUNIT_TEST_SUITE_END();
 };
 
@@ -20,16 +20,27 @@
 #include <netinet/udp.h>
 #undef __FAVOR_BSD
 #include <getopt.h>
+#include <unistd.h>
 #include <stdint.h>
 #include <pcap.h>
 
+#include <vector>
+
 #include "rtcp_packet.h"
 #include "rtcp_packet_factory.h"
+#include "rtcp_rr_packet.h"
+#include "rtcp_sdes_packet.h"
+#include "rtcp_tip_ack_packet.h"
 #include "rtcp_tip_feedback_packet.h"
+#include "rtcp_tip_packet_manager.h"
+#include "tip_debug_print.h"
+#include "tip_time.h"
 
 #include "tip.h"
 #include "tip_profile.h"
 #include "tip_relay.h"
+#include "tip_session_group.h"
+#include "tip_sharded_host.h"
 
 uint32_t calc_ip_offset(const uint8_t* packet)
 {
@@ -191,6 +202,395 @@ void classify_packet(uint8_t* packet, struct pcap_pkthdr& header)
     printf("to %s:%05hu\n", dstIP, ntohs(udp->uh_dport));
 }
 
+// the rtcp portion of a captured packet, kept in memory for benchmarking
+typedef std::vector<uint8_t> BenchPacket;
+
+void save_packet(uint8_t* packet, struct pcap_pkthdr& header,
+                 std::vector<BenchPacket>& saved)
+{
+    uint32_t offset  = calc_rtcp_offset(packet);
+    saved.push_back(BenchPacket((packet + offset), (packet + header.len)));
+}
+
+void bench_classify(std::vector<BenchPacket>& saved, uint32_t iterations)
+{
+    if (saved.empty() || iterations == 0) {
+        printf("nothing to benchmark\n");
+        return;
+    }
+    
+    LibTip::CTipRelay relay;
+    uint32_t numTip = 0;
+    uint64_t start = LibTip::GetUsecTimestamp();
+    
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (uint32_t j = 0; j < saved.size(); j++) {
+            uint16_t pos = 0;
+            if (relay.Classify(&saved[j][0], saved[j].size(), pos) !=
+                LibTip::CTipRelay::NOT_TIP) {
+                numTip++;
+            }
+        }
+    }
+
+    uint64_t classifyUsec = (LibTip::GetUsecTimestamp() - start);
+
+    // same packets in batches, as a relay using recvmmsg() would.
+    // ClassifyBatch() only wraps Classify() so expect the same cost.
+    const uint32_t kBatchSize = 64;
+    uint8_t* buffers[kBatchSize];
+    uint32_t sizes[kBatchSize];
+    LibTip::CTipRelay::Classification classes[kBatchSize];
+    uint16_t positions[kBatchSize];
+
+    start = LibTip::GetUsecTimestamp();
+    
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint32_t n = 0;
+        for (uint32_t j = 0; j < saved.size(); j++) {
+            buffers[n] = &saved[j][0];
+            sizes[n]   = saved[j].size();
+            if (++n == kBatchSize || (j + 1) == saved.size()) {
+                relay.ClassifyBatch(buffers, sizes, n, classes, positions);
+                n = 0;
+            }
+        }
+    }
+
+    uint64_t batchUsec = (LibTip::GetUsecTimestamp() - start);
+    
+    // for reference, the cost of fully unpacking the same packets
+    start = LibTip::GetUsecTimestamp();
+    
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (uint32_t j = 0; j < saved.size(); j++) {
+            LibTip::CPacketBuffer buffer(&saved[j][0], saved[j].size());
+            while (buffer.GetBufferSize()) {
+                delete LibTip::CRtcpPacketFactory::CreatePacketFromBuffer(buffer);
+            }
+        }
+    }
+
+    uint64_t unpackUsec = (LibTip::GetUsecTimestamp() - start);
+    uint64_t total = ((uint64_t) saved.size() * iterations);
+
+    printf("%lu packets x %u iterations (%u classified as TIP)\n",
+           (unsigned long) saved.size(), iterations, (numTip / iterations));
+    printf("classify:  %.1f ns/packet\n", ((classifyUsec * 1000.0) / total));
+    printf("batch:     %.1f ns/packet\n", ((batchUsec * 1000.0) / total));
+    printf("unpack:    %.1f ns/packet\n", ((unpackUsec * 1000.0) / total));
+}
+
+void bench_ack(uint32_t iterations)
+{
+    LibTip::CTipPacketManager mgr;
+    LibTip::CRtcpTipAckPacket ack(LibTip::ACK_MUXCTRL);
+    uint32_t ssrc = 0x12345678;
+
+    mgr.EnableWrapper(ssrc);
+    ack.SetSSRC(ssrc);
+    
+    // building the RR and SDES wrappers for every ACK
+    uint64_t start = LibTip::GetUsecTimestamp();
+    
+    for (uint32_t i = 0; i < iterations; i++) {
+        LibTip::CPacketBufferData buffer;
+
+        LibTip::CRtcpRRPacket rr;
+        rr.SetSSRC(ssrc);
+        rr.Pack(buffer);
+
+        LibTip::CRtcpSDESPacket sdes;
+        sdes.AddChunk(ssrc);
+        sdes.Pack(buffer);
+
+        ack.Pack(buffer);
+    }
+
+    uint64_t repackUsec = (LibTip::GetUsecTimestamp() - start);
+
+    // copying the cached wrapper bytes
+    start = LibTip::GetUsecTimestamp();
+    
+    for (uint32_t i = 0; i < iterations; i++) {
+        LibTip::CPacketBufferData buffer;
+        mgr.Pack(ack, buffer);
+    }
+
+    uint64_t cachedUsec = (LibTip::GetUsecTimestamp() - start);
+
+    // referencing the cached wrapper bytes
+    start = LibTip::GetUsecTimestamp();
+    
+    for (uint32_t i = 0; i < iterations; i++) {
+        LibTip::CPacketBufferData buffer;
+        struct iovec iov[LibTip::CTipPacketManager::MAX_SEGMENTS];
+        mgr.PackV(ack, buffer, iov);
+    }
+
+    uint64_t packvUsec = (LibTip::GetUsecTimestamp() - start);
+
+    printf("ack repack wrapper:  %.1f ns/packet\n", ((repackUsec * 1000.0) / iterations));
+    printf("ack cached wrapper:  %.1f ns/packet\n", ((cachedUsec * 1000.0) / iterations));
+    printf("ack shared wrapper:  %.1f ns/packet\n", ((packvUsec * 1000.0) / iterations));
+}
+
+// a packet in flight between two benchmark session groups
+struct BenchWirePacket {
+    LibTip::CTipSessionGroup* mpGroup;
+    LibTip::MediaType         mType;
+    BenchPacket               mData;
+};
+
+class BenchLinkTransmit : public LibTip::CTipPacketTransmit {
+public:
+    BenchLinkTransmit(std::vector<BenchWirePacket>& wire, LibTip::CTipSessionGroup& peer) :
+        mWire(wire), mPeer(peer) {}
+    
+    virtual LibTip::Status Transmit(const uint8_t* pktBuffer, uint32_t pktSize,
+                                    LibTip::MediaType mType)
+    {
+        mWire.push_back(BenchWirePacket());
+        mWire.back().mpGroup = &mPeer;
+        mWire.back().mType   = mType;
+        mWire.back().mData.assign(pktBuffer, (pktBuffer + pktSize));
+        return LibTip::TIP_OK;
+    }
+
+private:
+    std::vector<BenchWirePacket>& mWire;
+    LibTip::CTipSessionGroup&     mPeer;
+};
+
+class BenchCallback : public LibTip::CTipCallback {
+public:
+    BenchCallback(uint32_t& done) : mDone(done) {}
+
+    virtual void TipNegotiationLastAckReceived(LibTip::MediaType mType) {
+        mDone++;
+    }
+
+private:
+    uint32_t& mDone;
+};
+
+void bench_sessions(uint32_t numSessions)
+{
+    LibTip::CTipSessionGroup groupA;
+    LibTip::CTipSessionGroup groupB;
+    std::vector<BenchWirePacket> wire;
+    std::vector<BenchWirePacket> delivering;
+    std::vector<BenchLinkTransmit*> links;
+    std::vector<LibTip::CTip*> tips;
+    uint32_t done = 0;
+
+    // per packet debug output would swamp the measurement
+    uint32_t debugFlags = LibTip::gDebugFlags;
+    LibTip::gDebugFlags = 0;
+
+    // pairs of sessions, one in each group, dispatched by SSRC
+    for (uint32_t i = 0; i < numSessions; i++) {
+        uint32_t ssrcA = (((2 * i) + 1) << 8);
+        uint32_t ssrcB = (((2 * i) + 2) << 8);
+        
+        BenchLinkTransmit* linkA = new BenchLinkTransmit(wire, groupB);
+        BenchLinkTransmit* linkB = new BenchLinkTransmit(wire, groupA);
+        LibTip::CTip* tipA = new LibTip::CTip(*linkA);
+        LibTip::CTip* tipB = new LibTip::CTip(*linkB);
+
+        tipA->SetRTCPSSRC(LibTip::VIDEO, ssrcA);
+        tipB->SetRTCPSSRC(LibTip::VIDEO, ssrcB);
+        tipA->SetCallback(new BenchCallback(done));
+        tipB->SetCallback(new BenchCallback(done));
+
+        groupA.AddSession(*tipA);
+        groupB.AddSession(*tipB);
+        groupA.BindSSRC(*tipA, ssrcB);
+        groupB.BindSSRC(*tipB, ssrcA);
+
+        links.push_back(linkA);
+        links.push_back(linkB);
+        tips.push_back(tipA);
+        tips.push_back(tipB);
+    }
+
+    uint64_t start = LibTip::GetUsecTimestamp();
+
+    for (uint32_t i = 0; i < tips.size(); i++) {
+        tips[i]->StartTipNegotiate(LibTip::VIDEO);
+    }
+
+    uint32_t rounds = 0;
+    uint32_t numPackets = 0;
+    while (done < tips.size()) {
+        groupA.DoPeriodicActivity();
+        groupB.DoPeriodicActivity();
+        if (wire.empty()) {
+            // nothing in flight, wait for retransmissions
+            usleep(1000);
+            continue;
+        }
+
+        rounds++;
+        delivering.swap(wire);
+        for (uint32_t i = 0; i < delivering.size(); i++) {
+            BenchWirePacket& pkt = delivering[i];
+            pkt.mpGroup->ReceivePacket(&pkt.mData[0], pkt.mData.size(), pkt.mType);
+        }
+        numPackets += delivering.size();
+        delivering.clear();
+    }
+
+    uint64_t negotiateUsec = (LibTip::GetUsecTimestamp() - start);
+
+    // cost of a wakeup once everything is quiet, group vs polling
+    // every session
+    const uint32_t kIdleRounds = 1000;
+    start = LibTip::GetUsecTimestamp();
+
+    for (uint32_t i = 0; i < kIdleRounds; i++) {
+        groupA.DoPeriodicActivity();
+        groupB.DoPeriodicActivity();
+    }
+
+    uint64_t groupUsec = (LibTip::GetUsecTimestamp() - start);
+    start = LibTip::GetUsecTimestamp();
+
+    for (uint32_t i = 0; i < kIdleRounds; i++) {
+        for (uint32_t j = 0; j < tips.size(); j++) {
+            if (tips[j]->GetIdleTime() == 0) {
+                tips[j]->DoPeriodicActivity();
+            }
+        }
+    }
+
+    uint64_t pollUsec = (LibTip::GetUsecTimestamp() - start);
+
+    printf("%u session pairs negotiated in %.1f ms (%u packets, %u rounds)\n",
+           numSessions, (negotiateUsec / 1000.0), numPackets, rounds);
+    printf("idle wakeup group:  %.1f us\n", ((double) groupUsec / kIdleRounds));
+    printf("idle wakeup poll:   %.1f us\n", ((double) pollUsec / kIdleRounds));
+
+    for (uint32_t i = 0; i < tips.size(); i++) {
+        delete tips[i];
+    }
+    for (uint32_t i = 0; i < links.size(); i++) {
+        delete links[i];
+    }
+
+    LibTip::gDebugFlags = debugFlags;
+}
+
+class BenchShardTransmit : public LibTip::CTipPacketTransmit {
+public:
+    BenchShardTransmit(LibTip::CTipShardedHost& host, uint32_t peerShard) :
+        mHost(host), mPeerShard(peerShard) {}
+    
+    virtual LibTip::Status Transmit(const uint8_t* pktBuffer, uint32_t pktSize,
+                                    LibTip::MediaType mType)
+    {
+        return mHost.ReceivePacket(mPeerShard, pktBuffer, pktSize, mType);
+    }
+
+private:
+    LibTip::CTipShardedHost& mHost;
+    uint32_t                 mPeerShard;
+};
+
+class BenchShardCallback : public LibTip::CTipCallback {
+public:
+    BenchShardCallback(uint32_t& done) : mDone(done) {}
+
+    virtual void TipNegotiationLastAckReceived(LibTip::MediaType mType) {
+        __atomic_fetch_add(&mDone, 1, __ATOMIC_RELEASE);
+    }
+
+private:
+    uint32_t& mDone;
+};
+
+class BenchShardStart : public LibTip::CTipShardTask {
+public:
+    BenchShardStart(LibTip::CTip& tip, uint32_t peerSSRC) :
+        mTip(tip), mPeerSSRC(peerSSRC) {}
+
+    virtual void Run(LibTip::CTipSessionGroup& group) {
+        group.BindSSRC(mTip, mPeerSSRC);
+        mTip.StartTipNegotiate(LibTip::VIDEO);
+    }
+
+private:
+    LibTip::CTip& mTip;
+    uint32_t      mPeerSSRC;
+};
+
+void bench_shards(uint32_t numSessions, uint32_t numShards)
+{
+    LibTip::CTipShardedHost host(numShards);
+    std::vector<BenchShardTransmit*> links;
+    std::vector<LibTip::CTip*> tips;
+    uint32_t done = 0;
+
+    uint32_t debugFlags = LibTip::gDebugFlags;
+    LibTip::gDebugFlags = 0;
+
+    // pairs span neighbouring shards so all packets cross threads
+    for (uint32_t i = 0; i < numSessions; i++) {
+        uint32_t shardA = host.GetShard(i);
+        uint32_t shardB = host.GetShard(i + 1);
+        uint32_t ssrcA  = (((2 * i) + 1) << 8);
+        uint32_t ssrcB  = (((2 * i) + 2) << 8);
+
+        BenchShardTransmit* linkA = new BenchShardTransmit(host, shardB);
+        BenchShardTransmit* linkB = new BenchShardTransmit(host, shardA);
+        LibTip::CTip* tipA = new LibTip::CTip(*linkA);
+        LibTip::CTip* tipB = new LibTip::CTip(*linkB);
+
+        tipA->SetRTCPSSRC(LibTip::VIDEO, ssrcA);
+        tipB->SetRTCPSSRC(LibTip::VIDEO, ssrcB);
+        tipA->SetCallback(new BenchShardCallback(done));
+        tipB->SetCallback(new BenchShardCallback(done));
+
+        host.AddSession(shardA, *tipA);
+        host.AddSession(shardB, *tipB);
+        
+        links.push_back(linkA);
+        links.push_back(linkB);
+        tips.push_back(tipA);
+        tips.push_back(tipB);
+    }
+
+    host.Start();
+    uint64_t start = LibTip::GetUsecTimestamp();
+
+    for (uint32_t i = 0; i < numSessions; i++) {
+        uint32_t ssrcA = (((2 * i) + 1) << 8);
+        uint32_t ssrcB = (((2 * i) + 2) << 8);
+
+        host.Post(host.GetShard(i), new BenchShardStart(*tips[2 * i], ssrcB));
+        host.Post(host.GetShard(i + 1), new BenchShardStart(*tips[(2 * i) + 1], ssrcA));
+    }
+
+    while (__atomic_load_n(&done, __ATOMIC_ACQUIRE) < tips.size()) {
+        usleep(100);
+    }
+
+    uint64_t negotiateUsec = (LibTip::GetUsecTimestamp() - start);
+    host.Stop();
+
+    printf("%u session pairs negotiated on %u shards in %.1f ms (%.0f pairs/s)\n",
+           numSessions, host.GetNumShards(), (negotiateUsec / 1000.0),
+           ((numSessions * 1000000.0) / negotiateUsec));
+
+    for (uint32_t i = 0; i < tips.size(); i++) {
+        delete tips[i];
+    }
+    for (uint32_t i = 0; i < links.size(); i++) {
+        delete links[i];
+    }
+
+    LibTip::gDebugFlags = debugFlags;
+}
 
 int
 main(int argc, char** argv)
@@ -203,6 +603,9 @@ main(int argc, char** argv)
     bool doParse    = false; // default to no parsing
     bool doExecute  = false; // default to no execute
     bool doClassify = false; // default to no classify
+    uint32_t benchIterations = 0; // default to no benchmark
+    uint32_t benchSessions = 0; // default to no session benchmark
+    uint32_t benchShards = 0; // default to a single thread
     bool verbose    = false; // default to not verbose
     bool doAllRtcp  = false; // default to only MUX/TIP
 
@@ -221,6 +624,9 @@ main(int argc, char** argv)
         "[--parse]\n"
         "[--exec]\n"
         "[--classify]\n"
+        "[--bench iterations]\n"
+        "[--sessions count]\n"
+        "[--shards count]\n"
         "[--verbose]\n"
         "[--allrtcp]\n"
         "[--audio]\n"
@@ -244,6 +650,9 @@ main(int argc, char** argv)
             { "profile", 1, 0, 'j' },
             { "classify",0, 0, 'k' },
             { "allrtcp", 0, 0, 'l' },
+            { "bench",   1, 0, 'm' },
+            { "sessions",1, 0, 'n' },
+            { "shards",  1, 0, 'o' },
             { NULL,      0, 0, 0 }
         };
 
@@ -303,15 +712,45 @@ main(int argc, char** argv)
             doAllRtcp = true;
             break;
 
+        case 'm':
+            if (sscanf(optarg, "%u", &benchIterations) != 1) {
+                printf("ERROR:  invalid iterations '%s'\n", optarg);
+            }
+            break;
+
+        case 'n':
+            if (sscanf(optarg, "%u", &benchSessions) != 1) {
+                printf("ERROR:  invalid session count '%s'\n", optarg);
+            }
+            break;
+
+        case 'o':
+            if (sscanf(optarg, "%u", &benchShards) != 1) {
+                printf("ERROR:  invalid shard count '%s'\n", optarg);
+            }
+            break;
+
         case '?':
             printf("usage:  %s %s", progName, usageString);
             return 0;
         }
     }
 
+    // the session benchmark does not need a capture
+    if (benchSessions != 0) {
+        if (benchShards != 0) {
+            bench_shards(benchSessions, benchShards);
+        } else {
+            bench_sessions(benchSessions);
+        }
+        if (!doParse && !doExecute && !doClassify && benchIterations == 0) {
+            return 0;
+        }
+    }
+
     // must give us something to do
-    if (!doParse && !doExecute && !doClassify) {
-        printf("ERROR:  must specify either --parse or --execute or --classify\n");
+    if (!doParse && !doExecute && !doClassify && benchIterations == 0) {
+        printf("ERROR:  must specify either --parse or --execute or --classify or --bench\n");
         printf("usage:  %s %s", progName, usageString);
         return 1;
     }
@@ -377,6 +816,7 @@ main(int argc, char** argv)
     }
     
     uint32_t pid = 0;
+    std::vector<BenchPacket> saved;
     
     while (1) {
         struct pcap_pkthdr header;
@@ -403,8 +843,18 @@ main(int argc, char** argv)
         if (doClassify) {
             classify_packet(packet, header);
         }
+
+        if (benchIterations != 0) {
+            save_packet(packet, header, saved);
+        }
     }
     
     pcap_close(pcap);
+
+    if (benchIterations != 0) {
+        bench_classify(saved, benchIterations);
+        bench_ack(benchIterations);
+    }
+
     return 0;
 }
@@ -18,10 +18,12 @@
 #include <netdb.h>
 #include <getopt.h>
 #include <sys/socket.h>
+#include <fstream>
 
 #include "tip.h"
 #include "tip_profile.h"
 #include "tip_debug_print.h"
+#include "tip_debug_binary.h"
 
 class SimplePacketXmit : public LibTip::CTipPacketTransmit {
 public:
@@ -190,6 +192,8 @@ main(int argc, char** argv)
     bool     isSecure      = false;
     bool     doAux30       = false;
     bool     doAuxOn       = false;
+    const char* binaryLog  = NULL;
+    const char* traceFile  = NULL;
 
     // turn off logging by default
     // LibTip::gDebugFlags = 0;
@@ -206,7 +210,9 @@ main(int argc, char** argv)
         "[--aux30]\n"
         "[--auxon]\n"
         "[--secure]\n"
-        "[--debug flags]\n";
+        "[--debug flags]\n"
+        "[--binlog file]\n"
+        "[--trace file]\n";
 
     char* progName = argv[0];
     while (true) {
@@ -224,6 +230,8 @@ main(int argc, char** argv)
             { "auxon",   0, 0, 'i' },
             { "secure",  0, 0, 'j' },
             { "debug",   1, 0, 'k' },
+            { "binlog",  1, 0, 'l' },
+            { "trace",   1, 0, 'm' },
             { NULL,      0, 0, 0 }
         };
 
@@ -286,6 +294,14 @@ main(int argc, char** argv)
                 printf("ERROR:  invalid debug flags '%s'\n", optarg);
             }
             break;
+
+        case 'l':
+            binaryLog = optarg;
+            break;
+
+        case 'm':
+            traceFile = optarg;
+            break;
             
         case '?':
         default:
@@ -295,6 +311,15 @@ main(int argc, char** argv)
         }
     }
 
+    // log in binary form, read it back with tip_log_decode
+    if (binaryLog != NULL) {
+        FILE* logFile = fopen(binaryLog, "wb");
+        if (logFile == NULL || LibTip::DebugBinaryStart(logFile) != 0) {
+            printf("ERROR could not start binary log '%s'\n", binaryLog);
+            return 1;
+        }
+    }
+    
     int as = create_socket(localPort);
     if (as < 0) {
         printf("ERROR creating audio socket\n");
@@ -406,5 +431,16 @@ main(int argc, char** argv)
             tip.StartPresentation();
             doAuxOn = false;
         }
+
+        // dump the negotiation timeline once, load it into
+        // chrome://tracing to see where the time went
+        if (traceFile != NULL && negDone) {
+            std::ofstream trace(traceFile);
+            tip.WriteNegotiationTrace(trace);
+            if (! trace) {
+                printf("ERROR could not write trace '%s'\n", traceFile);
+            }
+            traceFile = NULL;
+        }
     }
 }
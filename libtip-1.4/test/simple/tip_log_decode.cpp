@@ -0,0 +1,77 @@
+/*
+ *   Copyright 2010 IMTC, Inc.  All rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include "tip_debug_print.h"
+#include "tip_debug_binary.h"
+
+// turns a log written by the binary logging backend (see
+// LibTip::DebugBinaryStart) back into text.  the prefix of each line
+// is selected with the same debug flags as the text backend.
+int main(int argc, char* argv[])
+{
+    const char* usageString =
+        "\n"
+        "[--debug flags]\n"
+        "[file]\n";
+
+    char* progName = argv[0];
+    while (true) {
+        int c = -1;
+
+        static struct option long_options[] = {
+            { "debug",   1, 0, 'a' },
+            { NULL,      0, 0, 0 }
+        };
+
+        c = getopt_long_only(argc, argv, "", long_options, NULL);
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+        case 'a':
+            if (sscanf(optarg, "%u", &LibTip::gDebugFlags) != 1) {
+                printf("ERROR:  invalid debug flags '%s'\n", optarg);
+            }
+            break;
+            
+        case '?':
+        default:
+            printf("usage:  %s %s", progName, usageString);
+            exit(0);
+        }
+    }
+
+    FILE* input = stdin;
+    if (optind < argc) {
+        input = fopen(argv[optind], "rb");
+        if (input == NULL) {
+            printf("ERROR could not open '%s'\n", argv[optind]);
+            return 1;
+        }
+    }
+
+    if (LibTip::DebugBinaryDecode(input, stdout) < 0) {
+        fprintf(stderr, "ERROR input is not a valid binary log\n");
+        return 1;
+    }
+
+    return 0;
+}